@@ -23,8 +23,10 @@ public:
 
 public:
 
-    BDFactory(const Integer3& matrix_sizes = default_matrix_sizes(), Real bd_dt_factor = default_bd_dt_factor())
-        : base_type(), rng_(), matrix_sizes_(matrix_sizes), bd_dt_factor_(bd_dt_factor)
+    BDFactory(const Integer3& matrix_sizes = default_matrix_sizes(), Real bd_dt_factor = default_bd_dt_factor(),
+              const Integer num_slabs = default_num_slabs())
+        : base_type(), rng_(), matrix_sizes_(matrix_sizes), bd_dt_factor_(bd_dt_factor),
+        num_slabs_(num_slabs)
     {
         ; // do nothing
     }
@@ -39,6 +41,11 @@ public:
         return -1.0;
     }
 
+    static inline const Integer default_num_slabs()
+    {
+        return 1;
+    }
+
     virtual ~BDFactory()
     {
         ; // do nothing
@@ -84,11 +91,12 @@ public:
     {
         if (bd_dt_factor_ > 0)
         {
-            return new BDSimulator(model, world, bd_dt_factor_);
+            return new BDSimulator(model, world, bd_dt_factor_, num_slabs_);
         }
         else
         {
-            return new BDSimulator(model, world);
+            return new BDSimulator(
+                model, world, BDSimulator::default_bd_dt_factor(), num_slabs_);
         }
     }
 
@@ -97,11 +105,12 @@ public:
     {
         if (bd_dt_factor_ > 0)
         {
-            return new BDSimulator(world, bd_dt_factor_);
+            return new BDSimulator(world, bd_dt_factor_, num_slabs_);
         }
         else
         {
-            return new BDSimulator(world);
+            return new BDSimulator(
+                world, BDSimulator::default_bd_dt_factor(), num_slabs_);
         }
     }
 
@@ -110,6 +119,7 @@ protected:
     boost::shared_ptr<RandomNumberGenerator> rng_;
     Integer3 matrix_sizes_;
     Real bd_dt_factor_;
+    Integer num_slabs_;
 };
 
 } // bd
@@ -14,56 +14,76 @@ namespace bd
 
 bool BDPropagator::operator()()
 {
-    if (queue_.empty())
+    ParticleID pid;
+    ParticleRecord r;
+    for (bool found(false); !found; )
     {
-        return false;
-    }
+        if (queue_.empty())
+        {
+            return false;
+        }
 
-    const ParticleID pid(queue_.back().first);
-    queue_.pop_back();
-    Particle particle(world_.get_particle(pid).second);
+        pid = queue_.back();
+        queue_.pop_back();
+        r = world_.get_record(pid, found); // not found if removed before
+    }
 
-    if (attempt_reaction(pid, particle))
+    if (has_first_order_reaction(r.species_id)
+        && attempt_reaction(pid, world_.to_particle(r)))
     {
         return true;
     }
 
-    const Real D(particle.D());
-    if (D == 0)
+    if (r.D == 0)
     {
         return true;
     }
 
-    const Real3 newpos(
-        world_.apply_boundary(
-            particle.position() + draw_displacement(particle)));
-    Particle particle_to_update(
-        particle.species(), newpos, particle.radius(), particle.D());
-    // Particle particle_to_update(
-    //     particle.species_serial(), newpos, particle.radius(), particle.D());
-    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
-        overlapped(world_.list_particles_within_radius(
-                       newpos, particle.radius(), pid));
-
-    switch (overlapped.size())
+    attempt_move(
+        pid, r, world_.apply_boundary(r.position + draw_displacement(r.D)));
+    return true;
+}
+
+bool BDPropagator::attempt_move(
+    const ParticleID& pid, const ParticleRecord& r, const Real3& newpos)
+{
+    overlap_checker checker(pid);
+    world_.each_particle_within_radius(newpos, r.radius, checker);
+
+    switch (checker.num_overlaps)
     {
     case 0:
-        world_.update_particle_without_checking(pid, particle_to_update);
+        world_.move_particle_without_checking(pid, newpos);
         return true;
     case 1:
         {
-            std::pair<ParticleID, Particle> closest(
-                (*(overlapped.begin())).first);
-            if (attempt_reaction(
-                    pid, particle_to_update, closest.first, closest.second))
-            {
-                return true;
-            }
+            ParticleRecord moved(r);
+            moved.position = newpos;
+            const std::pair<ParticleID, Particle> closest(
+                world_.get_particle(checker.first_overlap));
+            attempt_reaction(
+                pid, world_.to_particle(moved), closest.first, closest.second);
         }
-        return true;
+        return false;
     default:
-        return true;
+        return false;
+    }
+}
+
+bool BDPropagator::has_first_order_reaction(
+    Model& model, const BDWorld& world, std::vector<int>& first_order,
+    const ParticleRecord::species_id_type& sid)
+{
+    if (sid >= first_order.size())
+    {
+        first_order.resize(sid + 1, -1);
+    }
+    if (first_order[sid] < 0)
+    {
+        first_order[sid] = (model.query_reaction_rules(
+            world.get_species(sid)).size() > 0 ? 1 : 0);
     }
+    return (first_order[sid] > 0);
 }
 
 bool BDPropagator::attempt_reaction(
@@ -103,10 +123,8 @@ bool BDPropagator::attempt_reaction(
                     const Real radius_new(info.radius);
                     const Real D_new(info.D);
 
-                    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
-                        overlapped(world_.list_particles_within_radius(
-                                       particle.position(), radius_new, pid));
-                    if (overlapped.size() > 0)
+                    if (world_.has_particle_within_radius(
+                            particle.position(), radius_new, pid))
                     {
                         // throw NoSpace("");
                         return false;
@@ -154,15 +172,8 @@ bool BDPropagator::attempt_reaction(
                             particle.position() + ipv * (D1 / D12));
                         newpos2 = world_.apply_boundary(
                             particle.position() - ipv * (D2 / D12));
-                        std::vector<
-                            std::pair<std::pair<ParticleID, Particle>, Real> >
-                            overlapped1(world_.list_particles_within_radius(
-                                            newpos1, radius1, pid));
-                        std::vector<
-                            std::pair<std::pair<ParticleID, Particle>, Real> >
-                            overlapped2(world_.list_particles_within_radius(
-                                            newpos2, radius2, pid));
-                        if (overlapped1.size() == 0 && overlapped2.size() == 0)
+                        if (!world_.has_particle_within_radius(newpos1, radius1, pid)
+                            && !world_.has_particle_within_radius(newpos2, radius2, pid))
                         {
                             break;
                         }
@@ -255,10 +266,8 @@ bool BDPropagator::attempt_reaction(
                     const Real3 newpos(
                         world_.apply_boundary((pos1 * D2 + pos2 * D1) / D12));
 
-                    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
-                        overlapped(world_.list_particles_within_radius(
-                                       newpos, radius_new, pid1, pid2));
-                    if (overlapped.size() > 0)
+                    if (world_.has_particle_within_radius(
+                            newpos, radius_new, pid1, pid2))
                     {
                         // throw NoSpace("");
                         return false;
@@ -289,14 +298,8 @@ bool BDPropagator::attempt_reaction(
 
 void BDPropagator::remove_particle(const ParticleID& pid)
 {
+    // the id left in queue_ is skipped later, as this is not found.
     world_.remove_particle(pid);
-    particle_finder cmp(pid);
-    std::vector<std::pair<ParticleID, Particle> >::iterator
-        i(std::find_if(queue_.begin(), queue_.end(), cmp));
-    if (i != queue_.end())
-    {
-        queue_.erase(i);
-    }
 }
 
 } // bd
@@ -1,6 +1,8 @@
 #ifndef ECELL4_BD_BD_PROPAGATOR_HPP
 #define ECELL4_BD_BD_PROPAGATOR_HPP
 
+#include <cmath>
+#include <boost/array.hpp>
 #include <ecell4/core/RandomNumberGenerator.hpp>
 #include <ecell4/core/Model.hpp>
 
@@ -73,13 +75,20 @@ public:
 
 public:
 
+    /**
+     * propagate the particles in queue in a random order.
+     * queue is shuffled here and emptied by the propagation, and can be
+     * reused across steps without reallocating. a particle removed by
+     * a reaction before its turn is not found in the world, and skipped.
+     */
     BDPropagator(
         Model& model, BDWorld& world, RandomNumberGenerator& rng, const Real& dt,
-        std::vector<std::pair<ReactionRule, reaction_info_type> >& last_reactions)
+        std::vector<std::pair<ReactionRule, reaction_info_type> >& last_reactions,
+        std::vector<ParticleID>& queue)
         : model_(model), world_(world), rng_(rng), dt_(dt),
-        last_reactions_(last_reactions), max_retry_count_(1)
+        last_reactions_(last_reactions), max_retry_count_(1), queue_(queue),
+        num_gaussians_(0)
     {
-        queue_ = world_.list_particles();
         shuffle(rng_, queue_);
     }
 
@@ -100,27 +109,45 @@ public:
         const ParticleID& pid1, const Particle& particle1,
         const ParticleID& pid2, const Particle& particle2);
 
-    class particle_finder
-        : public std::unary_function<std::pair<ParticleID, Particle>, bool>
+    /**
+     * a visitor for BDWorld::each_particle_within_radius, which counts
+     * the overlaps up to two, that is enough to tell a move is rejected.
+     */
+    struct overlap_checker
     {
-    public:
-
-        particle_finder(const ParticleID& pid)
-            : pid_(pid)
+        overlap_checker(const ParticleID& ignore)
+            : ignore(ignore), num_overlaps(0)
         {
             ;
         }
 
-        bool operator()(std::pair<ParticleID, Particle> pid_particle_pair)
+        bool operator()(
+            const std::pair<ParticleID, ParticleRecord>& pp, const Real dist)
         {
-            return (pid_particle_pair.first == pid_);
+            if (pp.first == ignore)
+            {
+                return true;
+            }
+            if (num_overlaps == 0)
+            {
+                first_overlap = pp.first;
+            }
+            return (++num_overlaps < 2);
         }
 
-    protected:
-
-        ParticleID pid_;
+        const ParticleID ignore;
+        Integer num_overlaps;
+        ParticleID first_overlap;
     };
 
+    /**
+     * move the particle to newpos unless it overlaps with others.
+     * if it overlaps with just one, a reaction between them is attempted.
+     * return true if moved.
+     */
+    bool attempt_move(
+        const ParticleID& pid, const ParticleRecord& r, const Real3& newpos);
+
     void remove_particle(const ParticleID& pid);
 
     inline Real3 draw_displacement(const Particle& particle)
@@ -128,6 +155,41 @@ public:
         return random_displacement_3d(rng(), dt(), particle.D());
     }
 
+    /**
+     * a displacement scaled from the normal deviates, which are drawn
+     * in a block at a time.
+     */
+    inline Real3 draw_displacement(const Real& D)
+    {
+        if (num_gaussians_ < 3)
+        {
+            rng_.fill_gaussian(gaussians_.data(), gaussians_.size(), 1.0);
+            num_gaussians_ = gaussians_.size();
+        }
+
+        const Real sigma(std::sqrt(2 * D * dt()));
+        const Real* const g(gaussians_.data() + gaussians_.size() - num_gaussians_);
+        num_gaussians_ -= 3;
+        return Real3(g[0] * sigma, g[1] * sigma, g[2] * sigma);
+    }
+
+    /**
+     * if any first-order reaction is given to the species.
+     * this is looked up in the model once for each species in a step.
+     */
+    bool has_first_order_reaction(const ParticleRecord::species_id_type& sid)
+    {
+        return has_first_order_reaction(model_, world_, first_order_, sid);
+    }
+
+    /**
+     * the same with the answers cached in first_order for each species id,
+     * where -1 means not looked up yet.
+     */
+    static bool has_first_order_reaction(
+        Model& model, const BDWorld& world, std::vector<int>& first_order,
+        const ParticleRecord::species_id_type& sid);
+
     inline Real3 draw_ipv(const Real& sigma, const Real& t, const Real& D)
     {
         return random_ipv_3d(rng(), sigma, t, D);
@@ -142,7 +204,10 @@ protected:
     std::vector<std::pair<ReactionRule, reaction_info_type> >& last_reactions_;
     Integer max_retry_count_;
 
-    BDWorld::particle_container_type queue_;
+    std::vector<ParticleID>& queue_;
+    boost::array<Real, 3 * 128> gaussians_;
+    std::size_t num_gaussians_; // left in gaussians_
+    std::vector<int> first_order_; // for each species id, -1 if unknown
 };
 
 } // bd
@@ -4,6 +4,8 @@
 
 #include <cstring>
 
+#include <ecell4/core/exceptions.hpp>
+
 namespace ecell4
 {
 
@@ -14,8 +16,19 @@ void BDSimulator::step()
 {
     last_reactions_.clear();
 
+    if (num_slabs_ < 2 || !propagate_in_slabs_())
     {
-        BDPropagator propagator(*model_, *world_, *rng(), dt(), last_reactions_);
+        const BDWorld::particle_space_type::record_container_type&
+            records(world_->records());
+        queue_.clear();
+        for (BDWorld::particle_space_type::record_container_type::const_iterator
+                i(records.begin()); i != records.end(); ++i)
+        {
+            queue_.push_back((*i).first);
+        }
+
+        BDPropagator propagator(
+            *model_, *world_, *rng(), dt(), last_reactions_, queue_);
         while (propagator())
         {
             ; // do nothing here
@@ -49,6 +62,163 @@ bool BDSimulator::step(const Real& upto)
     }
 }
 
+bool BDSimulator::propagate_in_slabs_()
+{
+    // a slab reads the cells next to it, and the slabs of the same parity
+    // are run at once. the first and the last slabs are neighbors over
+    // the periodic boundary, so they must differ in parity.
+    const Integer num_cells(world_->matrix_sizes().col);
+    Integer num_slabs(std::min(num_slabs_, num_cells));
+    num_slabs -= num_slabs % 2;
+    if (num_slabs < 2)
+    {
+        return false;
+    }
+
+    // a generator for each slab, split from the world's, so that
+    // a trajectory is the same with any number of threads.
+    const PhiloxRandomNumberGenerator
+        root(rng()->uniform_int(0, 2147483647));
+    std::vector<boost::shared_ptr<PhiloxRandomNumberGenerator> >
+        slab_rngs(num_slabs);
+    for (Integer i(0); i < num_slabs; ++i)
+    {
+        slab_rngs[i] = root.split(i);
+    }
+
+    // the particles with a first-order reaction are left to BDPropagator.
+    queue_.clear();
+    std::vector<int> first_order; // for each species id, -1 if unknown
+    std::vector<std::vector<std::size_t> > indices(num_slabs);
+    const BDWorld::particle_space_type::record_container_type&
+        records(world_->records());
+    for (std::size_t idx(0); idx < records.size(); ++idx)
+    {
+        const ParticleRecord& r(records[idx].second);
+        if (BDPropagator::has_first_order_reaction(
+                *model_, *world_, first_order, r.species_id))
+        {
+            queue_.push_back(records[idx].first);
+        }
+        else if (r.D > 0)
+        {
+            indices[world_->cell_index(r.position).col * num_slabs / num_cells]
+                .push_back(idx);
+        }
+    }
+
+    std::vector<move_container_type> deferred(num_slabs);
+    std::vector<std::string> errors(num_slabs);
+
+    // move_particle_without_checking writes no flag in the threads after this.
+    world_->invalidate_particles();
+    for (int phase(0); phase < 2; ++phase)
+    {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (int i = phase; i < num_slabs; i += 2)
+        {
+            // an error is kept by slab, and rethrown after both phases.
+            try
+            {
+                propagate_in_slab_(indices[i], i, num_slabs, *(slab_rngs[i]),
+                                   deferred[i]);
+            }
+            catch (const std::exception& e)
+            {
+                errors[i] = e.what();
+            }
+        }
+    }
+
+    for (Integer i(0); i < num_slabs; ++i)
+    {
+        if (!errors[i].empty())
+        {
+            throw IllegalState(errors[i]);
+        }
+    }
+
+    BDPropagator propagator(
+        *model_, *world_, *rng(), dt(), last_reactions_, queue_);
+
+    // the deferred moves are made in the order of slabs with the positions
+    // drawn in the sweep. the overlaps are checked again here, and
+    // a reaction is attempted with the one overlapping now.
+    for (Integer i(0); i < num_slabs; ++i)
+    {
+        for (move_container_type::const_iterator itr(deferred[i].begin());
+             itr != deferred[i].end(); ++itr)
+        {
+            bool found(false);
+            const ParticleRecord r(world_->get_record((*itr).first, found));
+            if (!found)
+            {
+                // it has reacted before.
+                continue;
+            }
+            propagator.attempt_move((*itr).first, r, (*itr).second);
+        }
+    }
+
+    while (propagator())
+    {
+        ; // do nothing here
+    }
+    return true;
+}
+
+void BDSimulator::propagate_in_slab_(
+    std::vector<std::size_t>& indices, const Integer slab,
+    const Integer num_slabs, RandomNumberGenerator& rng,
+    move_container_type& deferred)
+{
+    BDWorld& world(*world_);
+    const Integer num_cells(world.matrix_sizes().col);
+
+    shuffle(rng, indices);
+    std::vector<Real> gaussians(indices.size() * 3);
+    if (!gaussians.empty())
+    {
+        rng.fill_gaussian(&gaussians[0], gaussians.size(), 1.0);
+    }
+
+    for (std::size_t i(0); i < indices.size(); ++i)
+    {
+        // no record is added nor removed here, and the reference is kept.
+        const std::pair<ParticleID, ParticleRecord>& pp(
+            world.records()[indices[i]]);
+        const Real sigma(std::sqrt(2 * pp.second.D * dt()));
+        const Real3 newpos(world.apply_boundary(pp.second.position
+            + Real3(gaussians[3 * i] * sigma, gaussians[3 * i + 1] * sigma,
+                    gaussians[3 * i + 2] * sigma)));
+
+        if (world.cell_index(newpos).col * num_slabs / num_cells != slab)
+        {
+            // leaving the slab. the move is made after the sweep.
+            deferred.push_back(std::make_pair(pp.first, newpos));
+            continue;
+        }
+
+        BDPropagator::overlap_checker checker(pp.first);
+        world.each_particle_within_radius(newpos, pp.second.radius, checker);
+
+        switch (checker.num_overlaps)
+        {
+        case 0:
+            world.move_particle_without_checking(pp.first, newpos);
+            break;
+        case 1:
+            // a collision. the reaction is attempted after the sweep.
+            deferred.push_back(std::make_pair(pp.first, newpos));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
 } // bd
 
 } // ecell4
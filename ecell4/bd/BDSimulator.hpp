@@ -28,18 +28,47 @@ public:
 public:
 
     BDSimulator(boost::shared_ptr<Model> model,
-        boost::shared_ptr<BDWorld> world, Real bd_dt_factor = 1e-5)
-        : base_type(model, world), dt_(0), bd_dt_factor_(bd_dt_factor)
+        boost::shared_ptr<BDWorld> world,
+        Real bd_dt_factor = default_bd_dt_factor())
+        : base_type(model, world), dt_(0), bd_dt_factor_(bd_dt_factor),
+        num_slabs_(1)
     {
         initialize();
     }
 
-    BDSimulator(boost::shared_ptr<BDWorld> world, Real bd_dt_factor = 1e-5)
-        : base_type(world), dt_(0), bd_dt_factor_(bd_dt_factor)
+    BDSimulator(boost::shared_ptr<BDWorld> world,
+        Real bd_dt_factor = default_bd_dt_factor())
+        : base_type(world), dt_(0), bd_dt_factor_(bd_dt_factor), num_slabs_(1)
     {
         initialize();
     }
 
+    /**
+     * propagate the particles in num_slabs slabs of the cells in parallel.
+     * see propagate_in_slabs_.
+     */
+    BDSimulator(boost::shared_ptr<Model> model,
+        boost::shared_ptr<BDWorld> world, Real bd_dt_factor,
+        const Integer num_slabs)
+        : base_type(model, world), dt_(0), bd_dt_factor_(bd_dt_factor),
+        num_slabs_(num_slabs)
+    {
+        initialize();
+    }
+
+    BDSimulator(boost::shared_ptr<BDWorld> world, Real bd_dt_factor,
+        const Integer num_slabs)
+        : base_type(world), dt_(0), bd_dt_factor_(bd_dt_factor),
+        num_slabs_(num_slabs)
+    {
+        initialize();
+    }
+
+    static inline const Real default_bd_dt_factor()
+    {
+        return 1e-5;
+    }
+
     // SimulatorTraits
 
     void initialize()
@@ -110,6 +139,34 @@ public:
         return (*world_).rng();
     }
 
+    Integer const& num_slabs() const
+    {
+        return num_slabs_;
+    }
+
+protected:
+
+    /**
+     * the moves left by the sweep, the id and the new position.
+     */
+    typedef std::vector<std::pair<ParticleID, Real3> > move_container_type;
+
+    /**
+     * cut the cells into slabs along the first axis, and propagate the
+     * particles in the even slabs, then in the odd slabs, in parallel.
+     * a particle only moves within its slab, and only reads the cells in
+     * its slab and the next ones, which are not written at the same time.
+     * the other moves, the ones leaving the slab and the collisions, are
+     * made with the same displacements after that. the particles with
+     * a first-order reaction are left to BDPropagator.
+     * return false if the cells are too few to be cut.
+     */
+    bool propagate_in_slabs_();
+    void propagate_in_slab_(
+        std::vector<std::size_t>& indices, const Integer slab,
+        const Integer num_slabs, RandomNumberGenerator& rng,
+        move_container_type& deferred);
+
 protected:
 
     /**
@@ -119,6 +176,12 @@ protected:
     Real dt_;
     const Real bd_dt_factor_;
     std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions_;
+    const Integer num_slabs_;
+
+    /**
+     * the buffer of BDPropagator, kept to be reused.
+     */
+    std::vector<ParticleID> queue_;
 };
 
 } // bd
@@ -11,6 +11,7 @@
 #include <ecell4/core/SerialIDGenerator.hpp>
 #include <ecell4/core/ParticleSpace.hpp>
 #include <ecell4/core/ParticleSpaceCellListImpl.hpp>
+#include <ecell4/core/ParticleSpaceCellListSoAImpl.hpp>
 #include <ecell4/core/Model.hpp>
 
 
@@ -33,6 +34,7 @@ public:
 
     typedef MoleculeInfo molecule_info_type;
     typedef ParticleSpaceCellListImpl particle_space_type;
+    // typedef ParticleSpaceCellListSoAImpl particle_space_type;
     // typedef ParticleSpaceVectorImpl particle_space_type;
     typedef particle_space_type::particle_container_type particle_container_type;
 
@@ -77,7 +79,7 @@ public:
         // {
         //     throw AlreadyExists("particle already exists");
         // }
-        if (list_particles_within_radius(p.position(), p.radius()).size() == 0)
+        if (!has_particle_within_radius(p.position(), p.radius()))
         {
             (*ps_).update_particle(pid, p); //XXX: DONOT call this->update_particle
             return std::make_pair(std::make_pair(pid, p), true);
@@ -202,10 +204,53 @@ public:
         return (*ps_).update_particle(pid, p);
     }
 
+    /**
+     * for the parallel propagation.
+     * see ParticleSpaceCellListImpl::move_particle.
+     */
+    void move_particle_without_checking(const ParticleID& pid, const Real3& pos)
+    {
+        (*ps_).move_particle(pid, pos);
+    }
+
+    void invalidate_particles()
+    {
+        (*ps_).invalidate_particles();
+    }
+
+    const particle_space_type::record_container_type& records() const
+    {
+        return (*ps_).records();
+    }
+
+    ParticleRecord get_record(const ParticleID& pid, bool& found) const
+    {
+        return (*ps_).get_record(pid, found);
+    }
+
+    const Species& get_species(const ParticleRecord::species_id_type& sid) const
+    {
+        return (*ps_).get_species(sid);
+    }
+
+    Particle to_particle(const ParticleRecord& r) const
+    {
+        return (*ps_).to_particle(r);
+    }
+
+    const Integer3 matrix_sizes() const
+    {
+        return (*ps_).matrix_sizes();
+    }
+
+    Integer3 cell_index(const Real3& pos) const
+    {
+        return (*ps_).cell_index(pos);
+    }
+
     bool update_particle(const ParticleID& pid, const Particle& p)
     {
-        if (list_particles_within_radius(p.position(), p.radius(), pid).size()
-            == 0)
+        if (!has_particle_within_radius(p.position(), p.radius(), pid))
         {
             return (*ps_).update_particle(pid, p);
         }
@@ -248,6 +293,33 @@ public:
         return (*ps_).list_particles_within_radius(pos, radius, ignore1, ignore2);
     }
 
+    /**
+     * the queries without a copy of Particle.
+     * see ParticleSpaceCellListImpl::each_particle_within_radius.
+     */
+    template<typename Tvisitor_>
+    bool each_particle_within_radius(
+        const Real3& pos, const Real& radius, Tvisitor_& visitor) const
+    {
+        return (*ps_).each_particle_within_radius(pos, radius, visitor);
+    }
+
+    bool has_particle_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const
+    {
+        return (*ps_).has_particle_within_radius(pos, radius, ignore1, ignore2);
+    }
+
+    Integer count_particles_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const
+    {
+        return (*ps_).count_particles_within_radius(pos, radius, ignore1, ignore2);
+    }
+
     inline Real3 periodic_transpose(
         const Real3& pos1, const Real3& pos2) const
     {
@@ -405,7 +477,7 @@ public:
 
 protected:
 
-    boost::scoped_ptr<ParticleSpace> ps_;
+    boost::scoped_ptr<particle_space_type> ps_;
     boost::shared_ptr<RandomNumberGenerator> rng_;
     SerialIDGenerator<ParticleID> pidgen_;
 
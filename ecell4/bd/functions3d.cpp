@@ -29,8 +29,9 @@ Real3 random_displacement_3d(
     RandomNumberGenerator& rng, const Real& t, const Real& D)
 {
     const Real sigma(std::sqrt(2 * D * t));
-    return Real3(
-        rng.gaussian(sigma), rng.gaussian(sigma), rng.gaussian(sigma));
+    Real xyz[3];
+    rng.fill_gaussian(xyz, 3, sigma);
+    return Real3(xyz[0], xyz[1], xyz[2]);
 }
 
 Real Igbd_3d(const Real& sigma, const Real& t, const Real& D)
@@ -0,0 +1,70 @@
+#include <iostream>
+#include <cstdlib>
+#include <sys/time.h>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/bd/BDSimulator.hpp>
+
+using namespace ecell4;
+using namespace ecell4::bd;
+
+/**
+ * two diffusing species, A and B, with the excluded volume.
+ * if k2 > 0, they collide and react, A + B -> B, with the rate k2.
+ */
+boost::shared_ptr<NetworkModel> generate_model(const Real k2)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    const Species A("A", "5e-9", "1e-12"), B("B", "5e-9", "1e-12");
+    model->add_species_attribute(A);
+    model->add_species_attribute(B);
+    if (k2 > 0)
+    {
+        model->add_reaction_rule(create_binding_reaction_rule(A, B, B, k2));
+    }
+    return model;
+}
+
+double walltime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+int main(int argc, char **argv)
+{
+    const Integer num_particles(argc > 1 ? std::atoi(argv[1]) : 10000);
+    const Integer num_steps(argc > 2 ? std::atoi(argv[2]) : 100);
+    const Real L(argc > 3 ? std::atof(argv[3]) : 1e-6);
+    const Integer matrix_size(argc > 4 ? std::atoi(argv[4]) : 10);
+    const Real k2(argc > 5 ? std::atof(argv[5]) : 0.0);
+    const Integer num_slabs(argc > 6 ? std::atoi(argv[6]) : 1);
+
+    const boost::shared_ptr<NetworkModel> model(generate_model(k2));
+
+    boost::shared_ptr<RandomNumberGenerator>
+        rng(new GSLRandomNumberGenerator());
+    rng->seed(0);
+    boost::shared_ptr<BDWorld> world(
+        new BDWorld(Real3(L, L, L),
+                    Integer3(matrix_size, matrix_size, matrix_size), rng));
+    world->bind_to(model);
+    world->add_molecules(Species("A"), num_particles / 2);
+    world->add_molecules(Species("B"), num_particles - num_particles / 2);
+
+    BDSimulator sim(model, world, BDSimulator::default_bd_dt_factor(), num_slabs);
+
+    const double start(walltime());
+    for (Integer i(0); i < num_steps; ++i)
+    {
+        sim.step();
+    }
+    const double end(walltime());
+
+    std::cout << "# particles\tsteps\tt\t[us/step]" << std::endl;
+    std::cout << world->num_particles() << "\t" << num_steps << "\t" << sim.t()
+              << "\t" << (end - start) / num_steps * 1e+6 << std::endl;
+    return 0;
+}
@@ -59,3 +59,150 @@ BOOST_AUTO_TEST_CASE(BDSimulator_test_step2)
     BDSimulator target(model, world);
     target.step();
 }
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_slabs)
+{
+    const Real L(2e-7);
+    const Real3 edge_lengths(L, L, L);
+    const Integer3 matrix_sizes(8, 8, 8);
+    const Species sp1("A", "5e-9", "1e-12"), sp2("B", "5e-9", "1e-12"),
+          sp3("C", "5e-9", "1e-12");
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 1e-18));
+
+    std::vector<std::pair<ParticleID, Particle> > particles[2];
+    for (Integer j(0); j < 2; ++j)
+    {
+        boost::shared_ptr<RandomNumberGenerator>
+            rng(new GSLRandomNumberGenerator());
+        rng->seed(0);
+        boost::shared_ptr<BDWorld> world(
+            new BDWorld(edge_lengths, matrix_sizes, rng));
+        world->bind_to(model);
+        world->add_molecules(sp1, 100);
+        world->add_molecules(sp2, 100);
+
+        BDSimulator sim(model, world, 1e-2, 4);
+        BOOST_CHECK_EQUAL(sim.num_slabs(), 4);
+
+        Integer num_reactions(0);
+        for (Integer i(0); i < 100; ++i)
+        {
+            sim.step();
+            num_reactions += sim.last_reactions().size();
+        }
+
+        const Integer num_sp3(world->num_molecules(sp3));
+        BOOST_CHECK(num_sp3 > 0);
+        BOOST_CHECK_EQUAL(num_reactions, num_sp3);
+        BOOST_CHECK_EQUAL(100 - world->num_molecules(sp1), num_sp3);
+        BOOST_CHECK_EQUAL(100 - world->num_molecules(sp2), num_sp3);
+
+        particles[j] = world->list_particles();
+        for (std::vector<std::pair<ParticleID, Particle> >::const_iterator
+                itr(particles[j].begin()); itr != particles[j].end(); ++itr)
+        {
+            // no overlap is made by the moves in parallel.
+            BOOST_CHECK(!world->has_particle_within_radius(
+                (*itr).second.position(), (*itr).second.radius(), (*itr).first));
+        }
+    }
+
+    // the slabs are propagated with generators seeded by the world.
+    BOOST_CHECK_EQUAL(particles[0].size(), particles[1].size());
+    for (std::size_t i(0); i < particles[0].size() && i < particles[1].size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(particles[0][i].first, particles[1][i].first);
+        BOOST_CHECK_EQUAL(particles[0][i].second.position(), particles[1][i].second.position());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_removal)
+{
+    const Real L(2e-7);
+    const Real3 edge_lengths(L, L, L);
+    const Integer3 matrix_sizes(8, 8, 8);
+    const Species sp1("A", "5e-9", "1e-12"), sp2("B", "5e-9", "1e-12");
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_reaction_rule(create_degradation_reaction_rule(sp1, 1e+4));
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp2, 1e-18));
+
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    rng->seed(0);
+    boost::shared_ptr<BDWorld> world(new BDWorld(edge_lengths, matrix_sizes, rng));
+    world->bind_to(model);
+    world->add_molecules(sp1, 100);
+    world->add_molecules(sp2, 100);
+
+    // the particles removed in a step are skipped in the rest of the step.
+    BDSimulator sim(model, world, 1e-2);
+    Integer num_reactions(0);
+    for (Integer i(0); i < 100; ++i)
+    {
+        sim.step();
+        num_reactions += sim.last_reactions().size();
+    }
+
+    BOOST_CHECK(num_reactions > 0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 100 - num_reactions);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 100);
+}
+
+/**
+ * the mean square displacement in a step, 6 D dt, must not depend on
+ * the slabs. a move leaving its slab must not be drawn again.
+ */
+Real mean_square_displacement(const Integer num_slabs)
+{
+    const Real L(2e-7), D(1e-12), dt(1e-4);
+    const Real3 edge_lengths(L, L, L);
+    const Integer3 matrix_sizes(8, 8, 8);
+    const Species sp1("A", "1e-9", "1e-12");
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    rng->seed(0);
+    boost::shared_ptr<BDWorld> world(new BDWorld(edge_lengths, matrix_sizes, rng));
+    world->bind_to(model);
+    world->add_molecules(sp1, 200);
+
+    BDSimulator sim(model, world, BDSimulator::default_bd_dt_factor(), num_slabs);
+    sim.set_dt(dt);
+
+    Real sum(0.0);
+    Integer num_samples(0);
+    for (Integer i(0); i < 100; ++i)
+    {
+        const std::vector<std::pair<ParticleID, Particle> >
+            before(world->list_particles());
+        sim.step();
+        for (std::vector<std::pair<ParticleID, Particle> >::const_iterator
+                itr(before.begin()); itr != before.end(); ++itr)
+        {
+            const Real3 pos0((*itr).second.position());
+            const Real3 pos1(world->periodic_transpose(
+                world->get_particle((*itr).first).second.position(), pos0));
+            sum += length_sq(pos1 - pos0);
+            ++num_samples;
+        }
+    }
+    return sum / num_samples / (6 * D * dt);
+}
+
+BOOST_AUTO_TEST_CASE(BDSimulator_test_slabs_displacement)
+{
+    // the relative error of the mean is about 0.6%.
+    const Real msd1(mean_square_displacement(1)), msd4(mean_square_displacement(4));
+    BOOST_CHECK_CLOSE(msd1, 1.0, 3.0);
+    BOOST_CHECK_CLOSE(msd4, 1.0, 3.0);
+    BOOST_CHECK_CLOSE(msd4, msd1, 3.0);
+}
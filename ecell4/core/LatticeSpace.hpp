@@ -180,6 +180,34 @@ public:
         VoxelPool* const& from, VoxelPool* const& loc,
         coordinate_id_pair_type& info, const Integer nrand) = 0;
 
+    /**
+     * reorder the molecules of a species so that a sweep over them
+     * visits nearby voxels one after another.
+     */
+    virtual void sort_voxels(const Species& sp)
+    {
+        ; // do nothing
+    }
+
+    /**
+     * move a molecule as move_to_neighbor, but leave the indexes of the
+     * pool from unchanged. only info.coordinate is updated. the caller
+     * must fix the indexes with MoleculePool::reindex_voxels afterwards.
+     * this allows molecules far apart to move concurrently.
+     */
+    virtual std::pair<coordinate_type, bool> move_to_neighbor_unindexed(
+        VoxelPool* const& from, VoxelPool* const& loc,
+        coordinate_id_pair_type& info, const Integer nrand)
+    {
+        throw NotSupported(
+            "move_to_neighbor_unindexed is not supported by this space class");
+    }
+
+    virtual bool supports_unindexed_moves() const
+    {
+        return false;
+    }
+
     /*
      * find_voxel_pool
      */
@@ -46,6 +46,81 @@ void LatticeSpaceBase::set_lattice_properties(const bool is_periodic)
     row_size_ += 2;
     layer_size_ += 2;
     col_size_ += 2;
+
+    set_neighbor_offsets();
+}
+
+/**
+ * spread the lower 21 bits of x to every third bit.
+ */
+static inline boost::uint64_t spread_bits(boost::uint64_t x)
+{
+    x &= 0x1fffffULL;
+    x = (x | x << 32) & 0x1f00000000ffffULL;
+    x = (x | x << 16) & 0x1f0000ff0000ffULL;
+    x = (x | x << 8) & 0x100f00f00f00f00fULL;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ULL;
+    x = (x | x << 2) & 0x1249249249249249ULL;
+    return x;
+}
+
+boost::uint64_t LatticeSpaceBase::morton_key(const coordinate_type& coord) const
+{
+    const Integer NUM_COLROW(col_size_ * row_size_);
+    const Integer layer(coord / NUM_COLROW);
+    const Integer surplus(coord - layer * NUM_COLROW);
+    const Integer col(surplus / row_size_);
+    const Integer row(surplus - col * row_size_);
+    return spread_bits(row) | (spread_bits(col) << 1) | (spread_bits(layer) << 2);
+}
+
+struct morton_key_function
+    : public std::unary_function<LatticeSpaceBase::coordinate_type, boost::uint64_t>
+{
+    morton_key_function(const LatticeSpaceBase& space)
+        : space(space)
+    {
+        ; // do nothing
+    }
+
+    boost::uint64_t operator()(const LatticeSpaceBase::coordinate_type& coord) const
+    {
+        return space.morton_key(coord);
+    }
+
+    const LatticeSpaceBase& space;
+};
+
+void LatticeSpaceBase::sort_voxels(const Species& sp)
+{
+    find_molecule_pool(sp)->sort_voxels(morton_key_function(*this));
+}
+
+void LatticeSpaceBase::set_neighbor_offsets()
+{
+    const Integer NUM_COLROW(col_size_ * row_size_);
+    const Integer NUM_ROW(row_size_);
+
+    for (Integer odd_col(0); odd_col < 2; ++odd_col)
+    {
+        for (Integer odd_lay(0); odd_lay < 2; ++odd_lay)
+        {
+            Integer* offsets(neighbor_offsets_[2 * odd_col + odd_lay]);
+            const Integer shift(odd_col ^ odd_lay);
+            offsets[0] = -1;
+            offsets[1] = +1;
+            offsets[2] = shift - NUM_ROW - 1;
+            offsets[3] = shift - NUM_ROW;
+            offsets[4] = shift + NUM_ROW - 1;
+            offsets[5] = shift + NUM_ROW;
+            offsets[6] = -(2 * odd_col - 1) * NUM_COLROW - NUM_ROW;
+            offsets[7] = -(2 * odd_col - 1) * NUM_COLROW + NUM_ROW;
+            offsets[8] = shift - NUM_COLROW - 1;
+            offsets[9] = shift - NUM_COLROW;
+            offsets[10] = shift + NUM_COLROW - 1;
+            offsets[11] = shift + NUM_COLROW;
+        }
+    }
 }
 
 } // ecell4
@@ -1,6 +1,8 @@
 #ifndef ECELL4_LATTICE_SPACE_BASE_HPP
 #define ECELL4_LATTICE_SPACE_BASE_HPP
 
+#include <functional>
+#include <boost/cstdint.hpp>
 #include "LatticeSpace.hpp"
 
 namespace ecell4
@@ -145,45 +147,55 @@ public:
         return 12;
     }
 
+    /**
+     * the offsets to the neighbors depend only on the parities of
+     * the column and the layer, and are looked up from the tables built
+     * in set_lattice_properties() instead of the following switch:
+     *   odd_col = ((coord % NUM_COLROW) / NUM_ROW) & 1
+     *   odd_lay = (coord / NUM_COLROW) & 1
+     *   0: coord - 1
+     *   1: coord + 1
+     *   2: coord + (odd_col ^ odd_lay) - NUM_ROW - 1
+     *   3: coord + (odd_col ^ odd_lay) - NUM_ROW
+     *   4: coord + (odd_col ^ odd_lay) + NUM_ROW - 1
+     *   5: coord + (odd_col ^ odd_lay) + NUM_ROW
+     *   6: coord - (2 * odd_col - 1) * NUM_COLROW - NUM_ROW
+     *   7: coord - (2 * odd_col - 1) * NUM_COLROW + NUM_ROW
+     *   8: coord + (odd_col ^ odd_lay) - NUM_COLROW - 1
+     *   9: coord + (odd_col ^ odd_lay) - NUM_COLROW
+     *  10: coord + (odd_col ^ odd_lay) + NUM_COLROW - 1
+     *  11: coord + (odd_col ^ odd_lay) + NUM_COLROW
+     */
     coordinate_type get_neighbor(
         const coordinate_type& coord, const Integer& nrand) const
     {
         const Integer NUM_COLROW(col_size_ * row_size_);
-        const Integer NUM_ROW(row_size_);
-        const bool odd_col(((coord % NUM_COLROW) / NUM_ROW) & 1);
-        const bool odd_lay((coord / NUM_COLROW) & 1);
-
-        if (!is_inside(coord))
+        const Integer layer(coord / NUM_COLROW);
+        const Integer surplus(coord - layer * NUM_COLROW);
+        const Integer col(surplus / row_size_);
+        const Integer row(surplus - col * row_size_);
+
+        if (layer < 1 || layer >= layer_size_ - 1
+            || col < 1 || col >= col_size_ - 1
+            || row < 1 || row >= row_size_ - 1)
             throw NotFound("There is no neighbor voxel.");
+        if (nrand < 0 || nrand >= 12)
+            throw NotFound("Invalid argument: nrand");
 
-        switch (nrand)
-        {
-        case 0:
-            return coord - 1;
-        case 1:
-            return coord + 1;
-        case 2:
-            return coord + (odd_col ^ odd_lay) - NUM_ROW - 1;
-        case 3:
-            return coord + (odd_col ^ odd_lay) - NUM_ROW;
-        case 4:
-            return coord + (odd_col ^ odd_lay) + NUM_ROW - 1;
-        case 5:
-            return coord + (odd_col ^ odd_lay) + NUM_ROW;
-        case 6:
-            return coord - (2 * odd_col - 1) * NUM_COLROW - NUM_ROW;
-        case 7:
-            return coord - (2 * odd_col - 1) * NUM_COLROW + NUM_ROW;
-        case 8:
-            return coord + (odd_col ^ odd_lay) - NUM_COLROW - 1;
-        case 9:
-            return coord + (odd_col ^ odd_lay) - NUM_COLROW;
-        case 10:
-            return coord + (odd_col ^ odd_lay) + NUM_COLROW - 1;
-        case 11:
-            return coord + (odd_col ^ odd_lay) + NUM_COLROW;
-        }
-        throw NotFound("Invalid argument: nrand");
+        return coord + neighbor_offsets_[2 * (col & 1) + (layer & 1)][nrand];
+    }
+
+    /**
+     * get_neighbor without the checks, for a coordinate known to be
+     * inside, e.g. the one of a molecule, and 0 <= nrand < 12.
+     */
+    inline coordinate_type get_neighbor_unsafe(
+        const coordinate_type& coord, const Integer& nrand) const
+    {
+        const Integer NUM_COLROW(col_size_ * row_size_);
+        const Integer layer(coord / NUM_COLROW);
+        const Integer col((coord - layer * NUM_COLROW) / row_size_);
+        return coord + neighbor_offsets_[2 * (col & 1) + (layer & 1)][nrand];
     }
 
     coordinate_type periodic_transpose(
@@ -237,12 +249,32 @@ public:
         return Integer3(col_size(), row_size(), layer_size());
     }
 
+    /**
+     * the Morton (Z-order) key of a voxel, which interleaves the bits of
+     * its column, row and layer. voxels close in the key are close in space.
+     */
+    boost::uint64_t morton_key(const coordinate_type& coord) const;
+
+    /**
+     * sort the molecules by the Morton key of their voxels.
+     */
+    virtual void sort_voxels(const Species& sp);
+
+
+protected:
+
+    void set_neighbor_offsets();
 
 protected:
 
     Real3 edge_lengths_;
     Real HCP_L, HCP_X, HCP_Y;
     Integer row_size_, layer_size_, col_size_;
+
+    /**
+     * the offsets to the 12 neighbors for each 2 * odd_col + odd_lay.
+     */
+    Integer neighbor_offsets_[4][12];
 };
 
 } // ecell4
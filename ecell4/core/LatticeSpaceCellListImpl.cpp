@@ -280,7 +280,7 @@ std::pair<LatticeSpaceCellListImpl::coordinate_type, bool>
         LatticeSpaceCellListImpl::coordinate_id_pair_type& info, const Integer nrand)
 {
     const coordinate_type from(info.coordinate);
-    coordinate_type to(get_neighbor(from, nrand));
+    coordinate_type to(get_neighbor_unsafe(from, nrand)); // a molecule is never on the border
 
     VoxelPool* to_vp(get_voxel_pool_at(to));
 
@@ -305,7 +305,8 @@ std::pair<LatticeSpaceCellListImpl::coordinate_type, bool>
         }
     }
 
-    info.coordinate = to; //XXX: updating data
+    from_vp->replace_voxel(from, to); // keeps the indexes of from_vp
+    info.coordinate = to; //XXX: info may be a copy
 
     to_vp->replace_voxel(to, from);
 
@@ -5,12 +5,16 @@
 #include "InterfaceType.hpp"
 #include "LatticeSpaceVectorImpl.hpp"
 
+#include <algorithm>
+#include <limits>
+
 namespace ecell4 {
 
 LatticeSpaceVectorImpl::LatticeSpaceVectorImpl(
     const Real3& edge_lengths, const Real& voxel_radius,
-    const bool is_periodic) :
-    base_type(edge_lengths, voxel_radius, is_periodic), is_periodic_(is_periodic)
+    const bool is_periodic, const bool use_coordinate_table) :
+    base_type(edge_lengths, voxel_radius, is_periodic), is_periodic_(is_periodic),
+    use_coordinate_table_(use_coordinate_table)
 {
     vacant_ = &(VacantType::getInstance());
     std::stringstream ss;
@@ -35,26 +39,56 @@ void LatticeSpaceVectorImpl::initialize_voxels(const bool is_periodic)
 
     voxel_pools_.clear();
     molecule_pools_.clear();
+    voxel_pool_table_.clear();
+    voxel_pool_indexes_.clear();
+
+    const voxel_pool_index_type vacant(voxel_pool_index_(vacant_));
+    const voxel_pool_index_type boundary(
+        voxel_pool_index_(is_periodic ? periodic_ : border_));
+
     voxels_.clear();
     voxels_.reserve(voxel_size);
     for (coordinate_type coord(0); coord < voxel_size; ++coord)
     {
-        if (!is_inside(coord))
-        {
-            if (is_periodic)
-            {
-                voxels_.push_back(periodic_);
-            }
-            else
-            {
-                voxels_.push_back(border_);
-            }
-        }
-        else
-        {
-            voxels_.push_back(vacant_);
-        }
+        voxels_.push_back(is_inside(coord) ? vacant : boundary);
     }
+    // released until a molecule pool is created again
+    MoleculePool::coordinate_table_type().swap(coordinate_table_);
+}
+
+void LatticeSpaceVectorImpl::attach_coordinate_table_(MoleculePool& pool)
+{
+    if (!use_coordinate_table_)
+    {
+        return;
+    }
+
+    if (coordinate_table_.empty())
+    {
+        coordinate_table_.assign(voxels_.size(), 0);
+    }
+    pool.use_coordinate_table(&coordinate_table_);
+}
+
+LatticeSpaceVectorImpl::voxel_pool_index_type
+    LatticeSpaceVectorImpl::voxel_pool_index_(const VoxelPool* vp)
+{
+    voxel_pool_index_map_type::const_iterator itr(voxel_pool_indexes_.find(vp));
+    if (itr != voxel_pool_indexes_.end())
+    {
+        return (*itr).second;
+    }
+
+    // the pools are never removed until the voxels are initialized.
+    if (voxel_pool_table_.size() > std::numeric_limits<voxel_pool_index_type>::max())
+    {
+        throw IllegalState("Too many voxel pools for the compact voxel encoding.");
+    }
+
+    const voxel_pool_index_type idx(voxel_pool_table_.size());
+    voxel_pool_table_.push_back(const_cast<VoxelPool*>(vp));
+    voxel_pool_indexes_.insert(voxel_pool_index_map_type::value_type(vp, idx));
+    return idx;
 }
 
 Integer LatticeSpaceVectorImpl::num_species() const
@@ -127,7 +161,7 @@ LatticeSpaceVectorImpl::get_voxel(const ParticleID& pid) const
 std::pair<ParticleID, Voxel>
 LatticeSpaceVectorImpl::get_voxel_at(const coordinate_type& coord) const
 {
-    const VoxelPool* vp(voxels_[coord]);
+    const VoxelPool* vp(voxel_pool_table_[voxels_[coord]]);
     const std::string loc((vp->location()->is_vacant())
         ? "" : vp->location()->species().serial());
     return std::make_pair(
@@ -254,7 +288,7 @@ LatticeSpaceVectorImpl::list_voxels() const
         for (voxel_container::const_iterator i(voxels_.begin());
              i != voxels_.end(); ++i)
         {
-            if (*i != vp.get())
+            if (voxel_pool_table_[*i] != vp.get())
             {
                 continue;
             }
@@ -284,7 +318,7 @@ LatticeSpaceVectorImpl::list_voxels_exact(const Species& sp) const
             for (voxel_container::const_iterator i(voxels_.begin());
                  i != voxels_.end(); ++i)
             {
-                if (*i != vp.get())
+                if (voxel_pool_table_[*i] != vp.get())
                 {
                     continue;
                 }
@@ -339,7 +373,7 @@ LatticeSpaceVectorImpl::list_voxels(const Species& sp) const
         for (voxel_container::const_iterator i(voxels_.begin());
              i != voxels_.end(); ++i)
         {
-            if (*i != vp.get())
+            if (voxel_pool_table_[*i] != vp.get())
             {
                 continue;
             }
@@ -452,7 +486,7 @@ const MoleculePool* LatticeSpaceVectorImpl::find_molecule_pool(const Species& sp
 bool LatticeSpaceVectorImpl::on_structure(const Voxel& v)
 {
     // return find_voxel_pool(v.coordinate()) != get_voxel_pool(v)->location();
-    return voxels_.at(v.coordinate()) != get_voxel_pool(v)->location();
+    return voxel_pool_table_[voxels_.at(v.coordinate())] != get_voxel_pool(v)->location();
 }
 
 /*
@@ -466,13 +500,10 @@ LatticeSpaceVectorImpl::coordinate_type LatticeSpaceVectorImpl::get_coord(
          itr != molecule_pools_.end(); ++itr)
     {
         const boost::shared_ptr<MoleculePool>& vp((*itr).second);
-        for (MoleculePool::const_iterator vitr(vp->begin());
-             vitr != vp->end(); ++vitr)
+        MoleculePool::const_iterator vitr(vp->find(pid));
+        if (vitr != vp->end())
         {
-            if ((*vitr).pid == pid)
-            {
-                return (*vitr).coordinate;
-            }
+            return (*vitr).coordinate;
         }
     }
     return -1; //XXX: a bit dirty way
@@ -480,7 +511,7 @@ LatticeSpaceVectorImpl::coordinate_type LatticeSpaceVectorImpl::get_coord(
 
 VoxelPool* LatticeSpaceVectorImpl::get_voxel_pool_at(const coordinate_type& coord) const
 {
-    return voxels_.at(coord);
+    return voxel_pool_table_[voxels_.at(coord)];
 }
 
 // bool LatticeSpaceVectorImpl::has_species_exact(const Species& sp) const
@@ -509,8 +540,7 @@ bool LatticeSpaceVectorImpl::remove_voxel(const ParticleID& pid)
                 return false;
             }
 
-            voxel_container::iterator itr(voxels_.begin() + coord);
-            (*itr) = vp->location();
+            set_voxel_pool_at_(coord, vp->location());
             vp->location()->add_voxel(
                 coordinate_id_pair_type(ParticleID(), coord));
             return true;
@@ -521,15 +551,14 @@ bool LatticeSpaceVectorImpl::remove_voxel(const ParticleID& pid)
 
 bool LatticeSpaceVectorImpl::remove_voxel(const coordinate_type& coord)
 {
-    voxel_container::iterator itr(voxels_.begin() + coord);
-    VoxelPool* vp(*itr);
+    VoxelPool* vp(voxel_pool_table_[voxels_.at(coord)]);
     if (vp->is_vacant())
     {
         return false;
     }
     if (vp->remove_voxel_if_exists(coord))
     {
-        (*itr) = vp->location();
+        set_voxel_pool_at_(coord, vp->location());
         vp->location()->add_voxel(
             coordinate_id_pair_type(ParticleID(), coord));
         return true;
@@ -549,17 +578,17 @@ bool LatticeSpaceVectorImpl::can_move(
     if (src == dest)
         return false;
 
-    const VoxelPool* src_vp(voxels_.at(src));
+    const VoxelPool* src_vp(voxel_pool_table_[voxels_.at(src)]);
     if (src_vp->is_vacant())
         return false;
 
-    VoxelPool* dest_vp(voxels_.at(dest));
+    const VoxelPool* dest_vp(voxel_pool_table_[voxels_.at(dest)]);
 
     if (dest_vp == border_)
         return false;
 
     if (dest_vp == periodic_)
-        dest_vp = voxels_.at(apply_boundary_(dest));
+        dest_vp = voxel_pool_table_[voxels_.at(apply_boundary_(dest))];
 
     return (dest_vp == src_vp->location());
 }
@@ -591,13 +620,13 @@ std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
         return std::pair<coordinate_type, bool>(from, false);
     }
 
-    VoxelPool* from_vp(voxels_.at(from));
+    VoxelPool* from_vp(voxel_pool_table_[voxels_.at(from)]);
     if (from_vp->is_vacant())
     {
         return std::pair<coordinate_type, bool>(from, true);
     }
 
-    VoxelPool* to_vp(voxels_.at(to));
+    VoxelPool* to_vp(voxel_pool_table_[voxels_.at(to)]);
 
     if (to_vp == border_)
     {
@@ -607,7 +636,7 @@ std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
     else if (to_vp == periodic_)
     {
         to = apply_boundary_(to);
-        to_vp = voxels_.at(to);
+        to_vp = voxel_pool_table_[voxels_.at(to)];
     }
 
     if (to_vp != from_vp->location())
@@ -617,13 +646,9 @@ std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
     }
 
     from_vp->replace_voxel(from, to, candidate);
-    voxel_container::iterator from_itr(voxels_.begin() + from);
-    (*from_itr) = to_vp;
-
     // to_vp->replace_voxel(to, coordinate_id_pair_type(ParticleID(), from));
     to_vp->replace_voxel(to, from);
-    voxel_container::iterator to_itr(voxels_.begin() + to);
-    (*to_itr) = from_vp;
+    std::swap(voxels_[from], voxels_[to]);
 
     return std::pair<coordinate_type, bool>(to, true);
 }
@@ -638,13 +663,13 @@ std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
         return std::pair<coordinate_type, bool>(from, false);
     }
 
-    VoxelPool* from_vp(voxels_.at(from));
+    VoxelPool* from_vp(voxel_pool_table_[voxels_.at(from)]);
     if (from_vp->is_vacant())
     {
         return std::pair<coordinate_type, bool>(from, true);
     }
 
-    VoxelPool* to_vp(voxels_.at(to));
+    VoxelPool* to_vp(voxel_pool_table_[voxels_.at(to)]);
 
     if (to_vp == border_)
     {
@@ -653,7 +678,7 @@ std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
     else if (to_vp == periodic_)
     {
         to = apply_boundary_(to);
-        to_vp = voxels_.at(to);
+        to_vp = voxel_pool_table_[voxels_.at(to)];
     }
 
     if (to_vp != from_vp->location())
@@ -661,14 +686,12 @@ std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
         return std::pair<coordinate_type, bool>(to, false);
     }
 
-    info.coordinate = to;
-    voxel_container::iterator from_itr(voxels_.begin() + from);
-    (*from_itr) = to_vp;
+    from_vp->replace_voxel(from, to); // keeps the indexes of from_vp
+    info.coordinate = to; //XXX: info may be a copy
 
     // to_vp->replace_voxel(to, coordinate_id_pair_type(ParticleID(), from));
     to_vp->replace_voxel(to, from);
-    voxel_container::iterator to_itr(voxels_.begin() + to);
-    (*to_itr) = from_vp;
+    std::swap(voxels_[from], voxels_[to]);
 
     return std::pair<coordinate_type, bool>(to, true);
 }
@@ -677,15 +700,34 @@ std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
     LatticeSpaceVectorImpl::move_to_neighbor(
         VoxelPool* const& from_vp, VoxelPool* const& loc,
         coordinate_id_pair_type& info, const Integer nrand)
+{
+    // info may be the entry in from_vp, which must be found at the old
+    // coordinate by replace_voxel.
+    const coordinate_type from(info.coordinate);
+    coordinate_id_pair_type moved(info);
+    const std::pair<coordinate_type, bool>
+        retval(move_to_neighbor_unindexed(from_vp, loc, moved, nrand));
+    if (retval.second)
+    {
+        from_vp->replace_voxel(from, retval.first); // keeps the indexes of from_vp
+        info.coordinate = retval.first; //XXX: info may be a copy
+    }
+    return retval;
+}
+
+std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
+    LatticeSpaceVectorImpl::move_to_neighbor_unindexed(
+        VoxelPool* const& from_vp, VoxelPool* const& loc,
+        coordinate_id_pair_type& info, const Integer nrand)
 {
     const coordinate_type from(info.coordinate);
-    coordinate_type to(get_neighbor(from, nrand));
+    coordinate_type to(get_neighbor_unsafe(from, nrand)); // a molecule is never on the border
 
     //XXX: assert(from != to);
     //XXX: assert(from_vp == voxels_[from]);
     //XXX: assert(from_vp != vacant_);
 
-    VoxelPool* to_vp(voxels_[to]);
+    VoxelPool* to_vp(voxel_pool_table_[voxels_[to]]);
 
     if (to_vp != loc)
     {
@@ -700,7 +742,7 @@ std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
 
         // to_vp == periodic_
         to = apply_boundary_(to);
-        to_vp = voxels_[to];
+        to_vp = voxel_pool_table_[voxels_[to]];
 
         if (to_vp != loc)
         {
@@ -708,9 +750,8 @@ std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
         }
     }
 
-    voxels_[from] = to_vp;
-    voxels_[to] = from_vp;
-    info.coordinate = to; //XXX: updating data
+    std::swap(voxels_[from], voxels_[to]);
+    info.coordinate = to; //XXX: info may be a copy
 
     to_vp->replace_voxel(to, from);
     // if (to_vp != vacant_) // (!to_vp->is_vacant())
@@ -724,7 +765,7 @@ std::pair<LatticeSpaceVectorImpl::coordinate_type, bool>
 const Particle LatticeSpaceVectorImpl::particle_at(
     const coordinate_type& coord) const
 {
-    const VoxelPool* vp(voxels_.at(coord));
+    const VoxelPool* vp(voxel_pool_table_[voxels_.at(coord)]);
     return Particle(
         vp->species(),
         coordinate2position(coord),
@@ -850,17 +891,15 @@ bool LatticeSpaceVectorImpl::update_voxel(const ParticleID& pid, const Voxel& v)
     if (from_coord != -1)
     {
         // move
-        VoxelPool* src_vp(voxels_.at(from_coord));
+        VoxelPool* src_vp(voxel_pool_table_[voxels_.at(from_coord)]);
         src_vp->remove_voxel_if_exists(from_coord);
 
         //XXX: use location?
         dest_vp->replace_voxel(to_coord, from_coord);
-        voxel_container::iterator from_itr(voxels_.begin() + from_coord);
-        (*from_itr) = dest_vp;
+        set_voxel_pool_at_(from_coord, dest_vp);
 
         new_vp->add_voxel(coordinate_id_pair_type(pid, to_coord));
-        voxel_container::iterator to_itr(voxels_.begin() + to_coord);
-        (*to_itr) = new_vp;
+        set_voxel_pool_at_(to_coord, new_vp);
         return false;
     }
 
@@ -868,8 +907,7 @@ bool LatticeSpaceVectorImpl::update_voxel(const ParticleID& pid, const Voxel& v)
     dest_vp->remove_voxel_if_exists(to_coord);
 
     new_vp->add_voxel(coordinate_id_pair_type(pid, to_coord));
-    voxel_container::iterator to_itr(voxels_.begin() + to_coord);
-    (*to_itr) = new_vp;
+    set_voxel_pool_at_(to_coord, new_vp);
     return true;
 }
 
@@ -910,6 +948,7 @@ bool LatticeSpaceVectorImpl::make_structure_type(const Species& sp,
             // XXX: created with default arguments.
             boost::shared_ptr<MoleculePool>
                 locmt(new MolecularType(locsp, vacant_, voxel_radius_, 0));
+            attach_coordinate_table_(*locmt);
             std::pair<molecule_pool_map_type::iterator, bool>
                 locval(molecule_pools_.insert(
                     molecule_pool_map_type::value_type(locsp, locmt)));
@@ -970,6 +1009,7 @@ bool LatticeSpaceVectorImpl::make_interface_type(const Species& sp,
             // XXX: created with default arguments.
             boost::shared_ptr<MoleculePool>
                 locmt(new MolecularType(locsp, vacant_, voxel_radius_, 0));
+            attach_coordinate_table_(*locmt);
             std::pair<molecule_pool_map_type::iterator, bool>
                 locval(molecule_pools_.insert(
                     molecule_pool_map_type::value_type(locsp, locmt)));
@@ -1029,6 +1069,7 @@ bool LatticeSpaceVectorImpl::make_molecular_type(const Species& sp, Real radius,
             // XXX: created with default arguments.
             boost::shared_ptr<MoleculePool>
                 locmt(new MolecularType(locsp, vacant_, voxel_radius_, 0));
+            attach_coordinate_table_(*locmt);
             std::pair<molecule_pool_map_type::iterator, bool>
                 locval(molecule_pools_.insert(
                     molecule_pool_map_type::value_type(locsp, locmt)));
@@ -1043,6 +1084,7 @@ bool LatticeSpaceVectorImpl::make_molecular_type(const Species& sp, Real radius,
 
     boost::shared_ptr<MoleculePool>
         vp(new MolecularType(sp, location, radius, D));
+    attach_coordinate_table_(*vp);
     std::pair<molecule_pool_map_type::iterator, bool>
         retval(molecule_pools_.insert(
             molecule_pool_map_type::value_type(sp, vp)));
@@ -1073,16 +1115,20 @@ bool LatticeSpaceVectorImpl::add_voxels(const Species sp, std::vector<std::pair<
         VoxelPool* src_vp(get_voxel_pool_at(coord));
         src_vp->remove_voxel_if_exists(coord);
         mtb->add_voxel(coordinate_id_pair_type(pid, coord));
-        voxel_container::iterator vitr(voxels_.begin() + coord);
-        (*vitr) = mtb;
+        set_voxel_pool_at_(coord, mtb);
     }
     return true;
 }
 
 Integer LatticeSpaceVectorImpl::count_voxels(const boost::shared_ptr<VoxelPool>& vp) const
 {
+    voxel_pool_index_map_type::const_iterator itr(voxel_pool_indexes_.find(vp.get()));
+    if (itr == voxel_pool_indexes_.end())
+    {
+        return 0; // never placed
+    }
     return static_cast<Integer>(
-        std::count(voxels_.begin(), voxels_.end(), vp.get()));
+        std::count(voxels_.begin(), voxels_.end(), (*itr).second));
 }
 
 } // ecell4
@@ -1,6 +1,7 @@
 #ifndef ECELL4_LATTICE_SPACE_VECTOR_IMPL_HPP
 #define ECELL4_LATTICE_SPACE_VECTOR_IMPL_HPP
 
+#include <boost/cstdint.hpp>
 #include "LatticeSpaceBase.hpp"
 
 namespace ecell4 {
@@ -15,10 +16,19 @@ public:
     typedef base_type::coordinate_id_pair_type coordinate_id_pair_type;
     typedef base_type::coordinate_type coordinate_type;
 
-    typedef std::vector<VoxelPool*> voxel_container;
+    /**
+     * each voxel holds a 16-bit index to voxel_pool_table_ instead of
+     * an 8-byte pointer to the pool. with the coordinate table, which adds
+     * 4 bytes, a voxel costs 6 bytes in total, and 2 bytes without it.
+     */
+    typedef boost::uint16_t voxel_pool_index_type;
+    typedef std::vector<voxel_pool_index_type> voxel_container;
+    typedef std::vector<VoxelPool*> voxel_pool_table_type;
 
 protected:
 
+    typedef utils::get_mapper_mf<
+        const VoxelPool*, voxel_pool_index_type>::type voxel_pool_index_map_type;
     typedef utils::get_mapper_mf<
         Species, boost::shared_ptr<VoxelPool> >::type voxel_pool_map_type;
     typedef utils::get_mapper_mf<
@@ -26,9 +36,16 @@ protected:
 
 public:
 
+    /**
+     * with use_coordinate_table, the molecule pools share a flat table
+     * from a coordinate to the position in a pool, which makes a move
+     * cheaper than with the hash map in each pool. the table costs 4 bytes
+     * per voxel, whether occupied or not, and is allocated when the first
+     * molecule pool is created. turn it off for a large and sparse lattice.
+     */
     LatticeSpaceVectorImpl(
         const Real3& edge_lengths, const Real& voxel_radius,
-        const bool is_periodic = true);
+        const bool is_periodic = true, const bool use_coordinate_table = true);
     ~LatticeSpaceVectorImpl();
 
     /*
@@ -116,12 +133,20 @@ public:
     std::pair<coordinate_type, bool> move_to_neighbor(
         VoxelPool* const& from_vp, VoxelPool* const& loc,
         coordinate_id_pair_type& info, const Integer nrand);
+    std::pair<coordinate_type, bool> move_to_neighbor_unindexed(
+        VoxelPool* const& from_vp, VoxelPool* const& loc,
+        coordinate_id_pair_type& info, const Integer nrand);
+
+    bool supports_unindexed_moves() const
+    {
+        return true;
+    }
 
     coordinate_type get_neighbor_boundary(
         const coordinate_type& coord, const Integer& nrand) const
     {
         coordinate_type const dest = get_neighbor(coord, nrand);
-        VoxelPool* dest_vp(voxels_.at(dest));
+        const VoxelPool* dest_vp(voxel_pool_table_[voxels_.at(dest)]);
         return (dest_vp != periodic_ ? dest : periodic_transpose(dest));
     }
 
@@ -187,13 +212,26 @@ protected:
 
     Integer count_voxels(const boost::shared_ptr<VoxelPool>& vp) const;
 
+    voxel_pool_index_type voxel_pool_index_(const VoxelPool* vp);
+
+    void set_voxel_pool_at_(const coordinate_type& coord, const VoxelPool* vp)
+    {
+        voxels_[coord] = voxel_pool_index_(vp);
+    }
+
+    void attach_coordinate_table_(MoleculePool& pool);
+
 protected:
 
     bool is_periodic_;
+    bool use_coordinate_table_;
 
     voxel_pool_map_type voxel_pools_;
     molecule_pool_map_type molecule_pools_;
     voxel_container voxels_;
+    voxel_pool_table_type voxel_pool_table_;
+    voxel_pool_index_map_type voxel_pool_indexes_;
+    MoleculePool::coordinate_table_type coordinate_table_; // shared by molecule_pools_, if any
 
     VoxelPool* vacant_;
     VoxelPool* border_;
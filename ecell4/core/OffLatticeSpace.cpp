@@ -106,13 +106,10 @@ OffLatticeSpace::get_coord(const ParticleID& pid) const
          itr != molecule_pools_.end(); ++itr)
     {
         const boost::shared_ptr<MoleculePool>& vp((*itr).second);
-        for (MoleculePool::const_iterator vitr(vp->begin());
-             vitr != vp->end(); ++vitr)
+        MoleculePool::const_iterator vitr(vp->find(pid));
+        if (vitr != vp->end())
         {
-            if ((*vitr).pid == pid)
-            {
-                return (*vitr).coordinate;
-            }
+            return (*vitr).coordinate;
         }
     }
     // throw NotFound("A corresponding particle is not found");
@@ -2,6 +2,7 @@
 #define ECELL4_PARTICLE_HPP
 
 #include <map>
+#include <boost/cstdint.hpp>
 
 #include <ecell4/core/config.h>
 
@@ -140,6 +141,21 @@ private:
     Real radius_, D_;
 };
 
+/**
+ * a trivially copyable counterpart of Particle for the particle stores.
+ * the species is referred to by an id interned by the space holding it,
+ * instead of a Species with its serial and attributes.
+ */
+struct ParticleRecord
+{
+    typedef boost::uint32_t species_id_type;
+
+    Real3 position;
+    Real radius;
+    Real D;
+    species_id_type species_id;
+};
+
 template<typename Tstrm_, typename Ttraits_>
 inline std::basic_ostream<Tstrm_, Ttraits_>& operator<<(std::basic_ostream<Tstrm_, Ttraits_>& strm, const Particle& p)
 {
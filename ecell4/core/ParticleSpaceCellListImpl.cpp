@@ -9,9 +9,13 @@ namespace ecell4
 void ParticleSpaceCellListImpl::reset(const Real3& edge_lengths)
 {
     base_type::t_ = 0.0;
-    particles_.clear();
+    records_.clear();
     rmap_.clear();
     particle_pool_.clear();
+    species_table_.clear();
+    species_ids_.clear();
+    particles_.clear();
+    particles_is_valid_ = true;
 
     for (matrix_type::size_type i(0); i < matrix_.shape()[0]; ++i)
     {
@@ -36,22 +40,57 @@ void ParticleSpaceCellListImpl::reset(const Real3& edge_lengths)
     // throw NotImplemented("Not implemented yet.");
 }
 
+ParticleSpaceCellListImpl::species_id_type
+    ParticleSpaceCellListImpl::intern_species(const Species& sp)
+{
+    species_id_map_type::const_iterator i(species_ids_.find(sp.serial()));
+    if (i != species_ids_.end())
+    {
+        return (*i).second;
+    }
+
+    const species_id_type sid(species_table_.size());
+    species_table_.push_back(sp);
+    species_ids_.insert(std::make_pair(sp.serial(), sid));
+    return sid;
+}
+
+const ParticleSpaceCellListImpl::particle_container_type&
+    ParticleSpaceCellListImpl::particles() const
+{
+    if (!particles_is_valid_)
+    {
+        particles_.clear();
+        particles_.reserve(records_.size());
+        for (record_container_type::const_iterator i(records_.begin());
+            i != records_.end(); ++i)
+        {
+            particles_.push_back(std::make_pair((*i).first, to_particle((*i).second)));
+        }
+        particles_is_valid_ = true;
+    }
+    return particles_;
+}
+
 bool ParticleSpaceCellListImpl::update_particle(
     const ParticleID& pid, const Particle& p)
 {
-    particle_container_type::iterator i(find(pid));
-    if (i != particles_.end())
+    particles_is_valid_ = false;
+
+    const ParticleRecord r(to_record(p));
+    record_container_type::iterator i(find(pid));
+    if (i != records_.end())
     {
-        if ((*i).second.species() != p.species())
+        if ((*i).second.species_id != r.species_id)
         {
-            particle_pool_[(*i).second.species_serial()].erase((*i).first);
+            particle_pool_[species_table_[(*i).second.species_id].serial()].erase((*i).first);
             particle_pool_[p.species_serial()].insert(pid);
         }
-        this->update(i, std::make_pair(pid, p));
+        this->update(i, std::make_pair(pid, r));
         return false;
     }
 
-    this->update(std::make_pair(pid, p));
+    this->update(std::make_pair(pid, r));
     // const bool succeeded(this->update(std::make_pair(pid, p)).second);
     // BOOST_ASSERT(succeeded);
 
@@ -59,20 +98,39 @@ bool ParticleSpaceCellListImpl::update_particle(
     return true;
 }
 
+void ParticleSpaceCellListImpl::move_particle(
+    const ParticleID& pid, const Real3& pos)
+{
+    record_container_type::iterator i(find(pid));
+    if (i == records_.end())
+    {
+        throw NotFound("No such particle.");
+    }
+
+    if (particles_is_valid_)
+    {
+        particles_is_valid_ = false;
+    }
+
+    std::pair<ParticleID, ParticleRecord> v(*i);
+    v.second.position = pos;
+    this->update(i, v);
+}
+
 std::pair<ParticleID, Particle> ParticleSpaceCellListImpl::get_particle(
     const ParticleID& pid) const
 {
-    particle_container_type::const_iterator i(this->find(pid));
-    if (i == particles_.end())
+    record_container_type::const_iterator i(this->find(pid));
+    if (i == records_.end())
     {
         throw NotFound("No such particle.");
     }
-    return (*i);
+    return std::make_pair((*i).first, to_particle((*i).second));
 }
 
 bool ParticleSpaceCellListImpl::has_particle(const ParticleID& pid) const
 {
-    return (this->find(pid) != particles_.end());
+    return (this->find(pid) != records_.end());
 }
 
 void ParticleSpaceCellListImpl::remove_particle(const ParticleID& pid)
@@ -80,14 +138,19 @@ void ParticleSpaceCellListImpl::remove_particle(const ParticleID& pid)
     //XXX: In contrast to the original ParticleContainer in epdp,
     //XXX: this remove_particle throws an error when no corresponding
     //XXX: particle is found.
-    std::pair<ParticleID, Particle> pp(get_particle(pid)); //XXX: may raise an error.
-    particle_pool_[pp.second.species_serial()].erase(pid);
+    record_container_type::const_iterator i(this->find(pid));
+    if (i == records_.end())
+    {
+        throw NotFound("No such particle.");
+    }
+    particles_is_valid_ = false;
+    particle_pool_[species_table_[(*i).second.species_id].serial()].erase(pid);
     this->erase(pid);
 }
 
 Integer ParticleSpaceCellListImpl::num_particles() const
 {
-    return particles_.size();
+    return records_.size();
 }
 
 Integer ParticleSpaceCellListImpl::num_particles(const Species& sp) const
@@ -137,7 +200,19 @@ Integer ParticleSpaceCellListImpl::num_molecules_exact(const Species& sp) const
 std::vector<std::pair<ParticleID, Particle> >
     ParticleSpaceCellListImpl::list_particles() const
 {
-    return particles_;
+    if (particles_is_valid_)
+    {
+        return particles_;
+    }
+
+    std::vector<std::pair<ParticleID, Particle> > retval;
+    retval.reserve(records_.size());
+    for (record_container_type::const_iterator i(records_.begin());
+        i != records_.end(); ++i)
+    {
+        retval.push_back(std::make_pair((*i).first, to_particle((*i).second)));
+    }
+    return retval;
 }
 
 std::vector<std::pair<ParticleID, Particle> >
@@ -146,12 +221,19 @@ std::vector<std::pair<ParticleID, Particle> >
     std::vector<std::pair<ParticleID, Particle> > retval;
     SpeciesExpressionMatcher sexp(sp);
 
-    for (particle_container_type::const_iterator i(particles_.begin());
-         i != particles_.end(); ++i)
+    // match each species once, not each particle
+    std::vector<bool> matched(species_table_.size());
+    for (species_id_type sid(0); sid < species_table_.size(); ++sid)
+    {
+        matched[sid] = sexp.match(species_table_[sid]);
+    }
+
+    for (record_container_type::const_iterator i(records_.begin());
+         i != records_.end(); ++i)
     {
-        if (sexp.match((*i).second.species()))
+        if (matched[(*i).second.species_id])
         {
-            retval.push_back(*i);
+            retval.push_back(std::make_pair((*i).first, to_particle((*i).second)));
         }
     }
     return retval;
@@ -172,67 +254,61 @@ std::vector<std::pair<ParticleID, Particle> >
     // }
     // retval.reserve((*i).second.size());
 
-    for (particle_container_type::const_iterator i(particles_.begin());
-         i != particles_.end(); ++i)
+    species_id_map_type::const_iterator sid(species_ids_.find(sp.serial()));
+    if (sid == species_ids_.end())
     {
-        if ((*i).second.species() == sp)
+        return retval;
+    }
+
+    for (record_container_type::const_iterator i(records_.begin());
+         i != records_.end(); ++i)
+    {
+        if ((*i).second.species_id == (*sid).second)
         {
-            retval.push_back(*i);
+            retval.push_back(std::make_pair((*i).first, to_particle((*i).second)));
         }
     }
     return retval;
 }
 
-std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
-    ParticleSpaceCellListImpl::list_particles_within_radius(
-        const Real3& pos, const Real& radius) const
+bool ParticleSpaceCellListImpl::has_particle_within_radius(
+    const Real3& pos, const Real& radius,
+    const ParticleID& ignore1, const ParticleID& ignore2) const
 {
-    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> > retval;
-
-    // MatrixSpace::each_neighbor_cyclic
-    if (particles_.size() == 0)
-    {
-        return retval;
-    }
+    detail::overlap_finder finder(ignore1, ignore2);
+    return !each_particle_within_radius(pos, radius, finder);
+}
 
-    cell_index_type idx(this->index(pos));
+Integer ParticleSpaceCellListImpl::count_particles_within_radius(
+    const Real3& pos, const Real& radius,
+    const ParticleID& ignore1, const ParticleID& ignore2) const
+{
+    detail::overlap_counter counter(ignore1, ignore2);
+    each_particle_within_radius(pos, radius, counter);
+    return counter.count;
+}
 
-    // MatrixSpace::each_neighbor_cyclic_loops
-    cell_offset_type off;
-    for (off[2] = -1; off[2] <= 1; ++off[2])
+void ParticleSpaceCellListImpl::collect_particles_within_radius(
+    const Real3& pos, const Real& radius, neighbor_container_type& neighbors,
+    const ParticleID& ignore1, const ParticleID& ignore2,
+    const bool sorted) const
+{
+    neighbors.clear();
+    detail::overlap_collector collector(neighbors, ignore1, ignore2);
+    each_particle_within_radius(pos, radius, collector);
+    if (sorted)
     {
-        for (off[1] = -1; off[1] <= 1; ++off[1])
-        {
-            for (off[0] = -1; off[0] <= 1; ++off[0])
-            {
-                cell_index_type newidx(idx);
-                const Real3 stride(this->offset_index_cyclic(newidx, off));
-                const cell_type& c(this->cell(newidx));
-                for (cell_type::const_iterator i(c.begin()); i != c.end(); ++i)
-                {
-                    // neighbor_filter::operator()
-                    particle_container_type::const_iterator
-                        itr(particles_.begin() + (*i));
-                    // particle_container_type::const_iterator itr = particles_.begin();
-                    // std::advance(itr, *i);
-
-                    const Real dist(
-                        length((*itr).second.position() + stride - pos)
-                        - (*itr).second.radius());
-                    if (dist < radius)
-                    {
-                        // overlap_checker::operator()
-                        retval.push_back(
-                            std::make_pair(*itr, dist));
-                    }
-                }
-            }
-        }
+        std::sort(neighbors.begin(), neighbors.end(),
+            utils::pair_second_element_comparator<
+                std::pair<ParticleID, ParticleRecord>, Real>());
     }
+}
 
-    std::sort(retval.begin(), retval.end(),
-        utils::pair_second_element_comparator<std::pair<ParticleID, Particle>, Real>());
-    return retval;
+std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
+    ParticleSpaceCellListImpl::list_particles_within_radius(
+        const Real3& pos, const Real& radius) const
+{
+    return list_particles_within_radius(pos, radius, ParticleID(), ParticleID());
 }
 
 std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
@@ -240,53 +316,7 @@ std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
         const Real3& pos, const Real& radius,
         const ParticleID& ignore) const
 {
-    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> > retval;
-
-    // MatrixSpace::each_neighbor_cyclic
-    if (particles_.size() == 0)
-    {
-        return retval;
-    }
-
-    cell_index_type idx(this->index(pos));
-
-    // MatrixSpace::each_neighbor_cyclic_loops
-    cell_offset_type off;
-    for (off[2] = -1; off[2] <= 1; ++off[2])
-    {
-        for (off[1] = -1; off[1] <= 1; ++off[1])
-        {
-            for (off[0] = -1; off[0] <= 1; ++off[0])
-            {
-                cell_index_type newidx(idx);
-                const Real3 stride(this->offset_index_cyclic(newidx, off));
-                const cell_type& c(this->cell(newidx));
-                for (cell_type::const_iterator i(c.begin()); i != c.end(); ++i)
-                {
-                    // neighbor_filter::operator()
-                    particle_container_type::const_iterator
-                        itr(particles_.begin() + (*i));
-
-                    const Real dist(
-                        length((*itr).second.position() + stride - pos)
-                        - (*itr).second.radius());
-                    if (dist < radius)
-                    {
-                        // overlap_checker::operator()
-                        if ((*itr).first != ignore)
-                        {
-                            retval.push_back(
-                                std::make_pair(*itr, dist));
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    std::sort(retval.begin(), retval.end(),
-        utils::pair_second_element_comparator<std::pair<ParticleID, Particle>, Real>());
-    return retval;
+    return list_particles_within_radius(pos, radius, ignore, ParticleID());
 }
 
 std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
@@ -294,52 +324,17 @@ std::vector<std::pair<std::pair<ParticleID, Particle>, Real> >
         const Real3& pos, const Real& radius,
         const ParticleID& ignore1, const ParticleID& ignore2) const
 {
-    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> > retval;
+    neighbor_container_type neighbors;
+    collect_particles_within_radius(pos, radius, neighbors, ignore1, ignore2, true);
 
-    // MatrixSpace::each_neighbor_cyclic
-    if (particles_.size() == 0)
+    std::vector<std::pair<std::pair<ParticleID, Particle>, Real> > retval;
+    retval.reserve(neighbors.size());
+    for (neighbor_container_type::const_iterator i(neighbors.begin());
+        i != neighbors.end(); ++i)
     {
-        return retval;
+        retval.push_back(std::make_pair(std::make_pair(
+            (*i).first.first, to_particle((*i).first.second)), (*i).second));
     }
-
-    cell_index_type idx(this->index(pos));
-
-    // MatrixSpace::each_neighbor_cyclic_loops
-    cell_offset_type off;
-    for (off[2] = -1; off[2] <= 1; ++off[2])
-    {
-        for (off[1] = -1; off[1] <= 1; ++off[1])
-        {
-            for (off[0] = -1; off[0] <= 1; ++off[0])
-            {
-                cell_index_type newidx(idx);
-                const Real3 stride(this->offset_index_cyclic(newidx, off));
-                const cell_type& c(this->cell(newidx));
-                for (cell_type::const_iterator i(c.begin()); i != c.end(); ++i)
-                {
-                    // neighbor_filter::operator()
-                    particle_container_type::const_iterator
-                        itr(particles_.begin() + (*i));
-
-                    const Real dist(
-                        length((*itr).second.position() + stride - pos)
-                        - (*itr).second.radius());
-                    if (dist < radius)
-                    {
-                        // overlap_checker::operator()
-                        if ((*itr).first != ignore1 && (*itr).first != ignore2)
-                        {
-                            retval.push_back(
-                                std::make_pair(*itr, dist));
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    std::sort(retval.begin(), retval.end(),
-        utils::pair_second_element_comparator<std::pair<ParticleID, Particle>, Real>());
     return retval;
 }
 
@@ -24,13 +24,26 @@ public:
     typedef ParticleSpace base_type;
     typedef ParticleSpace::particle_container_type particle_container_type;
 
-    typedef utils::get_mapper_mf<ParticleID, particle_container_type::size_type>::type
+    /**
+     * the particles are stored as ParticleRecord, and converted to
+     * Particle only at the API boundary.
+     */
+    typedef ParticleRecord::species_id_type species_id_type;
+    typedef std::vector<std::pair<ParticleID, ParticleRecord> > record_container_type;
+    typedef std::vector<Species> species_table_type;
+    typedef utils::get_mapper_mf<Species::serial_type, species_id_type>::type
+        species_id_map_type;
+
+    typedef utils::get_mapper_mf<ParticleID, record_container_type::size_type>::type
         key_to_value_map_type;
 
+    typedef std::vector<std::pair<std::pair<ParticleID, ParticleRecord>, Real> >
+        neighbor_container_type;
+
     typedef std::set<ParticleID> particle_id_set;
     typedef std::map<Species::serial_type, particle_id_set> per_species_particle_id_set;
 
-    typedef std::vector<particle_container_type::size_type> cell_type; // sorted
+    typedef std::vector<record_container_type::size_type> cell_type; // sorted
     typedef boost::multi_array<cell_type, 3> matrix_type;
     typedef boost::array<matrix_type::size_type, 3> cell_index_type;
     typedef boost::array<matrix_type::difference_type, 3> cell_offset_type;
@@ -38,7 +51,8 @@ public:
 public:
 
     ParticleSpaceCellListImpl(const Real3& edge_lengths)
-        : base_type(), edge_lengths_(edge_lengths), matrix_(boost::extents[3][3][3])
+        : base_type(), edge_lengths_(edge_lengths), particles_is_valid_(true),
+        matrix_(boost::extents[3][3][3])
     {
         cell_sizes_[0] = edge_lengths_[0] / matrix_.shape()[0];
         cell_sizes_[1] = edge_lengths_[1] / matrix_.shape()[1];
@@ -47,7 +61,7 @@ public:
 
     ParticleSpaceCellListImpl(
         const Real3& edge_lengths, const Integer3& matrix_sizes)
-        : base_type(), edge_lengths_(edge_lengths),
+        : base_type(), edge_lengths_(edge_lengths), particles_is_valid_(true),
         matrix_(boost::extents[matrix_sizes.col][matrix_sizes.row][matrix_sizes.layer])
     {
         cell_sizes_[0] = edge_lengths_[0] / matrix_.shape()[0];
@@ -66,7 +80,7 @@ public:
                     const cell_type& c = matrix_[i][j][k];
                     for (cell_type::const_iterator it(c.begin()); it != c.end(); ++it)
                     {
-                        if (*it >= particles_.size())
+                        if (*it >= records_.size())
                         {
                             throw IllegalState("out of bounds.");
                         }
@@ -115,19 +129,71 @@ public:
         return Integer3(matrix_.shape()[0], matrix_.shape()[1], matrix_.shape()[2]);
     }
 
-    void reset(const Real3& edge_lengths);
+    virtual void reset(const Real3& edge_lengths);
 
     bool update_particle(const ParticleID& pid, const Particle& p);
 
-    const particle_container_type& particles() const
+    /**
+     * move a particle to pos without changing the other properties.
+     * this touches only the record of the particle, and the cells at
+     * the old and new positions. threads can move particles at once,
+     * if no thread reads nor writes the cells written by another,
+     * and invalidate_particles() is called once before. then, the
+     * particles built before are already invalid, and no thread writes
+     * the flag.
+     */
+    virtual void move_particle(const ParticleID& pid, const Real3& pos);
+
+    /**
+     * the particles are built from the records when requested first
+     * after any change, and kept until the next change.
+     */
+    const particle_container_type& particles() const;
+
+    void invalidate_particles()
+    {
+        particles_is_valid_ = false;
+    }
+
+    /**
+     * the index of the cell at pos along each axis.
+     */
+    Integer3 cell_index(const Real3& pos) const
+    {
+        const cell_index_type i(index(pos));
+        return Integer3(i[0], i[1], i[2]);
+    }
+
+    const record_container_type& records() const
+    {
+        return records_;
+    }
+
+    const Species& get_species(const species_id_type& sid) const
     {
-        return particles_;
+        return species_table_[sid];
+    }
+
+    Particle to_particle(const ParticleRecord& r) const
+    {
+        return Particle(species_table_[r.species_id], r.position, r.radius, r.D);
     }
 
     std::pair<ParticleID, Particle> get_particle(const ParticleID& pid) const;
     bool has_particle(const ParticleID& pid) const;
     void remove_particle(const ParticleID& pid);
 
+    /**
+     * the record of a particle without a copy of Species.
+     * found is set false instead of throwing NotFound.
+     */
+    ParticleRecord get_record(const ParticleID& pid, bool& found) const
+    {
+        record_container_type::const_iterator i(this->find(pid));
+        found = (i != records_.end());
+        return (found ? (*i).second : ParticleRecord());
+    }
+
     Integer num_particles() const;
     Integer num_particles(const Species& sp) const;
     Integer num_particles_exact(const Species& sp) const;
@@ -171,8 +237,86 @@ public:
             const Real3& pos, const Real& radius,
             const ParticleID& ignore1, const ParticleID& ignore2) const;
 
+    /**
+     * call visitor(pp, dist) for each particle within the radius, where pp
+     * is a pair of the ID and the ParticleRecord, and dist is the distance
+     * between the surfaces. the visit stops when visitor returns false.
+     * nothing is allocated nor sorted.
+     * @return false if stopped by visitor
+     */
+    template<typename Tvisitor_>
+    bool each_particle_within_radius(
+        const Real3& pos, const Real& radius, Tvisitor_& visitor) const
+    {
+        if (records_.size() == 0)
+        {
+            return true;
+        }
+
+        const cell_index_type idx(this->index(pos));
+
+        cell_offset_type off;
+        for (off[2] = -1; off[2] <= 1; ++off[2])
+        {
+            for (off[1] = -1; off[1] <= 1; ++off[1])
+            {
+                for (off[0] = -1; off[0] <= 1; ++off[0])
+                {
+                    cell_index_type newidx(idx);
+                    const Real3 stride(this->offset_index_cyclic(newidx, off));
+                    const cell_type& c(this->cell(newidx));
+                    for (cell_type::const_iterator i(c.begin()); i != c.end(); ++i)
+                    {
+                        const std::pair<ParticleID, ParticleRecord>& pp(records_[*i]);
+                        const Real dist(
+                            length(pp.second.position + stride - pos)
+                            - pp.second.radius);
+                        if (dist < radius && !visitor(pp, dist))
+                        {
+                            return false;
+                        }
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * the variants of list_particles_within_radius without a copy of
+     * Particle. a default ParticleID ignores nothing.
+     * has_particle_within_radius stops at the first overlap.
+     * collect_particles_within_radius clears and fills neighbors, which
+     * can be reused by the caller, and sorts them only if requested.
+     */
+    virtual bool has_particle_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const;
+    virtual Integer count_particles_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const;
+    virtual void collect_particles_within_radius(
+        const Real3& pos, const Real& radius, neighbor_container_type& neighbors,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID(),
+        const bool sorted = false) const;
+
 protected:
 
+    species_id_type intern_species(const Species& sp);
+
+    ParticleRecord to_record(const Particle& p)
+    {
+        ParticleRecord r;
+        r.position = p.position();
+        r.radius = p.radius();
+        r.D = p.D();
+        r.species_id = intern_species(p.species());
+        return r;
+    }
+
     // inline cell_index_type index(const Real3& pos, double t = 1e-10) const
     inline cell_index_type index(const Real3& pos) const
     {
@@ -274,36 +418,36 @@ protected:
         return matrix_[i[0]][i[1]][i[2]];
     }
 
-    inline particle_container_type::iterator find(const ParticleID& k)
+    inline record_container_type::iterator find(const ParticleID& k)
     {
         key_to_value_map_type::const_iterator p(rmap_.find(k));
         if (rmap_.end() == p)
         {
-            return particles_.end();
+            return records_.end();
         }
-        return particles_.begin() + (*p).second;
+        return records_.begin() + (*p).second;
     }
 
-    inline particle_container_type::const_iterator find(const ParticleID& k) const
+    inline record_container_type::const_iterator find(const ParticleID& k) const
     {
         key_to_value_map_type::const_iterator p(rmap_.find(k));
         if (rmap_.end() == p)
         {
-            return particles_.end();
+            return records_.end();
         }
-        return particles_.begin() + (*p).second;
+        return records_.begin() + (*p).second;
     }
 
-    inline particle_container_type::iterator update(
-        particle_container_type::iterator const& old_value,
-        const std::pair<ParticleID, Particle>& v)
+    inline record_container_type::iterator update(
+        record_container_type::iterator const& old_value,
+        const std::pair<ParticleID, ParticleRecord>& v)
     {
-        cell_type* new_cell(&cell(index(v.second.position())));
+        cell_type* new_cell(&cell(index(v.second.position)));
         cell_type* old_cell(0);
 
-        if (old_value != particles_.end())
+        if (old_value != records_.end())
         {
-            old_cell = &cell(index((*old_value).second.position()));
+            old_cell = &cell(index((*old_value).second.position));
         }
 
         if (new_cell == old_cell)
@@ -314,7 +458,7 @@ protected:
         }
         else
         {
-            particle_container_type::size_type idx(0);
+            record_container_type::size_type idx(0);
 
             if (old_cell)
             {
@@ -322,35 +466,35 @@ protected:
                 *old_value = v;
 
                 cell_type::iterator
-                    i(find_in_cell(old_cell, old_value - particles_.begin()));
+                    i(find_in_cell(old_cell, old_value - records_.begin()));
                 idx = *i;
                 erase_from_cell(old_cell, i);
                 push_into_cell(new_cell, idx);
             }
             else
             {
-                idx = particles_.size();
-                particles_.push_back(v);
+                idx = records_.size();
+                records_.push_back(v);
                 push_into_cell(new_cell, idx);
                 rmap_[v.first] = idx;
             }
-            return particles_.begin() + idx;
+            return records_.begin() + idx;
         }
     }
 
-    inline std::pair<particle_container_type::iterator, bool> update(
-        const std::pair<ParticleID, Particle>& v)
+    inline std::pair<record_container_type::iterator, bool> update(
+        const std::pair<ParticleID, ParticleRecord>& v)
     {
-        cell_type* new_cell(&cell(index(v.second.position())));
-        particle_container_type::iterator old_value(particles_.end());
+        cell_type* new_cell(&cell(index(v.second.position)));
+        record_container_type::iterator old_value(records_.end());
         cell_type* old_cell(0);
 
         {
             key_to_value_map_type::const_iterator i(rmap_.find(v.first));
             if (i != rmap_.end())
             {
-                old_value = particles_.begin() + (*i).second;
-                old_cell = &cell(index(old_value->second.position()));
+                old_value = records_.begin() + (*i).second;
+                old_cell = &cell(index(old_value->second.position));
             }
         }
 
@@ -358,12 +502,12 @@ protected:
         {
             // reinterpret_cast<nonconst_value_type&>(*old_value) = v;
             *old_value = v;
-            // return std::pair<particle_container_type::iterator, bool>(old_value, false);
+            // return std::pair<record_container_type::iterator, bool>(old_value, false);
             return std::make_pair(old_value, false);
         }
         else
         {
-            particle_container_type::size_type idx(0);
+            record_container_type::size_type idx(0);
 
             if (old_cell)
             {
@@ -371,45 +515,45 @@ protected:
                 *old_value = v;
 
                 cell_type::iterator
-                    i(find_in_cell(old_cell, old_value - particles_.begin()));
+                    i(find_in_cell(old_cell, old_value - records_.begin()));
                 idx = *i;
                 erase_from_cell(old_cell, i);
                 push_into_cell(new_cell, idx);
-                return std::pair<particle_container_type::iterator, bool>(
-                    particles_.begin() + idx, false);
+                return std::pair<record_container_type::iterator, bool>(
+                    records_.begin() + idx, false);
             }
             else
             {
-                idx = particles_.size();
-                particles_.push_back(v);
+                idx = records_.size();
+                records_.push_back(v);
                 push_into_cell(new_cell, idx);
                 rmap_[v.first] = idx;
-                return std::pair<particle_container_type::iterator, bool>(
-                    particles_.begin() + idx, true);
+                return std::pair<record_container_type::iterator, bool>(
+                    records_.begin() + idx, true);
             }
         }
     }
 
-    inline bool erase(particle_container_type::iterator const& i)
+    inline bool erase(record_container_type::iterator const& i)
     {
-        if (particles_.end() == i)
+        if (records_.end() == i)
         {
             return false;
         }
 
-        particle_container_type::size_type old_idx(i - particles_.begin());
-        cell_type& old_cell(cell(index((*i).second.position())));
+        record_container_type::size_type old_idx(i - records_.begin());
+        cell_type& old_cell(cell(index((*i).second.position)));
         const bool succeeded(erase_from_cell(&old_cell, old_idx));
         assert(succeeded);
         // BOOST_ASSERT(succeeded);
         rmap_.erase((*i).first);
 
-        particle_container_type::size_type const last_idx(particles_.size() - 1);
+        record_container_type::size_type const last_idx(records_.size() - 1);
 
         if (old_idx < last_idx)
         {
-            const std::pair<ParticleID, Particle>& last(particles_[last_idx]);
-            cell_type& last_cell(cell(index(last.second.position())));
+            const std::pair<ParticleID, ParticleRecord>& last(records_[last_idx]);
+            cell_type& last_cell(cell(index(last.second.position)));
             const bool tmp(erase_from_cell(&last_cell, last_idx));
             // BOOST_ASSERT(tmp);
             assert(succeeded);
@@ -418,7 +562,7 @@ protected:
             // reinterpret_cast<nonconst_value_type&>(*i) = last;
             (*i) = last;
         }
-        particles_.pop_back();
+        records_.pop_back();
         return true;
     }
 
@@ -429,7 +573,7 @@ protected:
         {
             return false;
         }
-        return erase(particles_.begin() + (*p).second);
+        return erase(records_.begin() + (*p).second);
     }
 
     inline void erase_from_cell(cell_type* c, const cell_type::iterator& i)
@@ -438,7 +582,7 @@ protected:
     }
 
     inline cell_type::size_type erase_from_cell(
-        cell_type* c, const particle_container_type::size_type& v)
+        cell_type* c, const record_container_type::size_type& v)
     {
         cell_type::iterator e(c->end());
         std::pair<cell_type::iterator, cell_type::iterator>
@@ -449,14 +593,14 @@ protected:
     }
 
     inline void push_into_cell(
-        cell_type* c, const particle_container_type::size_type& v)
+        cell_type* c, const record_container_type::size_type& v)
     {
         cell_type::iterator i(std::upper_bound(c->begin(), c->end(), v));
         c->insert(i, v);
     }
 
     inline cell_type::iterator find_in_cell(
-        cell_type* c, const particle_container_type::size_type& v)
+        cell_type* c, const record_container_type::size_type& v)
     {
         cell_type::iterator i(std::lower_bound(c->begin(), c->end(), v));
         if (i != c->end() && *i == v)
@@ -470,7 +614,7 @@ protected:
     }
 
     inline cell_type::const_iterator find_in_cell(
-        cell_type* c, const particle_container_type::size_type& v) const
+        cell_type* c, const record_container_type::size_type& v) const
     {
         cell_type::iterator i(std::lower_bound(c->begin(), c->end(), v));
         if (i != c->end() && *i == v)
@@ -487,14 +631,107 @@ protected:
 
     Real3 edge_lengths_;
 
-    particle_container_type particles_;
+    record_container_type records_;
     key_to_value_map_type rmap_;
     per_species_particle_id_set particle_pool_;
 
+    species_table_type species_table_;
+    species_id_map_type species_ids_;
+
+    mutable particle_container_type particles_;
+    mutable bool particles_is_valid_;
+
     matrix_type matrix_;
     Real3 cell_sizes_;
 };
 
+namespace detail
+{
+
+/**
+ * the visitors for each_particle_within_radius.
+ */
+class neighbor_filter
+{
+public:
+
+    neighbor_filter(const ParticleID& ignore1, const ParticleID& ignore2)
+        : ignore1_(ignore1), ignore2_(ignore2)
+    {
+        ;
+    }
+
+    inline bool is_ignored(const ParticleID& pid) const
+    {
+        return (pid == ignore1_ || pid == ignore2_);
+    }
+
+protected:
+
+    const ParticleID ignore1_, ignore2_;
+};
+
+struct overlap_finder
+    : public neighbor_filter
+{
+    overlap_finder(const ParticleID& ignore1, const ParticleID& ignore2)
+        : neighbor_filter(ignore1, ignore2)
+    {
+        ;
+    }
+
+    bool operator()(const std::pair<ParticleID, ParticleRecord>& pp, const Real dist)
+    {
+        return is_ignored(pp.first);
+    }
+};
+
+struct overlap_counter
+    : public neighbor_filter
+{
+    overlap_counter(const ParticleID& ignore1, const ParticleID& ignore2)
+        : neighbor_filter(ignore1, ignore2), count(0)
+    {
+        ;
+    }
+
+    bool operator()(const std::pair<ParticleID, ParticleRecord>& pp, const Real dist)
+    {
+        if (!is_ignored(pp.first))
+        {
+            ++count;
+        }
+        return true;
+    }
+
+    Integer count;
+};
+
+struct overlap_collector
+    : public neighbor_filter
+{
+    overlap_collector(
+        ParticleSpaceCellListImpl::neighbor_container_type& neighbors,
+        const ParticleID& ignore1, const ParticleID& ignore2)
+        : neighbor_filter(ignore1, ignore2), neighbors(neighbors)
+    {
+        ;
+    }
+
+    bool operator()(const std::pair<ParticleID, ParticleRecord>& pp, const Real dist)
+    {
+        if (!is_ignored(pp.first))
+        {
+            neighbors.push_back(std::make_pair(pp, dist));
+        }
+        return true;
+    }
+
+    ParticleSpaceCellListImpl::neighbor_container_type& neighbors;
+};
+
+} // detail
+
 }; // ecell4
 
 #endif /* ECELL4_PARTICLE_SPACE_CELL_LIST_IMPL_HPP */
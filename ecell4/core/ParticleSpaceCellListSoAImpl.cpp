@@ -0,0 +1,191 @@
+#include "ParticleSpaceCellListSoAImpl.hpp"
+#include "comparators.hpp"
+
+
+namespace ecell4
+{
+
+const std::size_t ParticleSpaceCellListSoAImpl::block_size;
+
+void ParticleSpaceCellListSoAImpl::reset(const Real3& edge_lengths)
+{
+    base_type::reset(edge_lengths);
+
+    bins_.clear();
+    bins_.resize(matrix_.num_elements());
+    locations_.clear();
+}
+
+void ParticleSpaceCellListSoAImpl::push_into_bin(
+    const index_type& b, const index_type& idx)
+{
+    bin_type& bin(bins_[b]);
+    const index_type slot(bin.indices.size());
+    if (slot % block_size == 0)
+    {
+        // the unused lanes are at infinity, and never hit.
+        block_type block;
+        std::fill(block.x, block.x + block_size, inf);
+        std::fill(block.y, block.y + block_size, inf);
+        std::fill(block.z, block.z + block_size, inf);
+        std::fill(block.radius, block.radius + block_size, 0.0);
+        bin.blocks.push_back(block);
+    }
+    set_slot(bin, slot, records_[idx].second);
+    bin.indices.push_back(idx);
+    locations_[idx] = location_type(b, slot);
+}
+
+void ParticleSpaceCellListSoAImpl::erase_from_bin(const location_type& loc)
+{
+    // the last one in the bin is moved to the hole.
+    bin_type& bin(bins_[loc.first]);
+    const index_type last(bin.indices.size() - 1);
+    if (loc.second < last)
+    {
+        const index_type moved(bin.indices[last]);
+        set_slot(bin, loc.second, records_[moved].second);
+        bin.indices[loc.second] = moved;
+        locations_[moved].second = loc.second;
+    }
+
+    bin.indices.pop_back();
+    if (last % block_size == 0)
+    {
+        bin.blocks.pop_back();
+    }
+    else
+    {
+        bin.blocks[last / block_size].x[last % block_size] = inf;
+    }
+}
+
+bool ParticleSpaceCellListSoAImpl::update_particle(
+    const ParticleID& pid, const Particle& p)
+{
+    particles_is_valid_ = false;
+
+    const ParticleRecord r(to_record(p));
+    const index_type b(bin_of(r.position));
+    record_container_type::iterator i(find(pid));
+    if (i != records_.end())
+    {
+        if ((*i).second.species_id != r.species_id)
+        {
+            particle_pool_[species_table_[(*i).second.species_id].serial()].erase(pid);
+            particle_pool_[p.species_serial()].insert(pid);
+        }
+
+        const index_type idx(i - records_.begin());
+        (*i).second = r;
+        const location_type loc(locations_[idx]);
+        if (loc.first == b)
+        {
+            set_slot(bins_[b], loc.second, r);
+        }
+        else
+        {
+            erase_from_bin(loc);
+            push_into_bin(b, idx);
+        }
+        return false;
+    }
+
+    const index_type idx(records_.size());
+    records_.push_back(std::make_pair(pid, r));
+    rmap_[pid] = idx;
+    locations_.push_back(location_type());
+    push_into_bin(b, idx);
+    particle_pool_[p.species_serial()].insert(pid);
+    return true;
+}
+
+void ParticleSpaceCellListSoAImpl::move_particle(
+    const ParticleID& pid, const Real3& pos)
+{
+    record_container_type::iterator i(find(pid));
+    if (i == records_.end())
+    {
+        throw NotFound("No such particle.");
+    }
+
+    if (particles_is_valid_)
+    {
+        particles_is_valid_ = false;
+    }
+
+    (*i).second.position = pos;
+    const index_type idx(i - records_.begin());
+    const index_type b(bin_of(pos));
+    const location_type loc(locations_[idx]);
+    if (loc.first == b)
+    {
+        set_slot(bins_[b], loc.second, (*i).second);
+    }
+    else
+    {
+        erase_from_bin(loc);
+        push_into_bin(b, idx);
+    }
+}
+
+void ParticleSpaceCellListSoAImpl::remove_particle(const ParticleID& pid)
+{
+    record_container_type::iterator i(find(pid));
+    if (i == records_.end())
+    {
+        throw NotFound("No such particle.");
+    }
+    particles_is_valid_ = false;
+    particle_pool_[species_table_[(*i).second.species_id].serial()].erase(pid);
+
+    // the last record is moved to the hole.
+    const index_type idx(i - records_.begin());
+    const index_type last(records_.size() - 1);
+    erase_from_bin(locations_[idx]);
+    rmap_.erase(pid);
+    if (idx < last)
+    {
+        records_[idx] = records_[last];
+        locations_[idx] = locations_[last];
+        rmap_[records_[idx].first] = idx;
+        bins_[locations_[idx].first].indices[locations_[idx].second] = idx;
+    }
+    records_.pop_back();
+    locations_.pop_back();
+}
+
+bool ParticleSpaceCellListSoAImpl::has_particle_within_radius(
+    const Real3& pos, const Real& radius,
+    const ParticleID& ignore1, const ParticleID& ignore2) const
+{
+    detail::overlap_finder finder(ignore1, ignore2);
+    return !each_particle_within_radius(pos, radius, finder);
+}
+
+Integer ParticleSpaceCellListSoAImpl::count_particles_within_radius(
+    const Real3& pos, const Real& radius,
+    const ParticleID& ignore1, const ParticleID& ignore2) const
+{
+    detail::overlap_counter counter(ignore1, ignore2);
+    each_particle_within_radius(pos, radius, counter);
+    return counter.count;
+}
+
+void ParticleSpaceCellListSoAImpl::collect_particles_within_radius(
+    const Real3& pos, const Real& radius, neighbor_container_type& neighbors,
+    const ParticleID& ignore1, const ParticleID& ignore2,
+    const bool sorted) const
+{
+    neighbors.clear();
+    detail::overlap_collector collector(neighbors, ignore1, ignore2);
+    each_particle_within_radius(pos, radius, collector);
+    if (sorted)
+    {
+        std::sort(neighbors.begin(), neighbors.end(),
+            utils::pair_second_element_comparator<
+                std::pair<ParticleID, ParticleRecord>, Real>());
+    }
+}
+
+} // ecell4
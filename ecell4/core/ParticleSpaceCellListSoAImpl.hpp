@@ -0,0 +1,208 @@
+#ifndef ECELL4_PARTICLE_SPACE_CELL_LIST_SOA_IMPL_HPP
+#define ECELL4_PARTICLE_SPACE_CELL_LIST_SOA_IMPL_HPP
+
+#include "ParticleSpaceCellListImpl.hpp"
+
+
+namespace ecell4
+{
+
+/**
+ * a cell list keeping the positions and radii in each cell as arrays
+ * (structure of arrays), instead of the indices to the records.
+ * the arrays are cut into blocks of four, so that a cell with a few
+ * particles takes one allocation and two cache lines. a distance check
+ * reads the blocks of a cell in sequence, which the compiler can
+ * vectorize, and touches a record only for an overlap.
+ * the particles are stored as ParticleSpaceCellListImpl, and the cells
+ * of ParticleSpaceCellListImpl are left empty.
+ */
+class ParticleSpaceCellListSoAImpl
+    : public ParticleSpaceCellListImpl
+{
+public:
+
+    typedef ParticleSpaceCellListImpl base_type;
+    typedef base_type::record_container_type record_container_type;
+    typedef base_type::neighbor_container_type neighbor_container_type;
+    typedef record_container_type::size_type index_type;
+
+    static const std::size_t block_size = 4;
+
+    struct block_type
+    {
+        Real x[block_size], y[block_size], z[block_size], radius[block_size];
+    };
+
+    struct bin_type
+    {
+        std::vector<block_type> blocks;
+        std::vector<index_type> indices; // to the records
+    };
+
+    typedef std::vector<bin_type> bin_container_type;
+
+    /**
+     * the bin of a record, and the position in the bin.
+     */
+    typedef std::pair<index_type, index_type> location_type;
+
+public:
+
+    ParticleSpaceCellListSoAImpl(const Real3& edge_lengths)
+        : base_type(edge_lengths), bins_(matrix_.num_elements())
+    {
+        ;
+    }
+
+    ParticleSpaceCellListSoAImpl(
+        const Real3& edge_lengths, const Integer3& matrix_sizes)
+        : base_type(edge_lengths, matrix_sizes), bins_(matrix_.num_elements())
+    {
+        ;
+    }
+
+    void reset(const Real3& edge_lengths);
+
+    bool update_particle(const ParticleID& pid, const Particle& p);
+    void remove_particle(const ParticleID& pid);
+    void move_particle(const ParticleID& pid, const Real3& pos);
+
+    /**
+     * the same as ParticleSpaceCellListImpl::each_particle_within_radius.
+     */
+    template<typename Tvisitor_>
+    bool each_particle_within_radius(
+        const Real3& pos, const Real& radius, Tvisitor_& visitor) const
+    {
+        if (records_.size() == 0)
+        {
+            return true;
+        }
+
+        const cell_index_type idx(this->index(pos));
+
+        cell_offset_type off;
+        for (off[2] = -1; off[2] <= 1; ++off[2])
+        {
+            for (off[1] = -1; off[1] <= 1; ++off[1])
+            {
+                for (off[0] = -1; off[0] <= 1; ++off[0])
+                {
+                    cell_index_type newidx(idx);
+                    const Real3 stride(this->offset_index_cyclic(newidx, off));
+                    if (!each_particle_in_bin(
+                            bins_[bin_index(newidx)], pos, stride, radius, visitor))
+                    {
+                        return false;
+                    }
+                }
+            }
+        }
+        return true;
+    }
+
+    bool has_particle_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const;
+    Integer count_particles_within_radius(
+        const Real3& pos, const Real& radius,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID()) const;
+    void collect_particles_within_radius(
+        const Real3& pos, const Real& radius, neighbor_container_type& neighbors,
+        const ParticleID& ignore1 = ParticleID(),
+        const ParticleID& ignore2 = ParticleID(),
+        const bool sorted = false) const;
+
+protected:
+
+    inline index_type bin_index(const cell_index_type& i) const
+    {
+        return (i[0] * matrix_.shape()[1] + i[1]) * matrix_.shape()[2] + i[2];
+    }
+
+    /**
+     * the kernel. the candidates are tested a block at a time without
+     * a branch nor a square root, by comparing the squared distance
+     * between the centers with the squared sum of the radii. only the
+     * ones passing this test are measured as the base class does.
+     */
+    template<typename Tvisitor_>
+    bool each_particle_in_bin(
+        const bin_type& bin, const Real3& pos, const Real3& stride,
+        const Real& radius, Tvisitor_& visitor) const
+    {
+        const index_type n(bin.indices.size());
+        const Real px(pos[0] - stride[0]), py(pos[1] - stride[1]),
+            pz(pos[2] - stride[2]);
+        const Real margin(1.0 + 1e-10); // for the rounding in the test
+
+        for (index_type first(0); first < n; first += block_size)
+        {
+            const block_type& block(bin.blocks[first / block_size]);
+            int hit[block_size];
+            int any(0);
+            for (std::size_t j(0); j < block_size; ++j)
+            {
+                const Real dx(block.x[j] - px), dy(block.y[j] - py),
+                    dz(block.z[j] - pz);
+                const Real rr(radius + block.radius[j]);
+                hit[j] = (dx * dx + dy * dy + dz * dz < rr * rr * margin);
+                any |= hit[j];
+            }
+
+            if (!any)
+            {
+                continue;
+            }
+
+            const index_type m(std::min<index_type>(block_size, n - first));
+            for (index_type j(0); j < m; ++j)
+            {
+                if (!hit[j])
+                {
+                    continue;
+                }
+
+                const std::pair<ParticleID, ParticleRecord>&
+                    pp(records_[bin.indices[first + j]]);
+                const Real dist(
+                    length(pp.second.position + stride - pos) - pp.second.radius);
+                if (dist < radius && !visitor(pp, dist))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void set_slot(bin_type& bin, const index_type& slot, const ParticleRecord& r)
+    {
+        block_type& block(bin.blocks[slot / block_size]);
+        const std::size_t lane(slot % block_size);
+        block.x[lane] = r.position[0];
+        block.y[lane] = r.position[1];
+        block.z[lane] = r.position[2];
+        block.radius[lane] = r.radius;
+    }
+
+    index_type bin_of(const Real3& pos) const
+    {
+        return bin_index(this->index(pos));
+    }
+
+    void push_into_bin(const index_type& b, const index_type& idx);
+    void erase_from_bin(const location_type& loc);
+
+protected:
+
+    bin_container_type bins_;
+    std::vector<location_type> locations_; // for each record
+};
+
+} // ecell4
+
+#endif /* ECELL4_PARTICLE_SPACE_CELL_LIST_SOA_IMPL_HPP */
@@ -1,6 +1,7 @@
 #include <boost/scoped_ptr.hpp>
 #include <gsl/gsl_rng.h>
 #include <sstream>
+#include <cmath>
 
 #include "RandomNumberGenerator.hpp"
 
@@ -51,6 +52,33 @@ void GSLRandomNumberGenerator::load(const std::string& filename)
         fin(new H5::H5File(filename.c_str(), H5F_ACC_RDONLY));
     this->load(*fin);
 }
+
+void PhiloxRandomNumberGenerator::save(H5::CommonFG* root) const
+{
+    using namespace H5;
+
+    boost::scoped_ptr<DataType> optype(new DataType(H5T_OPAQUE, 1));
+    hsize_t bufsize(sizeof(state_type));
+    DataSpace dataspace(1, &bufsize);
+    optype->setTag("PhiloxRandomNumberGenerator state type");
+    boost::scoped_ptr<DataSet> dataset(
+        new DataSet(root->createDataSet("rng", *optype, dataspace)));
+    dataset->write((const unsigned char*)(state()), *optype);
+}
+
+void PhiloxRandomNumberGenerator::load(const H5::CommonFG& root)
+{
+    using namespace H5;
+
+    const DataSet dataset(DataSet(root.openDataSet("rng")));
+    boost::scoped_ptr<DataType> optype(new DataType(H5T_OPAQUE, 1));
+    optype->setTag("PhiloxRandomNumberGenerator state type");
+    if (dataset.getStorageSize() != sizeof(state_type))
+    {
+        throw IllegalState("The saved state is not of PhiloxRandomNumberGenerator.");
+    }
+    dataset.read((unsigned char*)(state()), *optype);
+}
 #endif
 
 Real GSLRandomNumberGenerator::random()
@@ -101,6 +129,11 @@ Integer GSLRandomNumberGenerator::binomial(Real p, Integer n)
     return gsl_ran_binomial(rng_.get(), p, n);
 }
 
+Integer GSLRandomNumberGenerator::poisson(Real mean)
+{
+    return gsl_ran_poisson(rng_.get(), mean);
+}
+
 Real3 GSLRandomNumberGenerator::direction3d(Real length)
 {
     double x, y, z;
@@ -108,6 +141,68 @@ Real3 GSLRandomNumberGenerator::direction3d(Real length)
     return Real3(x * length, y * length, z * length);
 }
 
+void GSLRandomNumberGenerator::fill_uniform(
+    Real* first, const std::size_t n, Real min, Real max)
+{
+    gsl_rng* const rng(rng_.get());
+    const Real width(max - min);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        first[i] = gsl_rng_uniform(rng) * width + min;
+    }
+}
+
+void GSLRandomNumberGenerator::fill_uniform_int(
+    Integer* first, const std::size_t n, Integer min, Integer max)
+{
+    if (max < min)
+    {
+        throw std::invalid_argument(
+            "the max value must be larger than the min value.");
+    }
+
+    const unsigned long int range(rng_->type->max - rng_->type->min);
+    if (static_cast<unsigned long int>(max - min + 1) > range)
+    {
+        RandomNumberGenerator::fill_uniform_int(first, n, min, max);
+        return;
+    }
+
+    gsl_rng* const rng(rng_.get());
+    const unsigned long int num(max - min + 1);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        first[i] = gsl_rng_uniform_int(rng, num) + min;
+    }
+}
+
+void GSLRandomNumberGenerator::fill_gaussian(
+    Real* first, const std::size_t n, Real sigma, Real mean)
+{
+    // the polar method as gsl_ran_gaussian, but both of the pair are used.
+    gsl_rng* const rng(rng_.get());
+    std::size_t i(0);
+    for (; i + 1 < n; i += 2)
+    {
+        Real x, y, r2;
+        do
+        {
+            x = -1 + 2 * gsl_rng_uniform_pos(rng);
+            y = -1 + 2 * gsl_rng_uniform_pos(rng);
+            r2 = x * x + y * y;
+        }
+        while (r2 > 1.0 || r2 == 0);
+
+        const Real f(sigma * std::sqrt(-2.0 * std::log(r2) / r2));
+        first[i] = x * f + mean;
+        first[i + 1] = y * f + mean;
+    }
+    if (i < n)
+    {
+        first[i] = gsl_ran_gaussian(rng, sigma) + mean;
+    }
+}
+
 void GSLRandomNumberGenerator::seed(Integer val)
 {
     gsl_rng_set(rng_.get(), val);
@@ -118,4 +213,128 @@ void GSLRandomNumberGenerator::seed()
     gsl_rng_set(rng_.get(), unsigned(std::time(0)));
 }
 
+namespace philox
+{
+
+typedef PhiloxRandomNumberGenerator::state_type state_type;
+
+inline void mulhilo(
+    const boost::uint32_t a, const boost::uint32_t b,
+    boost::uint32_t& hi, boost::uint32_t& lo)
+{
+    const boost::uint64_t product(static_cast<boost::uint64_t>(a) * b);
+    hi = static_cast<boost::uint32_t>(product >> 32);
+    lo = static_cast<boost::uint32_t>(product);
+}
+
+inline boost::uint32_t next(state_type* s)
+{
+    if (s->index >= 4)
+    {
+        PhiloxRandomNumberGenerator::generate_block(s->counter, s->key, s->block);
+        // the block number in the lower 64 bits of the counter
+        if (++s->counter[0] == 0)
+        {
+            ++s->counter[1];
+        }
+        s->index = 0;
+    }
+    return s->block[s->index++];
+}
+
+void set(void* vstate, unsigned long int seed)
+{
+    state_type* s(static_cast<state_type*>(vstate));
+    s->counter[0] = s->counter[1] = s->counter[2] = s->counter[3] = 0;
+    s->key[0] = static_cast<boost::uint32_t>(seed);
+    s->key[1] = static_cast<boost::uint32_t>(
+        static_cast<boost::uint64_t>(seed) >> 32);
+    s->index = 4;
+}
+
+unsigned long int get(void* vstate)
+{
+    return next(static_cast<state_type*>(vstate));
+}
+
+double get_double(void* vstate)
+{
+    return next(static_cast<state_type*>(vstate)) / 4294967296.0;
+}
+
+const gsl_rng_type type = {
+    "philox4x32", 0xffffffffUL, 0, sizeof(state_type), &set, &get, &get_double};
+
+} // philox
+
+const gsl_rng_type* PhiloxRandomNumberGenerator::gsl_rng_philox4x32 = &philox::type;
+
+void PhiloxRandomNumberGenerator::generate_block(
+    const boost::uint32_t counter[4], const boost::uint32_t key[2],
+    boost::uint32_t block[4])
+{
+    const boost::uint32_t M0(0xD2511F53), M1(0xCD9E8D57);
+    const boost::uint32_t W0(0x9E3779B9), W1(0xBB67AE85);
+
+    boost::uint32_t c0(counter[0]), c1(counter[1]), c2(counter[2]), c3(counter[3]);
+    boost::uint32_t k0(key[0]), k1(key[1]);
+    for (unsigned int round(0); round < 10; ++round)
+    {
+        boost::uint32_t hi0, lo0, hi1, lo1;
+        philox::mulhilo(M0, c0, hi0, lo0);
+        philox::mulhilo(M1, c2, hi1, lo1);
+        c0 = hi1 ^ c1 ^ k0;
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ k1;
+        c3 = lo0;
+        k0 += W0;
+        k1 += W1;
+    }
+    block[0] = c0;
+    block[1] = c1;
+    block[2] = c2;
+    block[3] = c3;
+}
+
+void PhiloxRandomNumberGenerator::fill_uniform(
+    Real* first, const std::size_t n, Real min, Real max)
+{
+    state_type* const s(state());
+    const Real width((max - min) / 4294967296.0);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        first[i] = philox::next(s) * width + min;
+    }
+}
+
+boost::shared_ptr<PhiloxRandomNumberGenerator>
+PhiloxRandomNumberGenerator::split(const Integer stream_id) const
+{
+    boost::shared_ptr<PhiloxRandomNumberGenerator>
+        retval(new PhiloxRandomNumberGenerator());
+    state_type* const s(retval->state());
+    const boost::uint64_t id(static_cast<boost::uint64_t>(stream_id));
+    s->key[0] = state()->key[0];
+    s->key[1] = state()->key[1];
+    s->counter[0] = s->counter[1] = 0;
+    s->counter[2] = static_cast<boost::uint32_t>(id);
+    s->counter[3] = static_cast<boost::uint32_t>(id >> 32);
+    s->index = 4;
+    return retval;
+}
+
+void PhiloxRandomNumberGenerator::jump()
+{
+    state_type* const s(state());
+    ++s->counter[1];
+    s->index = 4;
+}
+
+Integer PhiloxRandomNumberGenerator::stream_id() const
+{
+    const state_type* const s(state());
+    return static_cast<Integer>(
+        (static_cast<boost::uint64_t>(s->counter[3]) << 32) | s->counter[2]);
+}
+
 } // ecell4
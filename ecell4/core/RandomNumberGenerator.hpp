@@ -4,6 +4,7 @@
 #include <ctime>
 #include <vector>
 #include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
 
@@ -33,8 +34,41 @@ public:
     virtual Integer uniform_int(Integer min, Integer max) = 0;
     virtual Real gaussian(Real sigma, Real mean = 0.0) = 0;
     virtual Integer binomial(Real p, Integer n) = 0;
+    virtual Integer poisson(Real mean) = 0;
     virtual Real3 direction3d(Real length = 1.0) = 0;
 
+    /**
+     * draw n values at once into the range beginning at first.
+     * the values are the same in distribution as the ones drawn one by
+     * one, but not necessarily in sequence. an implementation should
+     * override these to avoid a virtual call per value.
+     */
+    virtual void fill_uniform(Real* first, const std::size_t n, Real min, Real max)
+    {
+        for (std::size_t i(0); i < n; ++i)
+        {
+            first[i] = uniform(min, max);
+        }
+    }
+
+    virtual void fill_uniform_int(
+        Integer* first, const std::size_t n, Integer min, Integer max)
+    {
+        for (std::size_t i(0); i < n; ++i)
+        {
+            first[i] = uniform_int(min, max);
+        }
+    }
+
+    virtual void fill_gaussian(
+        Real* first, const std::size_t n, Real sigma, Real mean = 0.0)
+    {
+        for (std::size_t i(0); i < n; ++i)
+        {
+            first[i] = gaussian(sigma, mean);
+        }
+    }
+
     virtual void seed(Integer val) = 0;
     virtual void seed() = 0;
 
@@ -85,7 +119,11 @@ public:
     Integer uniform_int(Integer min, Integer max);
     Real gaussian(Real sigma, Real mean = 0.0);
     Integer binomial(Real p, Integer n);
+    Integer poisson(Real mean);
     Real3 direction3d(Real length);
+    void fill_uniform(Real* first, const std::size_t n, Real min, Real max);
+    void fill_uniform_int(Integer* first, const std::size_t n, Integer min, Integer max);
+    void fill_gaussian(Real* first, const std::size_t n, Real sigma, Real mean = 0.0);
     void seed(Integer val);
     void seed();
 
@@ -114,23 +152,118 @@ public:
         load(filename);
     }
 
-    // GSLRandomNumberGenerator(rng_handle hdl)
-    //     : rng_(hdl)
-    // {
-    //     ;
-    // }
-
     // GSLRandomNumberGenerator(gsl_rng* rng = gsl_rng_alloc(gsl_rng_mt19937))
     //     : rng_(rng, &gsl_rng_free)
     // {
     //     ;
     // }
 
+protected:
+
+    GSLRandomNumberGenerator(rng_handle hdl)
+        : rng_(hdl)
+    {
+        ;
+    }
+
 protected:
 
     rng_handle rng_;
 };
 
+/**
+ * a counter-based generator, Philox4x32-10 (Salmon et al., SC'11).
+ * the n-th block of four 32-bit words is a pure function of the key,
+ * which is the seed, and the counter, which holds the block number in
+ * the lower 64 bits and the stream id in the upper 64 bits. thus, an
+ * independent stream can be created by split() without any draw, and
+ * the state is a few words.
+ * this is built as a gsl_rng type, and the distributions are the ones
+ * of GSLRandomNumberGenerator.
+ */
+class PhiloxRandomNumberGenerator
+    : public GSLRandomNumberGenerator
+{
+public:
+
+    typedef GSLRandomNumberGenerator base_type;
+
+    struct state_type
+    {
+        boost::uint32_t counter[4];
+        boost::uint32_t key[2];
+        boost::uint32_t block[4];
+        boost::uint32_t index; // the next word in block, or 4 if used up
+    };
+
+public:
+
+    PhiloxRandomNumberGenerator()
+        : base_type(rng_handle(gsl_rng_alloc(gsl_rng_philox4x32), &gsl_rng_free))
+    {
+        ;
+    }
+
+    PhiloxRandomNumberGenerator(const Integer myseed)
+        : base_type(rng_handle(gsl_rng_alloc(gsl_rng_philox4x32), &gsl_rng_free))
+    {
+        seed(myseed);
+    }
+
+    PhiloxRandomNumberGenerator(const std::string& filename)
+        : base_type(rng_handle(gsl_rng_alloc(gsl_rng_philox4x32), &gsl_rng_free))
+    {
+        load(filename);
+    }
+
+    void fill_uniform(Real* first, const std::size_t n, Real min, Real max);
+
+    /**
+     * return a new generator of the stream stream_id with the same seed,
+     * starting at its beginning. streams never overlap each other, so
+     * that each thread or each run of an ensemble can be given its own
+     * one deterministically, e.g. split(thread_id).
+     * seed() resets the stream to 0.
+     */
+    boost::shared_ptr<PhiloxRandomNumberGenerator> split(const Integer stream_id) const;
+
+    /**
+     * skip 2^32 blocks (2^34 words) ahead in the current stream.
+     * the rest of the current block is discarded.
+     */
+    void jump();
+
+    Integer stream_id() const;
+
+#ifdef WITH_HDF5
+    void save(H5::CommonFG* root) const;
+    void load(const H5::CommonFG& root);
+    using base_type::save;
+    using base_type::load;
+#endif
+
+    /**
+     * the Philox4x32-10 bijection, which encrypts counter with key.
+     */
+    static void generate_block(
+        const boost::uint32_t counter[4], const boost::uint32_t key[2],
+        boost::uint32_t block[4]);
+
+    static const gsl_rng_type* gsl_rng_philox4x32;
+
+protected:
+
+    state_type* state()
+    {
+        return static_cast<state_type*>(rng_->state);
+    }
+
+    const state_type* state() const
+    {
+        return static_cast<const state_type*>(rng_->state);
+    }
+};
+
 } // ecell4
 
 #endif /* ECELL4_RANDOM_NUMBER_GENERATOR_HPP */
@@ -9,15 +9,13 @@ Integer SubvolumeSpaceVectorImpl::num_molecules(const Species& sp) const
 {
     SpeciesExpressionMatcher sexp(sp);
     Integer retval(0);
-    for (matrix_type::const_iterator i(matrix_.begin());
-        i != matrix_.end(); ++i)
+    for (pool_container_type::size_type i(0); i < pools_.size(); ++i)
     {
-        if (sexp.match((*i).first))
+        if (sexp.match(species_[i]))
         {
             do
             {
-                // retval += std::accumulate((*i).second.begin(), (*i).second.end(), 0);
-                retval += (*i).second->num_molecules();
+                retval += pools_[i]->num_molecules();
             } while (sexp.next());
         }
     }
@@ -26,13 +24,12 @@ Integer SubvolumeSpaceVectorImpl::num_molecules(const Species& sp) const
 
 Integer SubvolumeSpaceVectorImpl::num_molecules_exact(const Species& sp) const
 {
-    matrix_type::const_iterator i(matrix_.find(sp));
-    if (i == matrix_.end())
+    index_map_type::const_iterator i(index_map_.find(sp));
+    if (i == index_map_.end())
     {
         return 0;
     }
-    // return std::accumulate((*i).second.begin(), (*i).second.end(), 0);
-    return (*i).second->num_molecules();
+    return pools_[(*i).second]->num_molecules();
 }
 
 Integer SubvolumeSpaceVectorImpl::num_molecules(
@@ -40,15 +37,13 @@ Integer SubvolumeSpaceVectorImpl::num_molecules(
 {
     SpeciesExpressionMatcher sexp(sp);
     Integer retval(0);
-    for (matrix_type::const_iterator i(matrix_.begin());
-        i != matrix_.end(); ++i)
+    for (pool_container_type::size_type i(0); i < pools_.size(); ++i)
     {
-        if (sexp.match((*i).first))
+        if (sexp.match(species_[i]))
         {
             do
             {
-                // retval += (*i).second[c];
-                retval += (*i).second->num_molecules(c);
+                retval += num_molecules_by_index(i, c);
             } while (sexp.next());
         }
     }
@@ -58,50 +53,58 @@ Integer SubvolumeSpaceVectorImpl::num_molecules(
 Integer SubvolumeSpaceVectorImpl::num_molecules_exact(
     const Species& sp, const coordinate_type& c) const
 {
-    matrix_type::const_iterator i(matrix_.find(sp));
-    if (i == matrix_.end())
+    index_map_type::const_iterator i(index_map_.find(sp));
+    if (i == index_map_.end())
     {
         return 0;
     }
-    // return (*i).second[c];
-    return (*i).second->num_molecules(c);
+    return num_molecules_by_index((*i).second, c);
 }
 
-const boost::shared_ptr<SubvolumeSpaceVectorImpl::PoolBase>&
-SubvolumeSpaceVectorImpl::get_pool(const Species& sp) const
+Integer SubvolumeSpaceVectorImpl::species_index(const Species& sp) const
 {
-    matrix_type::const_iterator i(matrix_.find(sp));
-    if (i == matrix_.end())
+    index_map_type::const_iterator i(index_map_.find(sp));
+    if (i == index_map_.end())
     {
         std::ostringstream message;
         message << "Speices [" << sp.serial() << "] not found";
         throw NotFound(message.str());
-        // return boost::shared_ptr<PoolBase>();
     }
     return (*i).second;
 }
 
+const boost::shared_ptr<SubvolumeSpaceVectorImpl::PoolBase>&
+SubvolumeSpaceVectorImpl::get_pool(const Species& sp) const
+{
+    return pools_[species_index(sp)];
+}
+
 const boost::shared_ptr<SubvolumeSpaceVectorImpl::PoolBase>
 SubvolumeSpaceVectorImpl::reserve_pool(
     const Species& sp, const Real D, const Species::serial_type& loc)
 {
-    matrix_type::const_iterator i(matrix_.find(sp));
-    if (i != matrix_.end())
+    index_map_type::const_iterator i(index_map_.find(sp));
+    if (i != index_map_.end())
     {
         throw AlreadyExists("Species already exists");
     }
-    // matrix_.insert(std::make_pair(sp, std::vector<Integer>(num_subvolumes())));
-    const boost::shared_ptr<PoolBase> pool(new Pool(sp, D, loc, num_subvolumes()));
-    matrix_.insert(std::make_pair(sp, pool));
+
+    const Integer idx(species_.size());
+    const count_matrix_type::size_type n(num_subvolumes());
+    counts_.resize(counts_.size() + n, 0);
+    const boost::shared_ptr<PoolBase> pool(
+        new Pool(sp, D, loc, &counts_, idx * n, n));
+    index_map_.insert(std::make_pair(sp, idx));
     species_.push_back(sp);
+    pools_.push_back(pool);
     return pool;
 }
 
 void SubvolumeSpaceVectorImpl::add_molecules(
     const Species& sp, const Integer& num, const coordinate_type& c)
 {
-    matrix_type::iterator i(matrix_.find(sp));
-    if (i == matrix_.end())
+    index_map_type::const_iterator i(index_map_.find(sp));
+    if (i == index_map_.end())
     {
         if (has_structure(sp))
         {
@@ -114,15 +117,14 @@ void SubvolumeSpaceVectorImpl::add_molecules(
         message << "Speices [" << sp.serial() << "] not found";
         throw NotFound(message.str());
     }
-    // (*i).second[c] += num;
-    (*i).second->add_molecules(num, c);
+    counts_[(*i).second * num_subvolumes() + c] += num;
 }
 
 void SubvolumeSpaceVectorImpl::remove_molecules(
     const Species& sp, const Integer& num, const coordinate_type& c)
 {
-    matrix_type::iterator i(matrix_.find(sp));
-    if (i == matrix_.end())
+    index_map_type::const_iterator i(index_map_.find(sp));
+    if (i == index_map_.end())
     {
         if (has_structure(sp))
         {
@@ -134,16 +136,15 @@ void SubvolumeSpaceVectorImpl::remove_molecules(
         throw NotFound(message.str());
     }
 
-    // if ((*i).second[c] < num)
-    if ((*i).second->num_molecules(c) < num)
+    Integer& cnt(counts_[(*i).second * num_subvolumes() + c]);
+    if (cnt < num)
     {
         std::ostringstream message;
         message << "The number of molecules cannot be negative. [" << sp.serial() << "]";
         throw std::invalid_argument(message.str());
     }
 
-    // (*i).second[c] -= num;
-    (*i).second->remove_molecules(num, c);
+    cnt -= num;
 }
 
 SubvolumeSpaceVectorImpl::coordinate_type SubvolumeSpaceVectorImpl::get_neighbor(
@@ -175,13 +176,12 @@ SubvolumeSpaceVectorImpl::list_coordinates(const Species& sp) const
 {
     SpeciesExpressionMatcher sexp(sp);
     std::vector<coordinate_type> retval;
-    for (matrix_type::const_iterator i(matrix_.begin());
-        i != matrix_.end(); ++i)
+    for (pool_container_type::size_type i(0); i < pools_.size(); ++i)
     {
-        Integer cnt(sexp.count((*i).first));
+        Integer cnt(sexp.count(species_[i]));
         if (cnt > 0)
         {
-            const std::vector<coordinate_type> coords = (*i).second->list_coordinates();
+            const std::vector<coordinate_type> coords = pools_[i]->list_coordinates();
             for (; cnt > 0; --cnt)
             {
                 retval.insert(retval.end(), coords.begin(), coords.end());
@@ -202,12 +202,12 @@ std::vector<SubvolumeSpaceVectorImpl::coordinate_type>
 SubvolumeSpaceVectorImpl::list_coordinates_exact(const Species& sp) const
 {
     std::vector<coordinate_type> retval;
-    matrix_type::const_iterator i(matrix_.find(sp));
-    if (i == matrix_.end())
+    index_map_type::const_iterator i(index_map_.find(sp));
+    if (i == index_map_.end())
     {
         return retval;
     }
-    return (*i).second->list_coordinates();
+    return pools_[(*i).second]->list_coordinates();
 
     // for (cell_type::size_type j(0); j < (*i).second.size(); ++j)
     // {
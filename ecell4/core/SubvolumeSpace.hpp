@@ -144,6 +144,15 @@ public:
         const Species& sp, const Integer& num, const coordinate_type& c) = 0;
 
     virtual bool has_species(const Species& sp) const = 0;
+
+    /**
+     * return the index of the species, which is its position in species().
+     * an index is fixed until the space is reset.
+     */
+    virtual Integer species_index(const Species& sp) const = 0;
+    virtual Integer num_molecules_by_index(
+        const Integer& idx, const coordinate_type& c) const = 0;
+
     virtual const std::vector<Species>& species() const = 0;
     virtual std::vector<Species> list_species() const = 0;
     virtual coordinate_type get_neighbor(
@@ -237,56 +246,69 @@ public:
 
     typedef base_type::PoolBase PoolBase;
 
+    typedef std::vector<Integer> count_matrix_type;
+
+    /**
+     * a view of a row in the counts matrix owned by the space.
+     */
     class Pool
         : public PoolBase
     {
     public:
 
         typedef PoolBase base_type;
-        typedef std::vector<Integer> container_type;
+        typedef count_matrix_type container_type;
 
     public:
 
         Pool(const Species& sp, const Real D, const Species::serial_type& loc,
+             container_type* data, const container_type::size_type offset,
              const container_type::size_type n)
-            : base_type(sp, D, loc), data_(n, 0)
+            : base_type(sp, D, loc), data_(data), offset_(offset), size_(n)
         {
             ;
         }
 
         coordinate_type size() const
         {
-            return data_.size();
+            return size_;
         }
 
         Integer num_molecules() const
         {
-            return std::accumulate(data_.begin(), data_.end(), 0);
+            const container_type::const_iterator first(data_->begin() + offset_);
+            return std::accumulate(first, first + size_, 0);
         }
 
         Integer num_molecules(const coordinate_type& i) const
         {
-            return data_.at(i);
+            // the range is checked as the per-species vector did by at()
+            if (i < 0 || static_cast<container_type::size_type>(i) >= size_)
+            {
+                throw std::out_of_range("The coordinate is out of range.");
+            }
+            return (*data_)[offset_ + i];
         }
 
         void add_molecules(const Integer num, const coordinate_type& i)
         {
-            data_[i] += num;
+            (*data_)[offset_ + i] += num;
         }
 
         void remove_molecules(const Integer num, const coordinate_type& i)
         {
-            data_[i] -= num;
+            (*data_)[offset_ + i] -= num;
         }
 
         std::vector<coordinate_type> list_coordinates() const
         {
             std::vector<coordinate_type> coords;
-            for (container_type::size_type i(0); i < data_.size(); ++i)
+            for (container_type::size_type i(0); i < size_; ++i)
             {
-                if (data_[i] > 0)
+                const Integer num((*data_)[offset_ + i]);
+                if (num > 0)
                 {
-                    coords.resize(coords.size() + data_[i], i);
+                    coords.resize(coords.size() + num, i);
                 }
             }
             return coords;
@@ -294,14 +316,17 @@ public:
 
     protected:
 
-        container_type data_;
+        container_type* data_;
+        container_type::size_type offset_, size_;
     };
 
 public:
 
     // typedef std::vector<Integer> cell_type;
     // typedef utils::get_mapper_mf<Species, cell_type>::type matrix_type;
-    typedef utils::get_mapper_mf<Species, boost::shared_ptr<PoolBase> >::type matrix_type;
+    // typedef utils::get_mapper_mf<Species, boost::shared_ptr<PoolBase> >::type matrix_type;
+    typedef utils::get_mapper_mf<Species, Integer>::type index_map_type;
+    typedef std::vector<boost::shared_ptr<PoolBase> > pool_container_type;
 
     // typedef utils::get_mapper_mf<Species::serial_type, Shape::dimension_kind>::type structure_container_type;
     typedef std::vector<Real> structure_cell_type;
@@ -479,7 +504,14 @@ public:
 
     virtual bool has_species(const Species& sp) const
     {
-        return matrix_.find(sp) != matrix_.end();
+        return index_map_.find(sp) != index_map_.end();
+    }
+
+    Integer species_index(const Species& sp) const;
+
+    Integer num_molecules_by_index(const Integer& idx, const coordinate_type& c) const
+    {
+        return counts_[idx * num_subvolumes() + c];
     }
 
     const std::vector<Species>& species() const
@@ -490,7 +522,7 @@ public:
     std::vector<Species> list_species() const
     {
         // std::vector<Species> retval;
-        // for (matrix_type::const_iterator i(matrix_.begin()); i != matrix_.end(); ++i)
+        // for (index_map_type::const_iterator i(index_map_.begin()); i != index_map_.end(); ++i)
         // {
         //     retval.push_back((*i).first);
         // }
@@ -518,8 +550,10 @@ public:
     void reset(const Real3& edge_lengths, const Integer3& matrix_sizes)
     {
         base_type::t_ = 0.0;
-        matrix_.clear();
+        index_map_.clear();
         species_.clear();
+        pools_.clear();
+        counts_.clear();
 
         for (Real3::size_type dim(0); dim < 3; ++dim)
         {
@@ -550,8 +584,15 @@ protected:
 
     Real3 edge_lengths_;
     boost::array<Integer, 3> matrix_sizes_;
-    matrix_type matrix_;
+
+    /**
+     * species_, pools_ and the rows of counts_ share the species index.
+     * counts_ is a dense (num_species x num_subvolumes) matrix.
+     */
+    index_map_type index_map_;
     std::vector<Species> species_;
+    pool_container_type pools_;
+    count_matrix_type counts_;
 
     // structure_container_type structures_;
     structure_matrix_type structure_matrix_;
@@ -2,11 +2,14 @@
 #define ECELL4_MOLECULAR_TYPE_BASE_HPP
 
 #include <vector>
+#include <algorithm>
+#include <boost/cstdint.hpp>
 #include "Species.hpp"
 #include "Shape.hpp"
 #include "Identifier.hpp"
 #include "RandomNumberGenerator.hpp"
 #include "Voxel.hpp"
+#include "get_mapper_mf.hpp"
 
 
 namespace ecell4
@@ -205,12 +208,26 @@ public:
     typedef container_type::const_iterator const_iterator;
     typedef container_type::iterator iterator;
 
+    /**
+     * indexes from a ParticleID and a coordinate to the position in voxels_.
+     * voxels_ must be modified only through the member functions below,
+     * which keep the indexes consistent.
+     * the ParticleID index is built at the first lookup by a ParticleID.
+     * the coordinate index is a hash map, unless a flat table is given
+     * by the space with use_coordinate_table.
+     */
+    typedef utils::get_mapper_mf<ParticleID, std::size_t>::type pid_index_type;
+    typedef utils::get_mapper_mf<coordinate_type, std::size_t>::type
+        coordinate_index_type;
+    typedef std::vector<boost::uint32_t> coordinate_table_type;
+
 public:
 
     MoleculePool(
         const Species& species, VoxelPool* location,
         const Real& radius, const Real& D)
-        : base_type(species, location, radius, D)
+        : base_type(species, location, radius, D),
+        coordinate_table_(NULL), pid_indexed_(false)
     {
         ;
     }
@@ -229,6 +246,7 @@ public:
     virtual void add_voxel(const coordinate_id_pair_type& info)
     {
         voxels_.push_back(info);
+        index_(info, voxels_.size() - 1);
     }
 
     virtual void replace_voxel(
@@ -242,6 +260,11 @@ public:
             throw NotFound("no corresponding coordinate was found.");
         }
 
+        if (coordinate_table_ == NULL)
+        {
+            coordinate_index_.erase(from_coord);
+        }
+        index_coordinate_(to_coord, itr - voxels_.begin());
         (*itr).coordinate = to_coord;
     }
 
@@ -271,7 +294,12 @@ public:
     void remove_voxel(const container_type::iterator& position)
     {
         // voxels_.erase(position);
-        (*position) = voxels_.back();
+        unindex_(*position);
+        if (position + 1 != voxels_.end())
+        {
+            (*position) = voxels_.back();
+            index_(*position, position - voxels_.begin());
+        }
         voxels_.pop_back();
     }
 
@@ -292,7 +320,57 @@ public:
             throw NotFound("no corresponding coordinate was found.");
         }
 
+        unindex_(*itr);
         (*itr) = to_info;
+        index_(*itr, itr - voxels_.begin());
+    }
+
+    /**
+     * keep the coordinate index in a flat table shared by the pools of
+     * a space, which has an entry for each coordinate in the space.
+     * an entry is trusted only if the voxel at the position in voxels_
+     * has the coordinate, so that the entries are never erased.
+     * @param table the table owned by the space, or NULL for a hash map
+     */
+    void use_coordinate_table(coordinate_table_type* table)
+    {
+        coordinate_table_ = table;
+        coordinate_index_.clear();
+        for (std::size_t i(0); i < voxels_.size(); ++i)
+        {
+            index_coordinate_(voxels_[i].coordinate, i);
+        }
+    }
+
+    /**
+     * fix the coordinate index after voxels were moved without it,
+     * e.g. by LatticeSpace::move_to_neighbor_unindexed.
+     * @param moved pairs of the old coordinate and the position in voxels_
+     */
+    void reindex_voxels(
+        const std::vector<std::pair<coordinate_type, std::size_t> >& moved)
+    {
+        if (coordinate_table_ != NULL)
+        {
+            for (std::vector<std::pair<coordinate_type, std::size_t> >::const_iterator
+                    itr(moved.begin()); itr != moved.end(); ++itr)
+            {
+                (*coordinate_table_)[voxels_[(*itr).second].coordinate] = (*itr).second;
+            }
+            return;
+        }
+
+        // a new coordinate may be the old one of another voxel.
+        for (std::vector<std::pair<coordinate_type, std::size_t> >::const_iterator
+                itr(moved.begin()); itr != moved.end(); ++itr)
+        {
+            coordinate_index_.erase((*itr).first);
+        }
+        for (std::vector<std::pair<coordinate_type, std::size_t> >::const_iterator
+                itr(moved.begin()); itr != moved.end(); ++itr)
+        {
+            coordinate_index_[voxels_[(*itr).second].coordinate] = (*itr).second;
+        }
     }
 
     void swap(const container_type::iterator& a, const container_type::iterator& b)
@@ -305,6 +383,8 @@ public:
         const container_type::value_type info(*b);
         (*b) = (*a);
         (*a) = info;
+        index_(*a, a - voxels_.begin());
+        index_(*b, b - voxels_.begin());
     }
 
     coordinate_id_pair_type& at(const Integer& index)
@@ -335,6 +415,61 @@ public:
     void shuffle(RandomNumberGenerator& rng)
     {
         ecell4::shuffle(rng, voxels_);
+
+        for (std::size_t i(0); i < voxels_.size(); ++i)
+        {
+            index_(voxels_[i], i);
+        }
+    }
+
+    /**
+     * reorder the voxels by key(coordinate), and rebuild the indexes.
+     * @param key a unary function with result_type
+     */
+    template <typename Tkey_>
+    void sort_voxels(const Tkey_& key)
+    {
+        typedef std::pair<typename Tkey_::result_type, std::size_t> keyed_type;
+
+        std::vector<keyed_type> keyed;
+        keyed.reserve(voxels_.size());
+        for (std::size_t i(0); i < voxels_.size(); ++i)
+        {
+            keyed.push_back(keyed_type(key(voxels_[i].coordinate), i));
+        }
+        std::sort(keyed.begin(), keyed.end());
+
+        container_type sorted;
+        sorted.reserve(voxels_.size());
+        for (typename std::vector<keyed_type>::const_iterator itr(keyed.begin());
+             itr != keyed.end(); ++itr)
+        {
+            sorted.push_back(voxels_[(*itr).second]);
+        }
+        voxels_.swap(sorted);
+
+        // the hash maps are built anew before the old ones are released,
+        // so that their nodes are allocated in the new order.
+        pid_index_type pid_index;
+        coordinate_index_type coordinate_index;
+        for (std::size_t i(0); i < voxels_.size(); ++i)
+        {
+            if (coordinate_table_ != NULL)
+            {
+                (*coordinate_table_)[voxels_[i].coordinate] = i;
+            }
+            else
+            {
+                coordinate_index[voxels_[i].coordinate] = i;
+            }
+
+            if (pid_indexed_ && voxels_[i].pid != ParticleID())
+            {
+                pid_index[voxels_[i].pid] = i;
+            }
+        }
+        pid_index_.swap(pid_index);
+        coordinate_index_.swap(coordinate_index);
     }
 
     container_type::iterator begin()
@@ -359,28 +494,32 @@ public:
 
     container_type::iterator find(const ParticleID& pid)
     {
-        container_type::iterator itr;
-        for (itr = voxels_.begin(); itr != voxels_.end(); ++itr)
+        if (!pid_indexed_)
         {
-            if ((*itr).pid == pid)
-            {
-                break;
-            }
+            index_pids_();
+        }
+
+        pid_index_type::const_iterator i(pid_index_.find(pid));
+        if (i == pid_index_.end())
+        {
+            return voxels_.end();
         }
-        return itr;
+        return voxels_.begin() + (*i).second;
     }
 
     container_type::const_iterator find(const ParticleID& pid) const
     {
-        container_type::const_iterator itr;
-        for (itr = voxels_.begin(); itr != voxels_.end(); ++itr)
+        if (!pid_indexed_)
         {
-            if ((*itr).pid == pid)
-            {
-                break;
-            }
+            index_pids_();
         }
-        return itr;
+
+        pid_index_type::const_iterator i(pid_index_.find(pid));
+        if (i == pid_index_.end())
+        {
+            return voxels_.end();
+        }
+        return voxels_.begin() + (*i).second;
     }
 
 protected:
@@ -388,46 +527,103 @@ protected:
     container_type::iterator find(
         coordinate_type coord, const std::size_t candidate = 0)
     {
-        container_type::iterator itr;
-        if (candidate < voxels_.size())
+        if (candidate < voxels_.size()
+            && voxels_[candidate].coordinate == coord)
+        {
+            return voxels_.begin() + candidate;
+        }
+
+        return voxels_.begin() + position_of_(coord);
+    }
+
+    container_type::const_iterator find(
+        coordinate_type coord, const std::size_t candidate = 0) const
+    {
+        if (candidate < voxels_.size()
+            && voxels_[candidate].coordinate == coord)
         {
-            itr = voxels_.begin() + candidate;
-            if ((*itr).coordinate == coord)
-                return itr;
+            return voxels_.begin() + candidate;
         }
-        for (itr = voxels_.begin(); itr != voxels_.end(); ++itr)
+
+        return voxels_.begin() + position_of_(coord);
+    }
+
+    /**
+     * return the position of coord in voxels_, or voxels_.size() if none.
+     */
+    std::size_t position_of_(const coordinate_type& coord) const
+    {
+        if (coordinate_table_ != NULL)
         {
-            if ((*itr).coordinate == coord)
+            const std::size_t position((*coordinate_table_)[coord]);
+            if (position < voxels_.size() && voxels_[position].coordinate == coord)
             {
-                break;
+                return position;
             }
+            return voxels_.size();
         }
-        return itr;
+
+        coordinate_index_type::const_iterator i(coordinate_index_.find(coord));
+        if (i == coordinate_index_.end())
+        {
+            return voxels_.size();
+        }
+        return (*i).second;
     }
 
-    container_type::const_iterator find(
-        coordinate_type coord, const std::size_t candidate = 0) const
+    void index_coordinate_(const coordinate_type& coord, const std::size_t position)
     {
-        container_type::const_iterator itr;
-        if (candidate < voxels_.size())
+        if (coordinate_table_ != NULL)
         {
-            itr = voxels_.begin() + candidate;
-            if ((*itr).coordinate == coord)
-                return itr;
+            (*coordinate_table_)[coord] = position;
         }
-        for (itr = voxels_.begin(); itr != voxels_.end(); ++itr)
+        else
         {
-            if ((*itr).coordinate == coord)
+            coordinate_index_[coord] = position;
+        }
+    }
+
+    void index_pids_() const
+    {
+        pid_index_.clear();
+        for (std::size_t i(0); i < voxels_.size(); ++i)
+        {
+            if (voxels_[i].pid != ParticleID())
             {
-                break;
+                pid_index_[voxels_[i].pid] = i;
             }
         }
-        return itr;
+        pid_indexed_ = true;
+    }
+
+    void index_(const coordinate_id_pair_type& info, const std::size_t position)
+    {
+        index_coordinate_(info.coordinate, position);
+        if (pid_indexed_ && info.pid != ParticleID())
+        {
+            pid_index_[info.pid] = position;
+        }
+    }
+
+    void unindex_(const coordinate_id_pair_type& info)
+    {
+        if (coordinate_table_ == NULL)
+        {
+            coordinate_index_.erase(info.coordinate);
+        }
+        if (pid_indexed_ && info.pid != ParticleID())
+        {
+            pid_index_.erase(info.pid);
+        }
     }
 
 protected:
 
     container_type voxels_;
+    coordinate_index_type coordinate_index_;
+    coordinate_table_type* coordinate_table_; // owned by the space
+    mutable pid_index_type pid_index_;
+    mutable bool pid_indexed_;
 };
 
 } // ecell4
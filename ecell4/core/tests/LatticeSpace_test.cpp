@@ -16,6 +16,53 @@
 
 using namespace ecell4;
 
+/**
+ * remove and move voxels of sp, and check the indexes of the pool
+ * against the voxels.
+ */
+void check_molecule_pool_index(
+    LatticeSpaceVectorImpl& space, const Species& sp, const Real radius, const Real D)
+{
+    SerialIDGenerator<ParticleID> sidgen;
+    std::vector<ParticleID> pids;
+    for (Integer i(0); i < 10; ++i)
+    {
+        pids.push_back(sidgen());
+        BOOST_CHECK(space.update_voxel(
+            pids.back(), Voxel(sp, space.inner2coordinate(i * 7), radius, D)));
+    }
+
+    // the last one is swapped into the place of the removed one.
+    BOOST_CHECK(space.remove_voxel(pids[2]));
+    BOOST_CHECK(space.remove_voxel(space.inner2coordinate(5 * 7)));
+    BOOST_CHECK(!space.has_voxel(pids[2]));
+    BOOST_CHECK(!space.has_voxel(pids[5]));
+    BOOST_CHECK(space.get_voxel_pool_at(space.inner2coordinate(2 * 7))->is_vacant());
+    BOOST_CHECK_EQUAL(space.get_voxel_at(space.inner2coordinate(9 * 7)).first, pids[9]);
+
+    MoleculePool* mt(space.find_molecule_pool(sp));
+    BOOST_CHECK_EQUAL(mt->size(), 8);
+    for (Integer i(0); i < mt->size(); ++i)
+    {
+        MoleculePool::coordinate_id_pair_type& info((*mt)[i]);
+        for (Integer nrand(0); nrand < 12; ++nrand)
+        {
+            if (space.move_to_neighbor(mt, mt->location(), info, nrand).second)
+            {
+                break;
+            }
+        }
+    }
+
+    for (Integer i(0); i < mt->size(); ++i)
+    {
+        const MoleculePool::coordinate_id_pair_type& info((*mt)[i]);
+        BOOST_CHECK(space.has_voxel(info.pid));
+        BOOST_CHECK_EQUAL(space.get_voxel(info.pid).second.coordinate(), info.coordinate);
+        BOOST_CHECK_EQUAL(space.get_voxel_at(info.coordinate).first, info.pid);
+    }
+}
+
 struct Fixture
 {
     const Real3 edge_lengths;
@@ -221,6 +268,46 @@ BOOST_AUTO_TEST_CASE(LatticeSpace_test_move)
     BOOST_CHECK(!space.move(coord, to_coord));
 }
 
+BOOST_AUTO_TEST_CASE(LatticeSpace_test_molecule_pool_index)
+{
+    check_molecule_pool_index(space, sp, radius, D);
+}
+
+BOOST_AUTO_TEST_CASE(LatticeSpace_test_molecule_pool_index_without_table)
+{
+    // the pools fall back to the hash map for coordinates.
+    LatticeSpaceVectorImpl hashed(edge_lengths, voxel_radius, false, false);
+    check_molecule_pool_index(hashed, sp, radius, D);
+}
+
+BOOST_AUTO_TEST_CASE(LatticeSpace_test_sort_voxels)
+{
+    std::vector<ParticleID> pids;
+    for (Integer i(0); i < 20; ++i)
+    {
+        pids.push_back(sidgen());
+        BOOST_CHECK(space.update_voxel(
+            pids.back(), Voxel(sp, space.inner2coordinate((i * 97) % 294), radius, D)));
+    }
+
+    space.sort_voxels(sp);
+
+    MoleculePool* mt(space.find_molecule_pool(sp));
+    BOOST_CHECK_EQUAL(mt->size(), 20);
+    for (Integer i(1); i < mt->size(); ++i)
+    {
+        BOOST_CHECK(space.morton_key((*mt)[i - 1].coordinate)
+                    < space.morton_key((*mt)[i].coordinate));
+    }
+
+    for (std::vector<ParticleID>::const_iterator itr(pids.begin());
+         itr != pids.end(); ++itr)
+    {
+        const LatticeSpace::coordinate_type coord(space.get_voxel(*itr).second.coordinate());
+        BOOST_CHECK_EQUAL(space.get_voxel_at(coord).first, *itr);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(LatticeSpace_test_update_molecule)
 {
     Species reactant(std::string("Reactant")),
@@ -297,6 +384,72 @@ BOOST_AUTO_TEST_CASE(LatticeSpace_test_neighbor)
     }
 }
 
+BOOST_AUTO_TEST_CASE(LatticeSpace_test_neighbor_table)
+{
+    const Integer3 shape(space.shape());
+    const Integer NUM_ROW(shape.row);
+    const Integer NUM_COLROW(shape.col * shape.row);
+    for (LatticeSpace::coordinate_type coord(0); coord < space.size(); ++coord)
+    {
+        if (!space.is_inside(coord))
+        {
+            BOOST_CHECK_EQUAL(space.num_neighbors(coord), 0);
+            BOOST_CHECK_THROW(space.get_neighbor(coord, 0), NotFound);
+            continue;
+        }
+
+        const Integer odd_col(((coord % NUM_COLROW) / NUM_ROW) & 1);
+        const Integer odd_lay((coord / NUM_COLROW) & 1);
+        const Integer shift(odd_col ^ odd_lay);
+        const LatticeSpace::coordinate_type expected[] = {
+            coord - 1,
+            coord + 1,
+            coord + shift - NUM_ROW - 1,
+            coord + shift - NUM_ROW,
+            coord + shift + NUM_ROW - 1,
+            coord + shift + NUM_ROW,
+            coord - (2 * odd_col - 1) * NUM_COLROW - NUM_ROW,
+            coord - (2 * odd_col - 1) * NUM_COLROW + NUM_ROW,
+            coord + shift - NUM_COLROW - 1,
+            coord + shift - NUM_COLROW,
+            coord + shift + NUM_COLROW - 1,
+            coord + shift + NUM_COLROW};
+        for (Integer i(0); i < 12; ++i)
+        {
+            BOOST_CHECK_EQUAL(space.get_neighbor(coord, i), expected[i]);
+            BOOST_CHECK_EQUAL(space.get_neighbor_unsafe(coord, i), expected[i]);
+        }
+        BOOST_CHECK_THROW(space.get_neighbor(coord, 12), NotFound);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(LatticeSpace_test_many_voxel_pools)
+{
+    // more pools than an 8-bit index can tell apart.
+    const Integer num_species(290);
+    for (Integer i(0); i < num_species; ++i)
+    {
+        std::ostringstream oss;
+        oss << "A" << i;
+        BOOST_CHECK(space.update_voxel(
+            sidgen(), Voxel(Species(oss.str()), space.inner2coordinate(i), radius, D)));
+    }
+
+    for (Integer i(0); i < num_species; ++i)
+    {
+        std::ostringstream oss;
+        oss << "A" << i;
+        const Species species(oss.str());
+        BOOST_CHECK_EQUAL(space.num_voxels_exact(species), 1);
+        BOOST_CHECK_EQUAL(
+            space.get_voxel_at(space.inner2coordinate(i)).second.species(), species);
+    }
+
+    BOOST_CHECK(space.remove_voxel(space.inner2coordinate(num_species - 1)));
+    BOOST_CHECK(space.get_voxel_pool_at(space.inner2coordinate(num_species - 1))->is_vacant());
+    BOOST_CHECK_EQUAL(space.num_voxels(), num_species - 1);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 struct PeriodicFixture
@@ -10,6 +10,8 @@
 #include <boost/test/floating_point_comparison.hpp>
 
 #include <ecell4/core/ParticleSpaceCellListImpl.hpp>
+#include <ecell4/core/ParticleSpaceCellListSoAImpl.hpp>
+#include <ecell4/core/RandomNumberGenerator.hpp>
 #include <ecell4/core/SerialIDGenerator.hpp>
 
 using namespace ecell4;
@@ -147,4 +149,172 @@ BOOST_AUTO_TEST_CASE(ParticleSpaceCellListImpl_test_constructor)
     BOOST_CHECK_EQUAL((*space).matrix_sizes(), matrix_sizes);
 }
 
+BOOST_AUTO_TEST_CASE(ParticleSpaceCellListImpl_test_records)
+{
+    boost::scoped_ptr<ParticleSpaceCellListImpl> space(new ParticleSpaceCellListImpl(edge_lengths, matrix_sizes));
+    SerialIDGenerator<ParticleID> pidgen;
+
+    const ParticleID pid1(pidgen()), pid2(pidgen()), pid3(pidgen());
+    const Species sp1("A"), sp2("B");
+
+    (*space).update_particle(pid1, Particle(sp1, edge_lengths * 0.5, radius, 1));
+    (*space).update_particle(pid2, Particle(sp2, edge_lengths * 0.25, radius, 2));
+    (*space).update_particle(pid3, Particle(sp1, edge_lengths * 0.75, radius, 1));
+
+    const ParticleSpaceCellListImpl::record_container_type& records((*space).records());
+    BOOST_CHECK_EQUAL(records.size(), 3);
+    BOOST_CHECK_EQUAL(records[0].second.species_id, records[2].second.species_id);
+    BOOST_CHECK(records[0].second.species_id != records[1].second.species_id);
+    BOOST_CHECK_EQUAL((*space).get_species(records[1].second.species_id), sp2);
+    BOOST_CHECK_EQUAL(records[1].second.D, 2);
+
+    // the particles are rebuilt after a change
+    BOOST_CHECK_EQUAL((*space).particles().size(), 3);
+    (*space).update_particle(pid2, Particle(sp1, edge_lengths * 0.3, radius, 1));
+    BOOST_CHECK_EQUAL((*space).particles()[1].second.species(), sp1);
+    BOOST_CHECK_EQUAL((*space).particles()[1].second.position(), edge_lengths * 0.3);
+    BOOST_CHECK_EQUAL((*space).num_particles_exact(sp1), 3);
+    BOOST_CHECK_EQUAL((*space).num_particles_exact(sp2), 0);
+    BOOST_CHECK_EQUAL((*space).list_particles_exact(sp1).size(), 3);
+
+    (*space).remove_particle(pid1);
+    BOOST_CHECK_EQUAL((*space).particles().size(), 2);
+    BOOST_CHECK_EQUAL((*space).list_particles(sp1).size(), 2);
+    BOOST_CHECK_EQUAL((*space).get_particle(pid3).second.position(), edge_lengths * 0.75);
+
+    // a move to another cell is seen in the particles built again
+    BOOST_CHECK_EQUAL((*space).list_particles().size(), 2);
+    (*space).move_particle(pid3, edge_lengths * 0.1);
+    BOOST_CHECK_EQUAL((*space).get_particle(pid3).second.position(), edge_lengths * 0.1);
+    BOOST_CHECK_EQUAL((*space).get_particle(pid3).second.species(), sp1);
+    BOOST_CHECK_EQUAL((*space).list_particles()[0].second.position(), edge_lengths * 0.1);
+    BOOST_CHECK((*space).has_particle_within_radius(edge_lengths * 0.1, radius));
+    BOOST_CHECK(!(*space).has_particle_within_radius(edge_lengths * 0.75, radius));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
+
+struct overlap_distance_accumulator
+{
+    overlap_distance_accumulator()
+        : num_visits(0), sum(0.0)
+    {
+        ;
+    }
+
+    bool operator()(const std::pair<ParticleID, ParticleRecord>& pp, const Real dist)
+    {
+        ++num_visits;
+        sum += dist;
+        return true;
+    }
+
+    Integer num_visits;
+    Real sum;
+};
+
+BOOST_FIXTURE_TEST_CASE(ParticleSpaceCellListImpl_test_queries_within_radius, Fixture)
+{
+    ParticleSpaceCellListImpl space(edge_lengths, matrix_sizes);
+    SerialIDGenerator<ParticleID> pidgen;
+
+    const ParticleID pid1(pidgen()), pid2(pidgen()), pid3(pidgen());
+    const Species sp1("A");
+    space.update_particle(pid1, Particle(sp1, Real3(0.5, 0.5, 0.5), radius, 0));
+    space.update_particle(pid2, Particle(sp1, Real3(0.511, 0.5, 0.5), radius, 0));
+    space.update_particle(pid3, Particle(sp1, Real3(0.997, 0.5, 0.5), radius, 0));
+
+    const Real3 pos(0.509, 0.5, 0.5);
+    BOOST_CHECK(space.has_particle_within_radius(pos, radius));
+    BOOST_CHECK(space.has_particle_within_radius(pos, radius, pid1));
+    BOOST_CHECK(!space.has_particle_within_radius(pos, radius, pid1, pid2));
+    BOOST_CHECK_EQUAL(space.count_particles_within_radius(pos, radius), 2);
+    BOOST_CHECK_EQUAL(space.count_particles_within_radius(pos, radius, pid2), 1);
+
+    ParticleSpaceCellListImpl::neighbor_container_type neighbors;
+    space.collect_particles_within_radius(pos, radius, neighbors, pid3, ParticleID(), true);
+    BOOST_CHECK_EQUAL(neighbors.size(), 2);
+    BOOST_CHECK_EQUAL(neighbors[0].first.first, pid2);
+    BOOST_CHECK_EQUAL(neighbors[1].first.first, pid1);
+    BOOST_CHECK_CLOSE(neighbors[0].second, 0.002 - radius, 1e-6);
+
+    // the buffer is cleared
+    space.collect_particles_within_radius(pos, radius, neighbors, pid1);
+    BOOST_CHECK_EQUAL(neighbors.size(), 1);
+
+    // across the periodic boundary
+    BOOST_CHECK(space.has_particle_within_radius(Real3(0.001, 0.5, 0.5), radius));
+
+    overlap_distance_accumulator visitor;
+    BOOST_CHECK(space.each_particle_within_radius(pos, radius, visitor));
+    BOOST_CHECK_EQUAL(visitor.num_visits, 2);
+    BOOST_CHECK_CLOSE(visitor.sum, 0.011 - 2 * radius, 1e-6);
+}
+
+BOOST_FIXTURE_TEST_CASE(ParticleSpaceCellListSoAImpl_test_queries_within_radius, Fixture)
+{
+    ParticleSpaceCellListImpl space1(edge_lengths, matrix_sizes);
+    ParticleSpaceCellListSoAImpl space2(edge_lengths, matrix_sizes);
+    SerialIDGenerator<ParticleID> pidgen;
+    GSLRandomNumberGenerator rng(0);
+
+    const Species sp1("A"), sp2("B");
+    std::vector<ParticleID> pids;
+    for (Integer i(0); i < 1000; ++i)
+    {
+        const ParticleID pid(pidgen());
+        const Particle p(i % 2 == 0 ? sp1 : sp2,
+            Real3(rng.uniform(0, 1), rng.uniform(0, 1), rng.uniform(0, 1)),
+            rng.uniform(0.01, 0.02), 0);
+        BOOST_CHECK(space1.update_particle(pid, p));
+        BOOST_CHECK(space2.update_particle(pid, p));
+        pids.push_back(pid);
+    }
+
+    // move, change and remove some
+    for (Integer i(0); i < 500; ++i)
+    {
+        const ParticleID& pid(pids[rng.uniform_int(0, pids.size() - 1)]);
+        const Particle p(rng.uniform(0, 1) < 0.5 ? sp1 : sp2,
+            Real3(rng.uniform(0, 1), rng.uniform(0, 1), rng.uniform(0, 1)),
+            rng.uniform(0.01, 0.02), 0);
+        BOOST_CHECK(!space1.update_particle(pid, p));
+        BOOST_CHECK(!space2.update_particle(pid, p));
+    }
+    for (Integer i(0); i < 100; ++i)
+    {
+        const std::size_t j(rng.uniform_int(0, pids.size() - 1));
+        space1.remove_particle(pids[j]);
+        space2.remove_particle(pids[j]);
+        pids.erase(pids.begin() + j);
+    }
+
+    BOOST_CHECK_EQUAL(space2.num_particles(), 900);
+    BOOST_CHECK_EQUAL(space2.num_particles(sp1), space1.num_particles(sp1));
+
+    ParticleSpaceCellListImpl::neighbor_container_type neighbors1, neighbors2;
+    for (Integer i(0); i < 100; ++i)
+    {
+        const Real3 pos(rng.uniform(0, 1), rng.uniform(0, 1), rng.uniform(0, 1));
+        const Real r(rng.uniform(0.01, 0.05));
+        const ParticleID& ignore(pids[i]);
+
+        BOOST_CHECK_EQUAL(space2.count_particles_within_radius(pos, r, ignore),
+                          space1.count_particles_within_radius(pos, r, ignore));
+        BOOST_CHECK_EQUAL(space2.has_particle_within_radius(pos, r),
+                          space1.has_particle_within_radius(pos, r));
+
+        space1.collect_particles_within_radius(pos, r, neighbors1, ignore, ParticleID(), true);
+        space2.collect_particles_within_radius(pos, r, neighbors2, ignore, ParticleID(), true);
+        BOOST_CHECK_EQUAL(neighbors2.size(), neighbors1.size());
+        for (std::size_t j(0); j < std::min(neighbors1.size(), neighbors2.size()); ++j)
+        {
+            BOOST_CHECK_EQUAL(neighbors2[j].first.first, neighbors1[j].first.first);
+            BOOST_CHECK_EQUAL(neighbors2[j].second, neighbors1[j].second);
+        }
+
+        const ParticleSpace& base(space2);
+        BOOST_CHECK_EQUAL(base.list_particles_within_radius(pos, r).size(),
+                          space1.list_particles_within_radius(pos, r).size());
+    }
+}
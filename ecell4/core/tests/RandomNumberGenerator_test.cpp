@@ -1,49 +1,170 @@
-#include <cppunit/TestCase.h>
-#include <cppunit/extensions/HelperMacros.h>
-#include <cppunit/ui/text/TestRunner.h>
+#define BOOST_TEST_MODULE "RandomNumberGenerator_test"
+
+#ifdef UNITTEST_FRAMEWORK_LIBRARY_EXIST
+#   include <boost/test/unit_test.hpp>
+#else
+#   define BOOST_TEST_NO_LIB
+#   include <boost/test/included/unit_test.hpp>
+#endif
+
+#include <boost/test/floating_point_comparison.hpp>
 
 #include <ecell4/core/RandomNumberGenerator.hpp>
 
 using namespace ecell4;
 
 
-template<typename Timpl_>
-class RandomNumberGeneratorTest
-    : public CppUnit::TestFixture
+BOOST_AUTO_TEST_CASE(RandomNumberGenerator_test_seed)
 {
-public:
+    GSLRandomNumberGenerator rng1, rng2;
+    rng1.seed(0);
+    rng2.seed(0);
+    for (Integer i(0); i < 100; ++i)
+    {
+        BOOST_CHECK_EQUAL(rng1.uniform(0, 1), rng2.uniform(0, 1));
+    }
+}
 
-    typedef Timpl_ implementation_type;
+BOOST_AUTO_TEST_CASE(RandomNumberGenerator_test_fill_uniform)
+{
+    const std::size_t n(1000);
+    GSLRandomNumberGenerator rng1(0), rng2(0);
 
-    CPPUNIT_TEST_SUITE(RandomNumberGeneratorTest);
-    CPPUNIT_TEST(test_seed);
-    CPPUNIT_TEST_SUITE_END();
+    std::vector<Real> values(n);
+    rng1.fill_uniform(&values[0], n, -2.0, 3.0);
+    for (std::size_t i(0); i < n; ++i)
+    {
+        BOOST_CHECK(values[i] >= -2.0 && values[i] < 3.0);
+        BOOST_CHECK_EQUAL(values[i], rng2.uniform(-2.0, 3.0));
+    }
+}
 
-public:
+BOOST_AUTO_TEST_CASE(RandomNumberGenerator_test_fill_uniform_int)
+{
+    const std::size_t n(1000);
+    GSLRandomNumberGenerator rng1(0), rng2(0);
 
-    void setUp()
+    std::vector<Integer> values(n);
+    rng1.fill_uniform_int(&values[0], n, 0, 11);
+    for (std::size_t i(0); i < n; ++i)
     {
-        target = new implementation_type();
+        BOOST_CHECK(values[i] >= 0 && values[i] <= 11);
+        BOOST_CHECK_EQUAL(values[i], rng2.uniform_int(0, 11));
     }
 
-    void tearDown()
+    BOOST_CHECK_THROW(rng1.fill_uniform_int(&values[0], n, 1, 0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(RandomNumberGenerator_test_fill_gaussian)
+{
+    const std::size_t n(100001); // odd
+    GSLRandomNumberGenerator rng(0);
+
+    std::vector<Real> values(n);
+    rng.fill_gaussian(&values[0], n, 2.0, 1.0);
+
+    Real sum(0.0), sum2(0.0);
+    for (std::size_t i(0); i < n; ++i)
     {
-        delete target;
+        sum += values[i];
+        sum2 += values[i] * values[i];
     }
+    const Real mean(sum / n), var(sum2 / n - mean * mean);
+    BOOST_CHECK_CLOSE(mean, 1.0, 2.0);
+    BOOST_CHECK_CLOSE(var, 4.0, 2.0);
+}
 
-    void test_seed();
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_known_answer)
+{
+    // the known answers of Philox4x32-10 by Random123
+    const boost::uint32_t zeros[4] = {0, 0, 0, 0};
+    boost::uint32_t block[4];
+    PhiloxRandomNumberGenerator::generate_block(zeros, zeros, block);
+    BOOST_CHECK_EQUAL(block[0], 0x6627e8d5u);
+    BOOST_CHECK_EQUAL(block[1], 0xe169c58du);
+    BOOST_CHECK_EQUAL(block[2], 0xbc57ac4cu);
+    BOOST_CHECK_EQUAL(block[3], 0x9b00dbd8u);
 
-private:
+    const boost::uint32_t counter[4] = {0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344};
+    const boost::uint32_t key[2] = {0xa4093822, 0x299f31d0};
+    PhiloxRandomNumberGenerator::generate_block(counter, key, block);
+    BOOST_CHECK_EQUAL(block[0], 0xd16cfe09u);
+    BOOST_CHECK_EQUAL(block[1], 0x94fdccebu);
+    BOOST_CHECK_EQUAL(block[2], 0x5001e420u);
+    BOOST_CHECK_EQUAL(block[3], 0x24126ea1u);
+}
 
-    RandomNumberGenerator *target;
-};
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_seed)
+{
+    PhiloxRandomNumberGenerator rng1(1), rng2, rng3(2);
+    rng2.seed(1);
+    Integer num_same(0);
+    for (Integer i(0); i < 100; ++i)
+    {
+        const Real x(rng1.uniform(0, 1));
+        BOOST_CHECK(x >= 0 && x < 1);
+        BOOST_CHECK_EQUAL(x, rng2.uniform(0, 1));
+        if (x == rng3.uniform(0, 1))
+        {
+            ++num_same;
+        }
+    }
+    BOOST_CHECK(num_same < 10);
 
-CPPUNIT_TEST_SUITE_REGISTRATION(
-    RandomNumberGeneratorTest<GSLRandomNumberGenerator>);
+    std::vector<Real> values(100);
+    rng1.seed(1);
+    rng1.fill_uniform(&values[0], values.size(), -1.0, 1.0);
+    rng2.seed(1);
+    for (std::size_t i(0); i < values.size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(values[i], rng2.uniform(-1.0, 1.0));
+    }
+}
 
-template<typename Timpl_>
-void RandomNumberGeneratorTest<Timpl_>::test_seed()
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_split)
 {
-    target->seed(0);
-    // CPPUNIT_ASSERT_EQUAL(1, 2);
+    PhiloxRandomNumberGenerator rng(0);
+    rng.uniform_int(0, 100); // the position of the parent does not matter
+
+    boost::shared_ptr<PhiloxRandomNumberGenerator>
+        s1(rng.split(1)), s1_(rng.split(1)), s2(rng.split(2));
+    BOOST_CHECK_EQUAL(s1->stream_id(), 1);
+    BOOST_CHECK_EQUAL(s2->stream_id(), 2);
+
+    Integer num_same(0);
+    for (Integer i(0); i < 100; ++i)
+    {
+        const Integer x(s1->uniform_int(0, 1000000));
+        BOOST_CHECK_EQUAL(x, s1_->uniform_int(0, 1000000));
+        if (x == s2->uniform_int(0, 1000000))
+        {
+            ++num_same;
+        }
+    }
+    BOOST_CHECK(num_same < 10);
+
+    // the stream 0 is the one of the seed
+    PhiloxRandomNumberGenerator rng0(0);
+    BOOST_CHECK_EQUAL(rng.split(0)->random(), rng0.random());
+}
+
+BOOST_AUTO_TEST_CASE(PhiloxRandomNumberGenerator_test_jump)
+{
+    // the rest of the current block is discarded
+    PhiloxRandomNumberGenerator rng1(0), rng2(0);
+    rng1.random();
+    rng1.jump();
+    for (Integer i(0); i < 4; ++i)
+    {
+        rng2.random();
+    }
+    rng2.jump();
+    BOOST_CHECK_EQUAL(rng1.random(), rng2.random());
+    BOOST_CHECK_EQUAL(rng1.stream_id(), 0);
+
+    boost::uint32_t counter[4] = {0, 1, 0, 0}, key[2] = {0, 0}, block[4];
+    PhiloxRandomNumberGenerator::generate_block(counter, key, block);
+    PhiloxRandomNumberGenerator rng3(0);
+    rng3.jump();
+    BOOST_CHECK_EQUAL(rng3.random(), block[0] / 4294967296.0);
 }
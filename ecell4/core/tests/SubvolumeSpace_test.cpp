@@ -70,3 +70,39 @@ BOOST_AUTO_TEST_CASE(SubvolumeSpace_test_num_molecules)
 {
     SubvolumeSpace_test_num_molecules_template<SubvolumeSpaceVectorImpl>();
 }
+
+template<typename Timpl_>
+void SubvolumeSpace_test_species_index_template()
+{
+    const Real L(1e-6);
+    const Real3 edge_lengths(L, L, L);
+    const Integer3 matrix_sizes(2, 3, 4);
+    Timpl_ target(edge_lengths, matrix_sizes);
+
+    const Species sp1("A"), sp2("B");
+    BOOST_CHECK_THROW(target.species_index(sp1), NotFound);
+    const boost::shared_ptr<SubvolumeSpace::PoolBase> pool1(
+        target.reserve_pool(sp1, 0.0, ""));
+    target.add_molecules(sp1, 60, 23);
+    target.reserve_pool(sp2, 0.0, "");
+    target.add_molecules(sp2, 30, 0);
+    pool1->add_molecules(10, 0);
+
+    BOOST_CHECK_EQUAL(target.species_index(sp1), 0);
+    BOOST_CHECK_EQUAL(target.species_index(sp2), 1);
+    BOOST_CHECK(target.species()[target.species_index(sp2)] == sp2);
+    BOOST_CHECK_EQUAL(target.num_molecules_by_index(0, 0), 10);
+    BOOST_CHECK_EQUAL(target.num_molecules_by_index(0, 23), 60);
+    BOOST_CHECK_EQUAL(target.num_molecules_by_index(1, 0), 30);
+    BOOST_CHECK_EQUAL(pool1->num_molecules(), 70);
+    BOOST_CHECK_EQUAL(target.get_pool(sp2)->num_molecules(0), 30);
+
+    // the counts of "B" follow those of "A", but are not readable from pool1.
+    BOOST_CHECK_THROW(pool1->num_molecules(24), std::out_of_range);
+    BOOST_CHECK_THROW(pool1->num_molecules(-1), std::out_of_range);
+}
+
+BOOST_AUTO_TEST_CASE(SubvolumeSpace_test_species_index)
+{
+    SubvolumeSpace_test_species_index_template<SubvolumeSpaceVectorImpl>();
+}
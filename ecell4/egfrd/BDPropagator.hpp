@@ -84,11 +84,17 @@ public:
 
     bool operator()()
     {
-        if (queue_.empty())
-            return false;
+        // a particle removed before its turn is skipped here,
+        // instead of being erased from queue_.
+        particle_id_type pid;
+        do
+        {
+            if (queue_.empty())
+                return false;
 
-        particle_id_type pid(queue_.back());
-        queue_.pop_back();
+            pid = queue_.back();
+            queue_.pop_back();
+        } while (!tx_.has_particle(pid));
         particle_id_pair pp(tx_.get_particle(pid));
 
         LOG_DEBUG(("propagating particle %s", boost::lexical_cast<std::string>(pp.first).c_str()));
@@ -410,10 +416,6 @@ private:
     {
         LOG_DEBUG(("remove particle %s", boost::lexical_cast<std::string>(pid).c_str()));
         tx_.remove_particle(pid);
-        typename particle_id_vector_type::iterator i(
-            std::find(queue_.begin(), queue_.end(), pid));
-        if (queue_.end() != i)
-            queue_.erase(i);
     }
 
 private:
@@ -211,7 +211,7 @@ protected:
                 dt, num_retries_,
                 base_type::rrec_.get(), 0,
                 make_select_first_range(base_type::world_->
-                                        get_particles_range()),
+                                        get_particle_records_range()),
                 potentials_);
             while (propagator());
         }
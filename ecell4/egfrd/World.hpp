@@ -295,6 +295,9 @@ public:
     typedef sized_iterator_range<typename particle_matrix_type::const_iterator> particle_id_pair_range;
     typedef typename particle_matrix_type::matrix_sizes_type matrix_sizes_type;
     typedef ecell4::ParticleSpaceCellListImpl particle_space_type;
+    typedef sized_iterator_range<
+        particle_space_type::record_container_type::const_iterator>
+        particle_record_range;
     typedef typename base_type::transaction_type transaction_type;
     typedef typename base_type::time_type time_type;
 
@@ -901,6 +904,16 @@ public:
         return particle_id_pair_range(particles.begin(), particles.end(), particles.size());
     }
 
+    /**
+     * the pairs of a ParticleID and its record, without building Particles.
+     * this is invalidated by any change of the particles.
+     */
+    particle_record_range get_particle_records_range() const
+    {
+        const particle_space_type::record_container_type& records((*ps_).records());
+        return particle_record_range(records.begin(), records.end(), records.size());
+    }
+
     /**
      *
      */
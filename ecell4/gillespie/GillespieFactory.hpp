@@ -24,12 +24,23 @@ public:
 
 public:
 
-    GillespieFactory()
-        : base_type(), rng_()
+    GillespieFactory(const GillespieSolverType solver_type = default_solver_type(),
+                     const Real epsilon = default_epsilon())
+        : base_type(), rng_(), solver_type_(solver_type), epsilon_(epsilon)
     {
         ; // do nothing
     }
 
+    static inline const GillespieSolverType default_solver_type()
+    {
+        return DIRECT_METHOD;
+    }
+
+    static inline const Real default_epsilon()
+    {
+        return 0.03;
+    }
+
     virtual ~GillespieFactory()
     {
         ; // do nothing
@@ -73,18 +84,20 @@ public:
         const boost::shared_ptr<Model>& model,
         const boost::shared_ptr<world_type>& world) const
     {
-        return new GillespieSimulator(model, world);
+        return new GillespieSimulator(model, world, solver_type_, epsilon_);
     }
 
     virtual GillespieSimulator* create_simulator(
         const boost::shared_ptr<world_type>& world) const
     {
-        return new GillespieSimulator(world);
+        return new GillespieSimulator(world, solver_type_, epsilon_);
     }
 
 protected:
 
     boost::shared_ptr<RandomNumberGenerator> rng_;
+    GillespieSolverType solver_type_;
+    Real epsilon_;
 };
 
 } // gillespie
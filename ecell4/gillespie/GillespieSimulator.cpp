@@ -8,6 +8,10 @@
 #include <cstdio>
 #include <cstring>
 
+#include <map>
+#include <algorithm>
+#include <cmath>
+
 #include <boost/scoped_array.hpp>
 
 namespace ecell4
@@ -16,31 +20,135 @@ namespace ecell4
 namespace gillespie
 {
 
+void GillespieSimulator::register_species(const Species& sp)
+{
+    dependency_container_type& deps(dependencies_[sp]);
+    for (unsigned int idx(0); idx < events_.size(); ++idx)
+    {
+        const ReactionRuleEvent::coefficient_type
+            coefs(events_[idx].add_candidate(sp));
+        if (coefs.first > 0 || coefs.second > 0)
+        {
+            deps.push_back(std::make_pair(idx, coefs));
+        }
+    }
+}
+
+const GillespieSimulator::dependency_container_type&
+GillespieSimulator::dependencies(const Species& sp)
+{
+    dependency_map_type::const_iterator i(dependencies_.find(sp));
+    if (i == dependencies_.end())
+    {
+        // A new species, which was not in the world at initialization.
+        register_species(sp);
+        i = dependencies_.find(sp);
+    }
+    return (*i).second;
+}
+
 void GillespieSimulator::increment_molecules(const Species& sp)
 {
+    const dependency_container_type& deps(dependencies(sp));
+
     world_->add_molecules(sp, 1);
 
-    for (boost::ptr_vector<ReactionRuleEvent>::iterator i(events_.begin());
-        i != events_.end(); ++i)
+    for (dependency_container_type::const_iterator i(deps.begin());
+        i != deps.end(); ++i)
     {
-        (*i).inc(sp);
+        events_[(*i).first].inc((*i).second);
+        update_propensity((*i).first);
     }
 }
 
 
 void GillespieSimulator::decrement_molecules(const Species& sp)
 {
+    const dependency_container_type& deps(dependencies(sp));
+
     world_->remove_molecules(sp, 1);
 
-    for (boost::ptr_vector<ReactionRuleEvent>::iterator i(events_.begin());
-        i != events_.end(); ++i)
+    for (dependency_container_type::const_iterator i(deps.begin());
+        i != deps.end(); ++i)
     {
-        (*i).dec(sp);
+        events_[(*i).first].dec((*i).second);
+        update_propensity((*i).first);
     }
 }
 
-bool GillespieSimulator::__draw_next_reaction(void)
+void GillespieSimulator::update_propensity(const unsigned int idx)
+{
+    if (solver_type_ == LOGARITHMIC_DIRECT_METHOD)
+    {
+        propensities_.update(idx, events_[idx].propensity());
+    }
+    else if (solver_type_ == NEXT_REACTION_METHOD)
+    {
+        update_firing_time(idx);
+    }
+}
+
+void GillespieSimulator::update_firing_time(const unsigned int idx)
 {
+    // Gibson and Bruck (2000) J. Phys. Chem. A 104, 1876-1889.
+    // The putative time is rescaled to reuse its random number.
+    const Real a_old(last_propensities_[idx]);
+    const Real a_new(events_[idx].propensity());
+    last_propensities_[idx] = a_new;
+
+    if (a_old > 0.0)
+    {
+        const Real tau(firing_times_.get(idx) - t());
+        if (a_new > 0.0)
+        {
+            firing_times_.replace(std::make_pair(idx, t() + tau * a_old / a_new));
+        }
+        else
+        {
+            // Keep the remainder until the event gets active again.
+            residuals_[idx] = tau * a_old;
+            firing_times_.replace(std::make_pair(idx, inf));
+        }
+    }
+    else if (a_new > 0.0)
+    {
+        firing_times_.replace(std::make_pair(idx, t() + residuals_[idx] / a_new));
+    }
+}
+
+void GillespieSimulator::reset_firing_time(const unsigned int idx)
+{
+    const Real a(last_propensities_[idx]);
+    const Real rnd(gsl_sf_log(1.0 / rng()->uniform(0, 1)));
+    if (a > 0.0)
+    {
+        firing_times_.replace(std::make_pair(idx, t() + rnd / a));
+    }
+    else
+    {
+        residuals_[idx] = rnd;
+        firing_times_.replace(std::make_pair(idx, inf));
+    }
+}
+
+int GillespieSimulator::__select_next_event(void)
+{
+    if (solver_type_ == LOGARITHMIC_DIRECT_METHOD)
+    {
+        const double atot(propensities_.total());
+        if (atot <= 0.0)
+        {
+            return -1;
+        }
+
+        const double rnd1(rng()->uniform(0, 1));
+        const double dt(gsl_sf_log(1.0 / rnd1) / double(atot));
+        const double rnd2(rng()->uniform(0, atot));
+
+        this->dt_ += dt;
+        return propensities_.find(rnd2);
+    }
+
     std::vector<double> a(events_.size());
     // const Real V(world_->volume());
     for (unsigned int idx(0); idx < events_.size(); ++idx)
@@ -52,9 +160,7 @@ bool GillespieSimulator::__draw_next_reaction(void)
     const double atot(std::accumulate(a.begin(), a.end(), double(0.0)));
     if (atot == 0.0)
     {
-        // Any reactions cannot occur.
-        this->dt_ = inf;
-        return true;
+        return -1;
     }
 
     const double rnd1(rng()->uniform(0, 1));
@@ -71,24 +177,396 @@ bool GillespieSimulator::__draw_next_reaction(void)
     } while (acc < rnd2 && u < len_a - 1);
 
     if (len_a == u)
+    {
+        return -1;
+    }
+
+    this->dt_ += dt;
+    return u;
+}
+
+bool GillespieSimulator::__draw_next_reaction(void)
+{
+    const int u(__select_next_event());
+    if (u < 0)
+    {
+        // Any reactions cannot occur.
+        this->dt_ = inf;
+        return true;
+    }
+
+    next_reaction_rule_ = events_[u].reaction_rule();
+    next_reaction_ = events_[u].draw();
+    if (next_reaction_.k() <= 0.0)
+    {
+        return false; // skip a reaction
+    }
+
+    return true;
+}
+
+bool GillespieSimulator::__draw_next_firing(void)
+{
+    const firing_time_queue_type::value_type& top(firing_times_.top());
+    if (top.second == inf)
     {
         // Any reactions cannot occur.
         this->dt_ = inf;
         return true;
     }
 
+    const unsigned int u(top.first);
+    const Real tau(top.second);
+
+    next_event_ = u;
     next_reaction_rule_ = events_[u].reaction_rule();
     next_reaction_ = events_[u].draw();
     if (next_reaction_.k() <= 0.0)
     {
-        this->dt_ += dt; // skip a reaction
+        // skip a reaction, and draw the next firing time from tau.
+        const Real rnd(gsl_sf_log(1.0 / rng()->uniform(0, 1)));
+        firing_times_.replace(
+            std::make_pair(u, tau + rnd / last_propensities_[u]));
         return false;
     }
 
-    this->dt_ += dt;
+    this->dt_ = tau - t();
     return true;
 }
 
+void GillespieSimulator::initialize_leap(void)
+{
+    if (!model_->is_static())
+    {
+        throw NotSupported(
+            "TAU_LEAPING requires a static model. Expand the model first.");
+    }
+
+    typedef utils::get_mapper_mf<Species, unsigned int>::type
+        species_index_map_type;
+    typedef std::map<unsigned int, Integer> stoichiometry_map_type;
+
+    leap_species_ = world_->list_species();
+    species_index_map_type index_map;
+    for (unsigned int i(0); i < leap_species_.size(); ++i)
+    {
+        index_map[leap_species_[i]] = i;
+    }
+
+    stoichiometries_.clear();
+    stoichiometries_.resize(events_.size());
+    for (unsigned int j(0); j < events_.size(); ++j)
+    {
+        const ReactionRule& rr(events_[j].reaction_rule());
+        stoichiometry_map_type reactants, changes;
+
+        for (ReactionRule::reactant_container_type::const_iterator
+            k(rr.reactants().begin()); k != rr.reactants().end(); ++k)
+        {
+            species_index_map_type::const_iterator it(index_map.find(*k));
+            if (it == index_map.end())
+            {
+                it = index_map.insert(std::make_pair(*k, leap_species_.size())).first;
+                leap_species_.push_back(*k);
+            }
+            reactants[(*it).second] += 1;
+            changes[(*it).second] -= 1;
+        }
+
+        for (ReactionRule::product_container_type::const_iterator
+            k(rr.products().begin()); k != rr.products().end(); ++k)
+        {
+            species_index_map_type::const_iterator it(index_map.find(*k));
+            if (it == index_map.end())
+            {
+                it = index_map.insert(std::make_pair(*k, leap_species_.size())).first;
+                leap_species_.push_back(*k);
+            }
+            changes[(*it).second] += 1;
+        }
+
+        stoichiometries_[j].reactants.assign(reactants.begin(), reactants.end());
+        for (stoichiometry_map_type::const_iterator k(changes.begin());
+            k != changes.end(); ++k)
+        {
+            if ((*k).second != 0)
+            {
+                stoichiometries_[j].changes.push_back(*k);
+            }
+        }
+    }
+
+    // The highest order of reactions in which each species is a reactant.
+    highest_orders_.assign(leap_species_.size(), 0);
+    homodimeric_.assign(leap_species_.size(), false);
+    for (std::vector<stoichiometry_type>::const_iterator j(stoichiometries_.begin());
+        j != stoichiometries_.end(); ++j)
+    {
+        Integer order(0);
+        for (std::vector<std::pair<unsigned int, Integer> >::const_iterator
+            k((*j).reactants.begin()); k != (*j).reactants.end(); ++k)
+        {
+            order += (*k).second;
+        }
+
+        for (std::vector<std::pair<unsigned int, Integer> >::const_iterator
+            k((*j).reactants.begin()); k != (*j).reactants.end(); ++k)
+        {
+            const unsigned int i((*k).first);
+            if (order > highest_orders_[i])
+            {
+                highest_orders_[i] = order;
+                homodimeric_[i] = ((*k).second > 1);
+            }
+            else if (order == highest_orders_[i] && (*k).second > 1)
+            {
+                homodimeric_[i] = true;
+            }
+        }
+    }
+
+    num_molecules_.resize(leap_species_.size());
+    leap_propensities_.resize(events_.size());
+    critical_.resize(events_.size());
+    leaping_ = false;
+    next_critical_ = -1;
+}
+
+Real GillespieSimulator::leap_size(void) const
+{
+    // Cao, Gillespie and Petzold (2006) J. Chem. Phys. 124, 044109.
+    std::vector<Real> mu(leap_species_.size(), 0.0), sigma2(leap_species_.size(), 0.0);
+    for (unsigned int j(0); j < stoichiometries_.size(); ++j)
+    {
+        if (critical_[j] || leap_propensities_[j] <= 0.0)
+        {
+            continue;
+        }
+
+        const Real a(leap_propensities_[j]);
+        for (std::vector<std::pair<unsigned int, Integer> >::const_iterator
+            k(stoichiometries_[j].changes.begin());
+            k != stoichiometries_[j].changes.end(); ++k)
+        {
+            mu[(*k).first] += (*k).second * a;
+            sigma2[(*k).first] += (*k).second * (*k).second * a;
+        }
+    }
+
+    Real tau(inf);
+    for (unsigned int i(0); i < leap_species_.size(); ++i)
+    {
+        if (highest_orders_[i] == 0 || (mu[i] == 0.0 && sigma2[i] == 0.0))
+        {
+            continue;
+        }
+
+        const Real x(num_molecules_[i]);
+        Real g(highest_orders_[i]);
+        if (homodimeric_[i] && x > 1)
+        {
+            g += 1.0 / (x - 1);
+        }
+
+        const Real bound(std::max(epsilon_ * x / g, 1.0));
+        if (mu[i] != 0.0)
+        {
+            tau = std::min(tau, bound / std::abs(mu[i]));
+        }
+        tau = std::min(tau, bound * bound / sigma2[i]);
+    }
+    return tau;
+}
+
+void GillespieSimulator::draw_next_leap(void)
+{
+    static const Integer num_critical(10);
+
+    leaping_ = false;
+    next_critical_ = -1;
+
+    Real a0(0.0);
+    for (unsigned int j(0); j < events_.size(); ++j)
+    {
+        leap_propensities_[j] = events_[j].propensity();
+        a0 += leap_propensities_[j];
+    }
+
+    if (a0 <= 0.0)
+    {
+        // Any reactions cannot occur.
+        this->dt_ = inf;
+        return;
+    }
+
+    for (unsigned int i(0); i < leap_species_.size(); ++i)
+    {
+        num_molecules_[i] = world_->num_molecules_exact(leap_species_[i]);
+    }
+
+    // A reaction is critical when it can exhaust one of its reactants
+    // within a few firings.
+    Real a0c(0.0);
+    for (unsigned int j(0); j < stoichiometries_.size(); ++j)
+    {
+        critical_[j] = false;
+        if (leap_propensities_[j] <= 0.0)
+        {
+            continue;
+        }
+
+        for (std::vector<std::pair<unsigned int, Integer> >::const_iterator
+            k(stoichiometries_[j].reactants.begin());
+            k != stoichiometries_[j].reactants.end(); ++k)
+        {
+            if (num_molecules_[(*k).first] / (*k).second < num_critical)
+            {
+                critical_[j] = true;
+                a0c += leap_propensities_[j];
+                break;
+            }
+        }
+    }
+
+    const Real tau1(leap_size());
+    if (tau1 < 10.0 / a0 || (tau1 == inf && a0c == 0.0))
+    {
+        // Leaping does not pay. Take an exact step instead.
+        this->dt_ = 0.0;
+        while (!__draw_next_reaction())
+        {
+            ; // pass
+        }
+        return;
+    }
+
+    const Real tau2(
+        a0c > 0.0 ? gsl_sf_log(1.0 / rng()->uniform(0, 1)) / a0c : inf);
+    if (tau1 < tau2)
+    {
+        this->dt_ = tau1;
+    }
+    else
+    {
+        // One critical reaction occurs at the end of the leap.
+        this->dt_ = tau2;
+        const Real rnd(rng()->uniform(0, a0c));
+        Real acc(0.0);
+        for (unsigned int j(0); j < critical_.size(); ++j)
+        {
+            if (critical_[j])
+            {
+                next_critical_ = j;
+                acc += leap_propensities_[j];
+                if (acc >= rnd)
+                {
+                    break;
+                }
+            }
+        }
+    }
+    leaping_ = true;
+}
+
+Real GillespieSimulator::leap(Real tau, int critical)
+{
+    std::vector<Integer> firings(events_.size()), changes(leap_species_.size());
+
+    while (true)
+    {
+        std::fill(changes.begin(), changes.end(), 0);
+        for (unsigned int j(0); j < events_.size(); ++j)
+        {
+            if (critical_[j])
+            {
+                firings[j] = (static_cast<int>(j) == critical ? 1 : 0);
+            }
+            else if (leap_propensities_[j] > 0.0)
+            {
+                firings[j] = rng()->poisson(leap_propensities_[j] * tau);
+            }
+            else
+            {
+                firings[j] = 0;
+            }
+
+            if (firings[j] == 0)
+            {
+                continue;
+            }
+
+            for (std::vector<std::pair<unsigned int, Integer> >::const_iterator
+                k(stoichiometries_[j].changes.begin());
+                k != stoichiometries_[j].changes.end(); ++k)
+            {
+                changes[(*k).first] += (*k).second * firings[j];
+            }
+        }
+
+        bool accepted(true);
+        for (unsigned int i(0); i < leap_species_.size(); ++i)
+        {
+            if (num_molecules_[i] + changes[i] < 0)
+            {
+                accepted = false;
+                break;
+            }
+        }
+
+        if (accepted)
+        {
+            break;
+        }
+
+        // Some population got negative. Retry with a half leap, in which
+        // the critical reaction does not occur yet.
+        tau *= 0.5;
+        critical = -1;
+    }
+
+    this->set_t(t() + tau);
+    num_steps_++;
+
+    for (unsigned int i(0); i < leap_species_.size(); ++i)
+    {
+        const Integer num(changes[i]);
+        if (num == 0)
+        {
+            continue;
+        }
+
+        const Species& sp(leap_species_[i]);
+        if (num > 0)
+        {
+            world_->add_molecules(sp, num);
+        }
+        else
+        {
+            world_->remove_molecules(sp, -num);
+        }
+
+        const dependency_container_type& deps(dependencies(sp));
+        for (dependency_container_type::const_iterator k(deps.begin());
+            k != deps.end(); ++k)
+        {
+            events_[(*k).first].inc((*k).second, num);
+        }
+    }
+
+    // Each reaction fired in the leap is recorded only once.
+    for (unsigned int j(0); j < events_.size(); ++j)
+    {
+        if (firings[j] > 0)
+        {
+            const ReactionRule& rr(events_[j].reaction_rule());
+            last_reactions_.push_back(std::make_pair(
+                rr, reaction_info_type(t(), rr.reactants(), rr.products())));
+        }
+    }
+
+    return tau;
+}
+
 void GillespieSimulator::draw_next_reaction(void)
 {
     if (events_.size() == 0)
@@ -97,6 +575,21 @@ void GillespieSimulator::draw_next_reaction(void)
         return;
     }
 
+    if (solver_type_ == TAU_LEAPING)
+    {
+        draw_next_leap();
+        return;
+    }
+
+    if (solver_type_ == NEXT_REACTION_METHOD)
+    {
+        while (!__draw_next_firing())
+        {
+            ; // pass
+        }
+        return;
+    }
+
     this->dt_ = 0.0;
 
     while (!__draw_next_reaction())
@@ -115,6 +608,13 @@ void GillespieSimulator::step(void)
         return;
     }
 
+    if (solver_type_ == TAU_LEAPING && leaping_)
+    {
+        leap(dt_, next_critical_);
+        this->draw_next_reaction();
+        return;
+    }
+
     const Real t0(t()), dt0(dt());
 
     if (dt0 == 0.0 || next_reaction_.k() <= 0.0)
@@ -123,6 +623,9 @@ void GillespieSimulator::step(void)
         return;
     }
 
+    this->set_t(t0 + dt0);
+    num_steps_++;
+
     // Reaction[u] occurs.
     for (ReactionRule::reactant_container_type::const_iterator
         it(next_reaction_.reactants().begin());
@@ -138,8 +641,10 @@ void GillespieSimulator::step(void)
         increment_molecules(*it);
     }
 
-    this->set_t(t0 + dt0);
-    num_steps_++;
+    if (solver_type_ == NEXT_REACTION_METHOD)
+    {
+        reset_firing_time(next_event_);
+    }
 
     last_reactions_.push_back(std::make_pair(next_reaction_rule_, reaction_info_type(t(), next_reaction_.reactants(), next_reaction_.products())));
 
@@ -158,6 +663,21 @@ bool GillespieSimulator::step(const Real &upto)
         step();
         return true;
     }
+    else if (solver_type_ == TAU_LEAPING && leaping_)
+    {
+        // leap to upto, by which no critical reaction occurs.
+        last_reactions_.clear();
+        const Real tau(upto - t());
+        if (leap(tau, -1) < tau)
+        {
+            // the leap was shortened.
+            draw_next_reaction();
+            return true;
+        }
+        set_t(upto);
+        draw_next_reaction();
+        return false;
+    }
     else
     {
         // no reaction occurs
@@ -196,8 +716,46 @@ void GillespieSimulator::initialize(void)
         {
             throw NotSupported("not supported yet.");
         }
+    }
+
+    dependencies_.clear();
+    const std::vector<Species> species(world_->list_species());
+    for (std::vector<Species>::const_iterator i(species.begin());
+        i != species.end(); ++i)
+    {
+        register_species(*i);
+    }
+
+    for (boost::ptr_vector<ReactionRuleEvent>::iterator i(events_.begin());
+        i != events_.end(); ++i)
+    {
+        (*i).initialize();
+    }
 
-        events_.back().initialize();
+    if (solver_type_ == LOGARITHMIC_DIRECT_METHOD)
+    {
+        PropensitySumTree::container_type a(events_.size());
+        for (unsigned int idx(0); idx < events_.size(); ++idx)
+        {
+            a[idx] = events_[idx].propensity();
+        }
+        propensities_.assign(a);
+    }
+    else if (solver_type_ == NEXT_REACTION_METHOD)
+    {
+        firing_times_.clear();
+        last_propensities_.resize(events_.size());
+        residuals_.resize(events_.size());
+        for (unsigned int idx(0); idx < events_.size(); ++idx)
+        {
+            last_propensities_[idx] = events_[idx].propensity();
+            firing_times_.push(inf);
+            reset_firing_time(idx);
+        }
+    }
+    else if (solver_type_ == TAU_LEAPING)
+    {
+        initialize_leap();
     }
 
     this->draw_next_reaction();
@@ -8,8 +8,11 @@
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/NetworkModel.hpp>
 #include <ecell4/core/SimulatorBase.hpp>
+#include <ecell4/core/get_mapper_mf.hpp>
+#include <ecell4/core/DynamicPriorityQueue.hpp>
 
 #include "GillespieWorld.hpp"
+#include "PropensitySumTree.hpp"
 
 
 namespace ecell4
@@ -18,6 +21,13 @@ namespace ecell4
 namespace gillespie
 {
 
+enum GillespieSolverType {
+    DIRECT_METHOD = 0,
+    LOGARITHMIC_DIRECT_METHOD = 1,
+    NEXT_REACTION_METHOD = 2,
+    TAU_LEAPING = 3
+};
+
 class ReactionInfo
 {
 public:
@@ -79,18 +89,56 @@ public:
 
 protected:
 
+    /**
+     * a list of pairs of an event index and the coefficients of a species
+     * for the event. this works as a dependency graph from a species to
+     * the events whose propensities depend on it.
+     */
+    typedef std::vector<std::pair<unsigned int, std::pair<Integer, Integer> > >
+        dependency_container_type;
+    typedef utils::get_mapper_mf<Species, dependency_container_type>::type
+        dependency_map_type;
+
+    /**
+     * putative firing times of events for the next reaction method.
+     * the identifier of an item is equal to the index of its event,
+     * because items are never popped.
+     */
+    typedef DynamicPriorityQueue<Real, std::less_equal<Real>, volatile_id_policy<> >
+        firing_time_queue_type;
+
+    /**
+     * a concrete reaction for tau-leaping: pairs of a species index and
+     * its multiplicity as a reactant, and ones of a species index and
+     * its net change by the reaction.
+     */
+    struct stoichiometry_type
+    {
+        std::vector<std::pair<unsigned int, Integer> > reactants, changes;
+    };
+
     class ReactionRuleEvent
     {
+    public:
+
+        /**
+         * a pair of the coefficients of a species for the first and
+         * second reactant patterns of the reaction rule.
+         */
+        typedef std::pair<Integer, Integer> coefficient_type;
+        typedef std::vector<std::pair<Species, coefficient_type> >
+            candidate_container_type;
+
     public:
 
         ReactionRuleEvent()
-            : sim_(), rr_()
+            : sim_(), rr_(), candidates_()
         {
             ;
         }
 
         ReactionRuleEvent(GillespieSimulator* sim, const ReactionRule& rr)
-            : sim_(sim), rr_(rr)
+            : sim_(sim), rr_(rr), candidates_()
         {
             ;
         }
@@ -116,13 +164,33 @@ protected:
             return sim_->model()->apply(rr_, reactants);
         }
 
+        /**
+         * match the given species with the reactant patterns, and
+         * remember it as a candidate if it matches any of them.
+         * return the coefficients.
+         */
+        coefficient_type add_candidate(const Species& sp)
+        {
+            const coefficient_type coefs(get_coefs(sp));
+            if (coefs.first > 0 || coefs.second > 0)
+            {
+                candidates_.push_back(std::make_pair(sp, coefs));
+            }
+            return coefs;
+        }
+
         virtual void initialize() = 0;
-        virtual void inc(const Species& sp, const Integer val = +1) = 0;
         virtual const Real propensity() const = 0;
 
-        inline void dec(const Species& sp)
+        /**
+         * update the propensity with the precomputed coefficients of
+         * a species, whose number is changed by val.
+         */
+        virtual void inc(const coefficient_type& coefs, const Integer val = +1) = 0;
+
+        inline void dec(const coefficient_type& coefs)
         {
-            inc(sp, -1);
+            inc(coefs, -1);
         }
 
         ReactionRule draw()
@@ -173,6 +241,8 @@ protected:
             return (*sim_->world());
         }
 
+        virtual coefficient_type get_coefs(const Species& sp) const = 0;
+
         virtual std::pair<ReactionRule::reactant_container_type, Integer>
             __draw() = 0;
 
@@ -180,6 +250,7 @@ protected:
 
         GillespieSimulator* sim_;
         ReactionRule rr_;
+        candidate_container_type candidates_;
     };
 
     class ZerothOrderReactionRuleEvent
@@ -201,7 +272,7 @@ protected:
             ;
         }
 
-        void inc(const Species& sp, const Integer val = +1)
+        void inc(const coefficient_type& coefs, const Integer val = +1)
         {
             ; // do nothing
         }
@@ -220,6 +291,13 @@ protected:
         {
             return rr_.k() * sim_->world()->volume();
         }
+
+    protected:
+
+        coefficient_type get_coefs(const Species& sp) const
+        {
+            return coefficient_type(0, 0);
+        }
     };
 
 
@@ -242,53 +320,35 @@ protected:
             ;
         }
 
-        void inc(const Species& sp, const Integer val = +1)
+        void inc(const coefficient_type& coefs, const Integer val = +1)
         {
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-            const Integer coef(get_coef(reactants[0], sp));
-            if (coef > 0)
-            {
-                num_tot1_ += coef * val;
-            }
+            num_tot1_ += coefs.first * val;
         }
 
         void initialize()
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-
             num_tot1_ = 0;
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[0], *i));
-                if (coef > 0)
-                {
-                    num_tot1_ += coef * world().num_molecules_exact(*i);
-                }
+                num_tot1_ += (*i).second.first * world().num_molecules_exact((*i).first);
             }
         }
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw()
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-
             const Real rnd1(rng()->uniform(0.0, num_tot1_));
 
             Integer num_tot(0);
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[0], *i));
-                if (coef > 0)
+                const Integer coef((*i).second.first);
+                num_tot += coef * world().num_molecules_exact((*i).first);
+                if (num_tot >= rnd1)
                 {
-                    num_tot += coef * world().num_molecules_exact(*i);
-                    if (num_tot >= rnd1)
-                    {
-                        return std::make_pair(
-                            ReactionRule::reactant_container_type(1, *i), coef);
-                    }
+                    return std::make_pair(
+                        ReactionRule::reactant_container_type(1, (*i).first), coef);
                 }
             }
 
@@ -300,6 +360,13 @@ protected:
             return num_tot1_ * rr_.k();
         }
 
+    protected:
+
+        coefficient_type get_coefs(const Species& sp) const
+        {
+            return coefficient_type(get_coef(rr_.reactants()[0], sp), 0);
+        }
+
     protected:
 
         Integer num_tot1_;
@@ -324,84 +391,77 @@ protected:
             ;
         }
 
-        void inc(const Species& sp, const Integer val = +1)
+        void inc(const coefficient_type& coefs, const Integer val = +1)
         {
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-            const Integer coef1(get_coef(reactants[0], sp));
-            const Integer coef2(get_coef(reactants[1], sp));
-            if (coef1 > 0 || coef2 > 0)
-            {
-                const Integer tmp(coef1 * val);
-                num_tot1_ += tmp;
-                num_tot2_ += coef2 * val;
-                num_tot12_ += coef2 * tmp;
-            }
+            const Integer tmp(coefs.first * val);
+            num_tot1_ += tmp;
+            num_tot2_ += coefs.second * val;
+            num_tot12_ += coefs.second * tmp;
         }
 
         void initialize()
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-
             num_tot1_ = 0;
             num_tot2_ = 0;
             num_tot12_ = 0;
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef1(get_coef(reactants[0], *i));
-                const Integer coef2(get_coef(reactants[1], *i));
-                if (coef1 > 0 || coef2 > 0)
-                {
-                    const Integer num(world().num_molecules_exact(*i));
-                    const Integer tmp(coef1 * num);
-                    num_tot1_ += tmp;
-                    num_tot2_ += coef2 * num;
-                    num_tot12_ += coef2 * tmp;
-                }
+                const Integer num(world().num_molecules_exact((*i).first));
+                const Integer tmp((*i).second.first * num);
+                num_tot1_ += tmp;
+                num_tot2_ += (*i).second.second * num;
+                num_tot12_ += (*i).second.second * tmp;
             }
         }
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw()
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-
             const Real rnd1(rng()->uniform(0.0, num_tot1_));
 
-            Integer num_tot(0), coef1(0);
-            std::vector<Species>::const_iterator itr1(species.begin());
-            for (; itr1 != species.end(); ++itr1)
+            Integer num_tot(0);
+            candidate_container_type::const_iterator itr1(candidates_.begin());
+            for (; itr1 != candidates_.end(); ++itr1)
             {
-                const Integer coef(get_coef(reactants[0], *itr1));
+                const Integer coef((*itr1).second.first);
                 if (coef > 0)
                 {
-                    num_tot += coef * world().num_molecules_exact(*itr1);
+                    num_tot += coef * world().num_molecules_exact((*itr1).first);
                     if (num_tot >= rnd1)
                     {
-                        coef1 = coef;
                         break;
                     }
                 }
             }
 
+            if (itr1 == candidates_.end())
+            {
+                return std::make_pair(ReactionRule::reactant_container_type(), 0);
+            }
+
+            // the second is drawn from the molecules other than the first.
+            // one molecule of the first species is removed from the total
+            // for the second pattern, i.e. its weight for the second pattern
+            // is subtracted. the weight for the first pattern would make
+            // the range differ from the sum in the loop below.
+            const Integer coef1((*itr1).second.first);
             const Real rnd2(
-                rng()->uniform(0.0, num_tot2_ - get_coef(reactants[0], *itr1)));
+                rng()->uniform(0.0, num_tot2_ - (*itr1).second.second));
 
             num_tot = 0;
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[1], *i));
+                const Integer coef((*i).second.second);
                 if (coef > 0)
                 {
-                    const Integer num(world().num_molecules_exact(*i));
+                    const Integer num(world().num_molecules_exact((*i).first));
                     num_tot += coef * (i == itr1 ? num - 1 : num);
                     if (num_tot >= rnd2)
                     {
                         ReactionRule::reactant_container_type exact_reactants(2);
-                        exact_reactants[0] = *itr1;
-                        exact_reactants[1] = *i;
+                        exact_reactants[0] = (*itr1).first;
+                        exact_reactants[1] = (*i).first;
                         return std::make_pair(exact_reactants, coef1 * coef);
                     }
                 }
@@ -415,6 +475,15 @@ protected:
             return (num_tot1_ * num_tot2_ - num_tot12_) * rr_.k() / world().volume();
         }
 
+    protected:
+
+        coefficient_type get_coefs(const Species& sp) const
+        {
+            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
+            return coefficient_type(
+                get_coef(reactants[0], sp), get_coef(reactants[1], sp));
+        }
+
     protected:
 
         Integer num_tot1_, num_tot2_, num_tot12_;
@@ -424,14 +493,19 @@ public:
 
     GillespieSimulator(
         boost::shared_ptr<Model> model,
-        boost::shared_ptr<GillespieWorld> world)
-        : base_type(model, world)
+        boost::shared_ptr<GillespieWorld> world,
+        const GillespieSolverType solver_type = DIRECT_METHOD,
+        const Real epsilon = 0.03)
+        : base_type(model, world), solver_type_(solver_type), epsilon_(epsilon)
     {
         initialize();
     }
 
-    GillespieSimulator(boost::shared_ptr<GillespieWorld> world)
-        : base_type(world)
+    GillespieSimulator(
+        boost::shared_ptr<GillespieWorld> world,
+        const GillespieSolverType solver_type = DIRECT_METHOD,
+        const Real epsilon = 0.03)
+        : base_type(world), solver_type_(solver_type), epsilon_(epsilon)
     {
         initialize();
     }
@@ -464,9 +538,39 @@ public:
         return (*world_).rng();
     }
 
+    GillespieSolverType solver_type() const
+    {
+        return solver_type_;
+    }
+
+    /**
+     * the error control parameter of tau-leaping, which bounds
+     * the relative change of propensities in a leap.
+     */
+    Real epsilon() const
+    {
+        return epsilon_;
+    }
+
+    void set_epsilon(const Real epsilon)
+    {
+        epsilon_ = epsilon;
+    }
+
 protected:
 
     bool __draw_next_reaction(void);
+    bool __draw_next_firing(void);
+    int __select_next_event(void);
+    void update_propensity(const unsigned int idx);
+    void update_firing_time(const unsigned int idx);
+    void reset_firing_time(const unsigned int idx);
+    void initialize_leap(void);
+    void draw_next_leap(void);
+    Real leap_size(void) const;
+    Real leap(Real tau, int critical);
+    const dependency_container_type& dependencies(const Species& sp);
+    void register_species(const Species& sp);
     void draw_next_reaction(void);
     void increment_molecules(const Species& sp);
     void decrement_molecules(const Species& sp);
@@ -478,6 +582,25 @@ protected:
     std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions_;
 
     boost::ptr_vector<ReactionRuleEvent> events_;
+    dependency_map_type dependencies_;
+
+    GillespieSolverType solver_type_;
+    PropensitySumTree propensities_;
+
+    unsigned int next_event_;
+    firing_time_queue_type firing_times_;
+    std::vector<Real> last_propensities_, residuals_;
+
+    Real epsilon_;
+    bool leaping_;
+    int next_critical_;
+    std::vector<Species> leap_species_;
+    std::vector<stoichiometry_type> stoichiometries_;
+    std::vector<Integer> highest_orders_;
+    std::vector<bool> homodimeric_;
+    std::vector<Integer> num_molecules_;
+    std::vector<Real> leap_propensities_;
+    std::vector<bool> critical_;
 };
 
 }
@@ -0,0 +1,149 @@
+#ifndef ECELL4_GILLESPIE_PROPENSITY_SUM_TREE_HPP
+#define ECELL4_GILLESPIE_PROPENSITY_SUM_TREE_HPP
+
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <ecell4/core/types.hpp>
+
+
+namespace ecell4
+{
+
+namespace gillespie
+{
+
+/**
+ * A complete binary tree holding propensities at its leaves and partial sums
+ * at its internal nodes. An update of a single propensity and a search for
+ * the reaction corresponding to a random number are both O(log R).
+ * Internal nodes are always recomputed from their children, not by adding
+ * differences, so that the round-off errors never accumulate.
+ */
+class PropensitySumTree
+{
+public:
+
+    typedef std::vector<Real> container_type;
+    typedef container_type::size_type size_type;
+
+public:
+
+    PropensitySumTree()
+        : size_(0), capacity_(1), nodes_(2, 0.0)
+    {
+        ;
+    }
+
+    PropensitySumTree(const size_type size)
+        : size_(0), capacity_(1), nodes_(2, 0.0)
+    {
+        resize(size);
+    }
+
+    /**
+     * resize the tree. all the propensities are reset to zero.
+     */
+    void resize(const size_type size)
+    {
+        size_ = size;
+        capacity_ = 1;
+        while (capacity_ < size_)
+        {
+            capacity_ <<= 1;
+        }
+        nodes_.assign(2 * capacity_, 0.0);
+    }
+
+    const size_type size() const
+    {
+        return size_;
+    }
+
+    const Real total() const
+    {
+        return nodes_[1];
+    }
+
+    const Real at(const size_type i) const
+    {
+        return nodes_[capacity_ + i];
+    }
+
+    const Real operator[](const size_type i) const
+    {
+        return at(i);
+    }
+
+    void update(const size_type i, const Real value)
+    {
+        size_type idx(capacity_ + i);
+        nodes_[idx] = value;
+        for (idx >>= 1; idx > 0; idx >>= 1)
+        {
+            nodes_[idx] = nodes_[2 * idx] + nodes_[2 * idx + 1];
+        }
+    }
+
+    /**
+     * set all the propensities at once and rebuild the sums in O(R).
+     */
+    void assign(const container_type& values)
+    {
+        if (values.size() != size_)
+        {
+            resize(values.size());
+        }
+
+        std::copy(values.begin(), values.end(), nodes_.begin() + capacity_);
+        std::fill(nodes_.begin() + capacity_ + size_, nodes_.end(), 0.0);
+        for (size_type idx(capacity_ - 1); idx > 0; --idx)
+        {
+            nodes_[idx] = nodes_[2 * idx] + nodes_[2 * idx + 1];
+        }
+    }
+
+    /**
+     * return the index of the leaf at which the cumulative sum of
+     * propensities exceeds rnd for 0 <= rnd < total().
+     * the subtraction at each level may round rnd up to the sum of
+     * a subtree. a subtree with no propensity is never entered, so that
+     * a leaf with a positive propensity is returned if total() > 0.
+     */
+    size_type find(Real rnd) const
+    {
+        if (size_ == 0)
+        {
+            throw std::out_of_range("the tree is empty.");
+        }
+
+        size_type idx(1);
+        while (idx < capacity_)
+        {
+            const Real left(nodes_[2 * idx]);
+            if (rnd < left || nodes_[2 * idx + 1] <= 0.0)
+            {
+                idx = 2 * idx;
+            }
+            else
+            {
+                rnd -= left;
+                idx = 2 * idx + 1;
+            }
+        }
+
+        const size_type i(idx - capacity_);
+        return (i < size_ ? i : size_ - 1);
+    }
+
+protected:
+
+    size_type size_, capacity_;
+    container_type nodes_;
+};
+
+} // gillespie
+
+} // ecell4
+
+#endif /* ECELL4_GILLESPIE_PROPENSITY_SUM_TREE_HPP */
@@ -0,0 +1,87 @@
+#include <iostream>
+#include <sstream>
+#include <ctime>
+#include <cstdlib>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/gillespie/GillespieSimulator.hpp>
+
+using namespace ecell4;
+using namespace ecell4::gillespie;
+
+/**
+ * a ring of num_species species connected by first-order conversions,
+ * A0 -> A1 -> ... -> A(n-1) -> A0, plus a binding/unbinding pair.
+ */
+boost::shared_ptr<NetworkModel> generate_ring_model(const Integer num_species)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    std::vector<Species> species;
+    for (Integer i(0); i < num_species; ++i)
+    {
+        std::ostringstream oss;
+        oss << "A" << i;
+        species.push_back(Species(oss.str()));
+        model->add_species_attribute(species.back());
+    }
+
+    for (Integer i(0); i < num_species; ++i)
+    {
+        model->add_reaction_rule(create_unimolecular_reaction_rule(
+            species[i], species[(i + 1) % num_species], 1.0));
+    }
+
+    const Species sp("B");
+    model->add_species_attribute(sp);
+    model->add_reaction_rule(create_binding_reaction_rule(species[0], species[1], sp, 0.01));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp, species[0], species[1], 1.0));
+    return model;
+}
+
+Real measure(
+    const boost::shared_ptr<NetworkModel>& model, const Integer num_species,
+    const GillespieSolverType solver_type, const Integer num_steps)
+{
+    boost::shared_ptr<RandomNumberGenerator>
+        rng(new GSLRandomNumberGenerator());
+    rng->seed(0);
+    boost::shared_ptr<GillespieWorld>
+        world(new GillespieWorld(Real3(1, 1, 1), rng));
+
+    const Model::species_container_type& species(model->species_attributes());
+    for (Integer i(0); i < num_species; ++i)
+    {
+        world->add_molecules(species[i], 10);
+    }
+
+    GillespieSimulator sim(model, world, solver_type);
+
+    const std::clock_t start(std::clock());
+    for (Integer i(0); i < num_steps; ++i)
+    {
+        sim.step();
+    }
+    const std::clock_t end(std::clock());
+    return static_cast<Real>(end - start) / CLOCKS_PER_SEC / num_steps;
+}
+
+int main(int argc, char **argv)
+{
+    const Integer max_num_species(argc > 1 ? std::atoi(argv[1]) : 1000);
+    const Integer num_steps(argc > 2 ? std::atoi(argv[2]) : 10000);
+
+    std::cout << "# reactions\tdirect [us/step]\tlogarithmic [us/step]"
+              << "\tnext reaction [us/step]" << std::endl;
+    for (Integer num_species(10); num_species <= max_num_species; num_species *= 10)
+    {
+        const boost::shared_ptr<NetworkModel> model(generate_ring_model(num_species));
+        const Real t1(measure(model, num_species, DIRECT_METHOD, num_steps));
+        const Real t2(measure(model, num_species, LOGARITHMIC_DIRECT_METHOD, num_steps));
+        const Real t3(measure(model, num_species, NEXT_REACTION_METHOD, num_steps));
+        std::cout << model->reaction_rules().size()
+                  << "\t" << t1 * 1e+6 << "\t" << t2 * 1e+6
+                  << "\t" << t3 * 1e+6 << std::endl;
+    }
+    return 0;
+}
@@ -7,16 +7,94 @@
 #   include <boost/test/included/unit_test.hpp>
 #endif
 
+#include <cmath>
+
 #include <ecell4/core/RandomNumberGenerator.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/core/NetfreeModel.hpp>
 
 #include <ecell4/gillespie/GillespieWorld.cpp>
 #include <ecell4/gillespie/GillespieSimulator.hpp>
+#include <ecell4/gillespie/PropensitySumTree.hpp>
 
 using namespace ecell4;
 using namespace ecell4::gillespie;
 
+/**
+ * a reversible isomerization and dimerization of "A" and "B".
+ */
+boost::shared_ptr<NetworkModel> create_reversible_model(const Real kb)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A"), sp2("B"), sp3("C");
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 5.0));
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp2, sp1, 1.0));
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, kb));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, 2.0));
+    return model;
+}
+
+boost::shared_ptr<GillespieWorld> create_world(const Species& sp, const Integer num)
+{
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+    world->add_molecules(sp, num);
+    return world;
+}
+
+/**
+ * step the reversible model from 100 "A" and check the time and
+ * the number of molecules conserved at each step.
+ */
+void check_reversible_steps(const GillespieSolverType solver_type)
+{
+    const Species sp1("A"), sp2("B"), sp3("C");
+    boost::shared_ptr<GillespieWorld> world(create_world(sp1, 100));
+    GillespieSimulator sim(create_reversible_model(0.5), world, solver_type);
+    BOOST_CHECK_EQUAL(sim.solver_type(), solver_type);
+
+    for (int i(0); i < 100; ++i)
+    {
+        const Real t0(sim.t());
+        sim.step();
+        BOOST_CHECK(t0 < sim.t());
+        BOOST_CHECK_EQUAL(
+            world->num_molecules(sp1) + world->num_molecules(sp2)
+                + 2 * world->num_molecules(sp3), 100);
+    }
+    BOOST_CHECK_EQUAL(sim.num_steps(), 100);
+}
+
+/**
+ * run a decay, A > B, with k=1 until t=1, and compare the number of "A"
+ * with the expected one, N e^{-1}, within five standard deviations.
+ */
+void check_decay(const GillespieSolverType solver_type)
+{
+    const Species sp1("A"), sp2("B");
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+
+    const Integer N(10000);
+    boost::shared_ptr<GillespieWorld> world(create_world(sp1, N));
+    GillespieSimulator sim(model, world, solver_type);
+    sim.run(1.0);
+
+    const Real p(std::exp(-1.0));
+    const Real expected(N * p);
+    const Real sigma(std::sqrt(N * p * (1 - p)));
+    BOOST_CHECK(std::abs(world->num_molecules(sp1) - expected) < 5 * sigma);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1) + world->num_molecules(sp2), N);
+}
+
 BOOST_AUTO_TEST_CASE(GillespieSimulator_test_step)
 {
     boost::shared_ptr<NetworkModel> model(new NetworkModel());
@@ -46,4 +124,118 @@ BOOST_AUTO_TEST_CASE(GillespieSimulator_test_step)
     BOOST_CHECK(0 < sim.t());
     BOOST_CHECK(world->num_molecules(sp1) == 9);
 
+    check_decay(DIRECT_METHOD);
+}
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_logarithmic_direct_method)
+{
+    check_reversible_steps(LOGARITHMIC_DIRECT_METHOD);
+    check_decay(LOGARITHMIC_DIRECT_METHOD);
+}
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_propensity_sum_tree)
+{
+    PropensitySumTree tree(4);
+    tree.update(0, 0.3);
+    tree.update(2, 0.7);
+    BOOST_CHECK_EQUAL(tree.total(), 1.0);
+    BOOST_CHECK_EQUAL(tree.find(0.0), 0);
+    BOOST_CHECK_EQUAL(tree.find(0.5), 2);
+
+    // 1.0 - 0.3 is rounded up to 0.7 below the total, which must not
+    // reach the last leaf with no propensity.
+    const Real rnd(1.0 - std::numeric_limits<Real>::epsilon() / 2);
+    BOOST_CHECK(rnd < tree.total());
+    BOOST_CHECK_EQUAL(tree.find(rnd), 2);
+
+    tree.update(2, 0.0);
+    BOOST_CHECK_EQUAL(tree.find(0.3), 0);
+}
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_next_reaction_method)
+{
+    check_reversible_steps(NEXT_REACTION_METHOD);
+    check_decay(NEXT_REACTION_METHOD);
+}
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_new_species)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A"), sp2("B"), sp3("C");
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp2, sp3, 1e+6));
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+
+    world->add_molecules(sp1, 1);
+
+    GillespieSimulator sim(model, world);
+
+    sim.step();
+    BOOST_CHECK_EQUAL(world->num_molecules(sp1), 0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 1);
+
+    // "B" was not in the world at initialization
+    sim.step();
+    BOOST_CHECK_EQUAL(world->num_molecules(sp2), 0);
+    BOOST_CHECK_EQUAL(world->num_molecules(sp3), 1);
+    BOOST_CHECK(sim.dt() == inf);
+}
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_second_order_draw)
+{
+    // "A" matches only the first pattern, and two species of "B"
+    // match only the second. each "B" reacts with the same probability.
+    boost::shared_ptr<NetfreeModel> model(new NetfreeModel());
+    Species sp1("A"), sp2("B(s)"), sp3("C");
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 1.0));
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+
+    const Integer num_trials(400);
+    Integer num_p(0);
+    for (Integer i(0); i < num_trials; ++i)
+    {
+        boost::shared_ptr<GillespieWorld> world(new GillespieWorld(edge_lengths, rng));
+        world->add_molecules(sp1, 1);
+        world->add_molecules(Species("B(s=u)"), 1);
+        world->add_molecules(Species("B(s=p)"), 1);
+
+        GillespieSimulator sim(model, world);
+        sim.step();
+        BOOST_CHECK_EQUAL(world->num_molecules_exact(sp3), 1);
+        if (world->num_molecules_exact(Species("B(s=p)")) == 0)
+        {
+            ++num_p;
+        }
+    }
+
+    // the subtraction of the weight for the first pattern, one, from
+    // the total for the second, two, left "B(s=p)" never drawn.
+    // the binomial distribution has a standard deviation of 10.
+    BOOST_CHECK(num_p > num_trials / 2 - 50);
+    BOOST_CHECK(num_p < num_trials / 2 + 50);
+}
+
+BOOST_AUTO_TEST_CASE(GillespieSimulator_test_tau_leaping)
+{
+    const Species sp1("A"), sp2("B"), sp3("C");
+    boost::shared_ptr<GillespieWorld> world(create_world(sp1, 100000));
+    GillespieSimulator sim(create_reversible_model(0.001), world, TAU_LEAPING);
+    BOOST_CHECK_EQUAL(sim.solver_type(), TAU_LEAPING);
+
+    sim.run(1.0);
+    BOOST_CHECK_CLOSE(sim.t(), 1.0, 1e-6);
+    BOOST_CHECK_EQUAL(
+        world->num_molecules(sp1) + world->num_molecules(sp2)
+            + 2 * world->num_molecules(sp3), 100000);
+    // far less leaps than the reactions fired by the exact method
+    BOOST_CHECK(sim.num_steps() < 10000);
+
+    check_decay(TAU_LEAPING);
 }
@@ -24,8 +24,10 @@ public:
 
 public:
 
-    MesoscopicFactory(const Integer3& matrix_sizes = default_matrix_sizes(), const Real subvolume_length = default_subvolume_length())
-        : base_type(), rng_(), matrix_sizes_(matrix_sizes), subvolume_length_(subvolume_length)
+    MesoscopicFactory(const Integer3& matrix_sizes = default_matrix_sizes(), const Real subvolume_length = default_subvolume_length(),
+                      const Integer3& num_partitions = default_num_partitions(), const Real window = default_window())
+        : base_type(), rng_(), matrix_sizes_(matrix_sizes), subvolume_length_(subvolume_length),
+          num_partitions_(num_partitions), window_(window)
     {
         ; // do nothing
     }
@@ -40,6 +42,16 @@ public:
         return 0.0;
     }
 
+    static inline const Integer3 default_num_partitions()
+    {
+        return Integer3(1, 1, 1);
+    }
+
+    static inline const Real default_window()
+    {
+        return 0.0;
+    }
+
     virtual ~MesoscopicFactory()
     {
         ; // do nothing
@@ -100,12 +112,20 @@ public:
         const boost::shared_ptr<Model>& model,
         const boost::shared_ptr<world_type>& world) const
     {
+        if (num_partitions_ != default_num_partitions())
+        {
+            return new MesoscopicSimulator(model, world, num_partitions_, window_);
+        }
         return new MesoscopicSimulator(model, world);
     }
 
     virtual MesoscopicSimulator* create_simulator(
         const boost::shared_ptr<world_type>& world) const
     {
+        if (num_partitions_ != default_num_partitions())
+        {
+            return new MesoscopicSimulator(world, num_partitions_, window_);
+        }
         return new MesoscopicSimulator(world);
     }
 
@@ -114,6 +134,8 @@ protected:
     boost::shared_ptr<RandomNumberGenerator> rng_;
     Integer3 matrix_sizes_;
     Real subvolume_length_;
+    Integer3 num_partitions_;
+    Real window_;
 };
 
 } // meso
@@ -1,5 +1,6 @@
 #include <numeric>
 #include <vector>
+#include <algorithm>
 #include <gsl/gsl_sf_log.h>
 
 #include <cstring>
@@ -18,25 +19,108 @@ namespace ecell4
 namespace meso
 {
 
-void MesoscopicSimulator::increment(const boost::shared_ptr<MesoscopicWorld::PoolBase>& pool, const coordinate_type& c)
+void MesoscopicSimulator::initialize_species()
 {
-    pool->add_molecules(1, c);
+    const std::vector<Species>& species(world_->species());
+
+    pools_.resize(species.size());
+    dependencies_.clear();
+    dependencies_.resize(species.size());
+    for (std::vector<Species>::size_type i(0); i < species.size(); ++i)
+    {
+        const Species& sp(species[i]);
+        pools_[i] = world_->get_pool(sp);
+
+        dependency_container_type& deps(dependencies_[i]);
+        for (unsigned int idx(0); idx < diffusion_proxy_offset_; ++idx)
+        {
+            const std::vector<Integer> coefs(
+                dynamic_cast<ReactionRuleProxy&>(proxies_[idx]).check_dependency(sp));
+            if (static_cast<std::size_t>(std::count(coefs.begin(), coefs.end(), 0))
+                < coefs.size())
+            {
+                deps.push_back(std::make_pair(idx, coefs));
+            }
+        }
+        for (unsigned int idx(diffusion_proxy_offset_); idx < proxies_.size(); ++idx)
+        {
+            if (dynamic_cast<DiffusionProxy&>(proxies_[idx]).species() == sp)
+            {
+                deps.push_back(std::make_pair(idx, std::vector<Integer>()));
+            }
+        }
+    }
+}
+
+void MesoscopicSimulator::update_dependents(
+    const Integer& idx, const coordinate_type& c, const Integer val)
+{
+    const dependency_container_type& deps(dependencies_[idx]);
+    for (dependency_container_type::const_iterator i(deps.begin());
+        i != deps.end(); ++i)
+    {
+        if ((*i).first < diffusion_proxy_offset_)
+        {
+            static_cast<ReactionRuleProxy&>(proxies_[(*i).first]).inc_with_coefs(
+                (*i).second, c, val);
+        }
+        update_propensity((*i).first, c);
+    }
+}
 
-    for (boost::ptr_vector<ReactionRuleProxyBase>::iterator i(proxies_.begin());
-        i != proxies_.end(); ++i)
+void MesoscopicSimulator::update_propensity(
+    const unsigned int idx, const coordinate_type& c)
+{
+    Real& a(propensities_[c * proxies_.size() + idx]);
+    const Real a_new(proxies_[idx].propensity(c));
+    total_propensities_[c] += a_new - a;
+    a = a_new;
+}
+
+void MesoscopicSimulator::initialize_propensities()
+{
+    const unsigned int num_proxies(proxies_.size());
+    propensities_.resize(world_->num_subvolumes() * num_proxies);
+    total_propensities_.resize(world_->num_subvolumes());
+    for (coordinate_type c(0); c < world_->num_subvolumes(); ++c)
     {
-        (*i).inc(pool->species(), c);
+        Real atot(0.0);
+        for (unsigned int idx(0); idx < num_proxies; ++idx)
+        {
+            const Real a(proxies_[idx].propensity(c));
+            propensities_[c * num_proxies + idx] = a;
+            atot += a;
+        }
+        total_propensities_[c] = atot;
     }
 }
 
-void MesoscopicSimulator::decrement(const boost::shared_ptr<MesoscopicWorld::PoolBase>& pool, const coordinate_type& c)
+void MesoscopicSimulator::increment(const Integer& idx, const coordinate_type& c)
+{
+    pools_[idx]->add_molecules(1, c);
+    update_dependents(idx, c, +1);
+}
+
+void MesoscopicSimulator::decrement(const Integer& idx, const coordinate_type& c)
 {
-    pool->remove_molecules(1, c);
+    pools_[idx]->remove_molecules(1, c);
+    update_dependents(idx, c, -1);
+}
+
+void MesoscopicSimulator::diffuse(
+    const Integer& idx, const coordinate_type& src, const coordinate_type& dst)
+{
+    decrement(idx, src);
 
-    for (boost::ptr_vector<ReactionRuleProxyBase>::iterator i(proxies_.begin());
-        i != proxies_.end(); ++i)
+    if (partitions_.empty() || partition_ids_[src] == partition_ids_[dst])
+    {
+        increment(idx, dst);
+        interrupt(dst);
+    }
+    else
     {
-        (*i).dec(pool->species(), c);
+        // the molecule is delivered at the end of the window.
+        partitions_[partition_ids_[src]].outbox.push_back(std::make_pair(idx, dst));
     }
 }
 
@@ -48,22 +132,31 @@ void MesoscopicSimulator::increment_molecules(const Species& sp, const coordinat
         {
             return; // do nothing
         }
+        else if (!partitions_.empty())
+        {
+            throw NotSupported(
+                "A new species cannot be produced with partitions."
+                " Give a static model.");
+        }
 
-        const boost::shared_ptr<MesoscopicWorld::PoolBase> pool = world_->reserve_pool(sp);
+        world_->reserve_pool(sp);
         proxies_.push_back(create_diffusion_proxy(sp));
-        increment(pool, c);
-    }
-    else
-    {
-        increment(world_->get_pool(sp), c);
+        for (unsigned int idx(0); idx < diffusion_proxy_offset_; ++idx)
+        {
+            proxies_[idx].initialize();  // update the candidates.
+        }
+        initialize_species();
+        initialize_propensities();
     }
+
+    increment(world_->species_index(sp), c);
 }
 
 void MesoscopicSimulator::decrement_molecules(const Species& sp, const coordinate_type& c)
 {
     if (world_->has_species(sp))
     {
-        decrement(world_->get_pool(sp), c);
+        decrement(world_->species_index(sp), c);
     }
     else
     {
@@ -74,37 +167,34 @@ void MesoscopicSimulator::decrement_molecules(const Species& sp, const coordinat
 std::pair<Real, MesoscopicSimulator::ReactionRuleProxyBase*>
 MesoscopicSimulator::draw_next_reaction(const coordinate_type& c)
 {
-    std::vector<double> a(proxies_.size());
-    for (unsigned int idx(0); idx < proxies_.size(); ++idx)
-    {
-        a[idx] = proxies_[idx].propensity(c);
-    }
+    const unsigned int num_proxies(proxies_.size());
+    const std::vector<Real>::const_iterator a(
+        propensities_.begin() + c * num_proxies);
 
-    const double atot(std::accumulate(a.begin(), a.end(), double(0.0)));
-    if (atot == 0.0)
+    Real atot(total_propensities_[c]);
+    while (atot > 0.0)
     {
-        return std::make_pair(inf, (ReactionRuleProxyBase*)NULL);
-    }
+        const double rnd2(rng(c)->uniform(0, atot));
 
-    const double rnd1(rng()->uniform(0, 1));
-    const double dt(gsl_sf_log(1.0 / rnd1) / double(atot));
-    const double rnd2(rng()->uniform(0, atot));
-
-    int u(-1);
-    double acc(0.0);
-    const int len_a(a.size());
-    do
-    {
-        u++;
-        acc += a[u];
-    } while (acc < rnd2 && u < len_a - 1);
+        double acc(0.0);
+        for (unsigned int u(0); u < num_proxies; ++u)
+        {
+            acc += a[u];
+            if (acc > rnd2 && a[u] > 0.0)
+            {
+                const double rnd1(rng(c)->uniform(0, 1));
+                const double dt(gsl_sf_log(1.0 / rnd1) / double(atot));
+                return std::make_pair(dt, &proxies_[u]);
+            }
+        }
 
-    if (len_a == u)
-    {
-        return std::make_pair(inf, (ReactionRuleProxyBase*)NULL);
+        // The running total was overestimated by round-off errors.
+        // Retry with the exact one.
+        total_propensities_[c] = acc;
+        atot = acc;
     }
 
-    return std::make_pair(dt, &proxies_[u]);
+    return std::make_pair(inf, (ReactionRuleProxyBase*)NULL);
 }
 
 void MesoscopicSimulator::interrupt_all(const Real& t)
@@ -118,8 +208,101 @@ void MesoscopicSimulator::interrupt_all(const Real& t)
     }
 }
 
+void MesoscopicSimulator::run_partition(Partition& p, const Real tnext)
+{
+    const coordinate_type none(event_ids_.size());
+
+    while (p.scheduler.next_time() <= tnext)
+    {
+        p.interrupted = none;
+        EventScheduler::value_type const& top(p.scheduler.top());
+        const Real tev(top.second->time());
+        top.second->fire(); // top.second->time_ is updated in fire()
+        p.scheduler.update(top);
+
+        if (p.interrupted != none)
+        {
+            EventScheduler::identifier_type evid(event_ids_[p.interrupted]);
+            boost::shared_ptr<Event> ev(p.scheduler.get(evid));
+            ev->interrupt(tev);
+            p.scheduler.update(std::make_pair(evid, ev));
+        }
+    }
+}
+
+void MesoscopicSimulator::step_partitions(const Real tnext)
+{
+    const int num_partitions(partitions_.size());
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < num_partitions; ++i)
+    {
+        // exceptions must not be thrown across the parallel region.
+        try
+        {
+            run_partition(partitions_[i], tnext);
+        }
+        catch (const std::exception& e)
+        {
+            partitions_[i].error = e.what();
+        }
+    }
+
+    for (int i = 0; i < num_partitions; ++i)
+    {
+        if (!partitions_[i].error.empty())
+        {
+            const std::string error(partitions_[i].error);
+            partitions_[i].error.clear();
+            throw IllegalState(error);
+        }
+    }
+
+    std::vector<coordinate_type> arrived;
+    for (int i = 0; i < num_partitions; ++i)
+    {
+        Partition& p(partitions_[i]);
+        for (std::vector<std::pair<Integer, coordinate_type> >::const_iterator
+                j(p.outbox.begin()); j != p.outbox.end(); ++j)
+        {
+            increment((*j).first, (*j).second);
+            arrived.push_back((*j).second);
+        }
+        p.outbox.clear();
+
+        last_reactions_.insert(
+            last_reactions_.end(), p.last_reactions.begin(), p.last_reactions.end());
+        p.last_reactions.clear();
+    }
+
+    std::sort(arrived.begin(), arrived.end());
+    arrived.erase(std::unique(arrived.begin(), arrived.end()), arrived.end());
+    for (std::vector<coordinate_type>::const_iterator i(arrived.begin());
+        i != arrived.end(); ++i)
+    {
+        EventScheduler& scheduler(partitions_[partition_ids_[*i]].scheduler);
+        EventScheduler::identifier_type evid(event_ids_[*i]);
+        boost::shared_ptr<Event> ev(scheduler.get(evid));
+        ev->interrupt(tnext);
+        scheduler.update(std::make_pair(evid, ev));
+    }
+
+    this->set_t(tnext);
+    num_steps_++;
+}
+
 void MesoscopicSimulator::step(void)
 {
+    reset_last_reactions();
+
+    if (!partitions_.empty())
+    {
+        step_partitions(t() + window_);
+        return;
+    }
+
     if (this->dt() == inf)
     {
         // Any reactions cannot occur.
@@ -164,6 +347,14 @@ bool MesoscopicSimulator::step(const Real &upto)
         return false;
     }
 
+    if (!partitions_.empty())
+    {
+        reset_last_reactions();
+        const Real tnext(std::min(t() + window_, upto));
+        step_partitions(tnext);
+        return (tnext < upto);
+    }
+
     if (upto >= next_time())
     {
         step();
@@ -185,17 +376,25 @@ MesoscopicSimulator::create_diffusion_proxy(const Species& sp)
 {
     DiffusionProxy* proxy = new DiffusionProxy(this, sp);
     proxy->initialize();
-    for (boost::ptr_vector<ReactionRuleProxyBase>::size_type i = 0;
-         i < diffusion_proxy_offset_; ++i)
-    {
-        proxy->set_dependency(
-            dynamic_cast<ReactionRuleProxy*>(&proxies_[i]));
-    }
     return proxy;
 }
 
 void MesoscopicSimulator::initialize(void)
 {
+    if (num_partitions_ != Integer3(1, 1, 1) && model_->is_static())
+    {
+        // reserve all the species in advance, which must not be done in parallel.
+        const std::vector<Species> species(model_->list_species());
+        for (std::vector<Species>::const_iterator i(species.begin());
+            i != species.end(); ++i)
+        {
+            if (!world_->has_species(*i) && !world_->has_structure(*i))
+            {
+                world_->reserve_pool(*i);
+            }
+        }
+    }
+
     const Model::reaction_rule_container_type&
         reaction_rules(model_->reaction_rules());
 
@@ -250,8 +449,19 @@ void MesoscopicSimulator::initialize(void)
         proxies_.push_back(create_diffusion_proxy(*i));
     }
 
+    initialize_species();
+    initialize_propensities();
+
     scheduler_.clear();
     event_ids_.resize(world_->num_subvolumes());
+
+    if (num_partitions_ != Integer3(1, 1, 1))
+    {
+        initialize_partitions();
+        return;
+    }
+
+    partitions_.clear();
     for (Integer i(0); i < world_->num_subvolumes(); ++i)
     {
         event_ids_[i] =
@@ -260,6 +470,61 @@ void MesoscopicSimulator::initialize(void)
     }
 }
 
+void MesoscopicSimulator::initialize_partitions()
+{
+    const Integer3 matrix_sizes(world_->matrix_sizes());
+    if (num_partitions_.col < 1 || num_partitions_.col > matrix_sizes.col
+        || num_partitions_.row < 1 || num_partitions_.row > matrix_sizes.row
+        || num_partitions_.layer < 1 || num_partitions_.layer > matrix_sizes.layer)
+    {
+        throw IllegalArgument(
+            "The number of partitions must be between one and the matrix size.");
+    }
+
+    if (window_ <= 0.0)
+    {
+        // a tenth of the shortest mean residence time in a subvolume.
+        Real kmax(0.0);
+        for (unsigned int idx(diffusion_proxy_offset_); idx < proxies_.size(); ++idx)
+        {
+            kmax = std::max(kmax, dynamic_cast<DiffusionProxy&>(proxies_[idx]).k());
+        }
+        if (kmax <= 0.0)
+        {
+            throw IllegalArgument("The window must be given without diffusion.");
+        }
+        window_ = 0.1 / kmax;
+    }
+
+    partitions_.clear();
+    for (Integer i(0);
+        i < num_partitions_.col * num_partitions_.row * num_partitions_.layer; ++i)
+    {
+        const boost::shared_ptr<RandomNumberGenerator> prng(
+            new GSLRandomNumberGenerator(world_->rng()->uniform_int(0, 2147483647)));
+        partitions_.push_back(new Partition(prng));
+    }
+
+    partition_ids_.resize(world_->num_subvolumes());
+    for (coordinate_type c(0); c < world_->num_subvolumes(); ++c)
+    {
+        const Integer3 g(world_->coord2global(c));
+        partition_ids_[c] =
+            ((g.col * num_partitions_.col / matrix_sizes.col)
+                * num_partitions_.row
+                + g.row * num_partitions_.row / matrix_sizes.row)
+            * num_partitions_.layer
+            + g.layer * num_partitions_.layer / matrix_sizes.layer;
+    }
+
+    for (coordinate_type c(0); c < world_->num_subvolumes(); ++c)
+    {
+        event_ids_[c] =
+            partitions_[partition_ids_[c]].scheduler.add(
+                boost::shared_ptr<Event>(new SubvolumeEvent(this, c, t())));
+    }
+}
+
 Real MesoscopicSimulator::dt(void) const
 {
     return next_time() - t();
@@ -267,6 +532,10 @@ Real MesoscopicSimulator::dt(void) const
 
 Real MesoscopicSimulator::next_time(void) const
 {
+    if (!partitions_.empty())
+    {
+        return t() + window_;
+    }
     return scheduler_.next_time();
 }
 
@@ -7,6 +7,7 @@
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/SimulatorBase.hpp>
 #include <ecell4/core/EventScheduler.hpp>
+#include <ecell4/core/get_mapper_mf.hpp>
 
 #include "MesoscopicWorld.hpp"
 
@@ -88,6 +89,15 @@ public:
 
 protected:
 
+    /**
+     * a list of pairs of a proxy index and the coefficients of a species
+     * for the reactants of the proxy. the coefficients are empty for
+     * the diffusion proxy of the species itself.
+     */
+    typedef std::vector<std::pair<unsigned int, std::vector<Integer> > >
+        dependency_container_type;
+    typedef std::vector<dependency_container_type> dependency_table_type;
+
     class ReactionRuleProxyBase
     {
     public:
@@ -118,19 +128,12 @@ protected:
         virtual const Real propensity(const coordinate_type& c) const = 0;
         virtual void fire(const Real t, const coordinate_type& src) = 0;
 
-        virtual void inc(
-            const Species& sp, const coordinate_type& c, const Integer val = +1) = 0;
-
-        inline void dec(const Species& sp, const coordinate_type& c)
-        {
-            inc(sp, c, -1);
-        }
-
     protected:
 
-        inline const boost::shared_ptr<RandomNumberGenerator>& rng() const
+        inline const boost::shared_ptr<RandomNumberGenerator>& rng(
+            const coordinate_type& c) const
         {
-            return sim_->world()->rng();
+            return sim_->rng(c);
         }
 
         inline const MesoscopicWorld& world() const
@@ -150,6 +153,11 @@ protected:
 
         typedef ReactionRuleProxyBase base_type;
 
+        /**
+         * pairs of a species index and its coefficient for a reactant.
+         */
+        typedef std::vector<std::pair<Integer, Integer> > candidate_container_type;
+
         ReactionRuleProxy()
             : base_type()
         {
@@ -213,7 +221,7 @@ protected:
             {
                 const std::vector<ReactionRule>::size_type
                     rnd2(static_cast<std::vector<ReactionRule>::size_type>(
-                        rng()->uniform_int(0, retval.second - 1)));
+                        rng(c)->uniform_int(0, retval.second - 1)));
                 if (rnd2 >= reactions.size())
                 {
                     return std::make_pair(ReactionRule(), c);
@@ -267,6 +275,24 @@ protected:
         virtual std::pair<ReactionRule::reactant_container_type, Integer>
             __draw(const coordinate_type& c) = 0;
 
+        /**
+         * list up the species matching the given reactant in the world.
+         */
+        candidate_container_type list_candidates(const Species& pttrn) const
+        {
+            const std::vector<Species>& species(world().species());
+            candidate_container_type candidates;
+            for (std::vector<Species>::size_type i(0); i < species.size(); ++i)
+            {
+                const Integer coef(get_coef(pttrn, species[i]));
+                if (coef > 0)
+                {
+                    candidates.push_back(std::make_pair(i, coef));
+                }
+            }
+            return candidates;
+        }
+
     protected:
 
         ReactionRule rr_;
@@ -297,11 +323,6 @@ protected:
             ; // do nothing
         }
 
-        void inc(const Species& sp, const coordinate_type& c, const Integer val = +1)
-        {
-            ; // do nothing
-        }
-
         void initialize()
         {
             ; // do nothing
@@ -343,56 +364,36 @@ protected:
             num_tot1_[c] += coefs[0] * val;
         }
 
-        void inc(const Species& sp, const coordinate_type& c, const Integer val = +1)
-        {
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-            const Integer coef(get_coef(reactants[0], sp));
-            if (coef > 0)
-            {
-                num_tot1_[c] += coef * val;
-            }
-        }
-
         void initialize()
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
+            candidates1_ = list_candidates(rr_.reactants()[0]);
 
             std::fill(num_tot1_.begin(), num_tot1_.end(), 0);
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates1_.begin());
+                i != candidates1_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[0], *i));
-                if (coef > 0)
+                for (Integer j(0); j < world().num_subvolumes(); ++j)
                 {
-                    for (Integer j(0); j < world().num_subvolumes(); ++j)
-                    {
-                        num_tot1_[j] += coef * world().num_molecules_exact(*i, j);
-                    }
+                    num_tot1_[j] += (*i).second * world().num_molecules_by_index((*i).first, j);
                 }
             }
         }
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-
-            const Real rnd1(rng()->uniform(0.0, num_tot1_[c]));
+            const Real rnd1(rng(c)->uniform(0.0, num_tot1_[c]));
 
             Integer num_tot(0);
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates1_.begin());
+                i != candidates1_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[0], *i));
-                if (coef > 0)
+                num_tot += (*i).second * world().num_molecules_by_index((*i).first, c);
+                if (num_tot >= rnd1)
                 {
-                    num_tot += coef * world().num_molecules_exact(*i, c);
-                    if (num_tot >= rnd1)
-                    {
-                        return std::make_pair(
-                            ReactionRule::reactant_container_type(1, *i), coef);
-                    }
+                    return std::make_pair(
+                        ReactionRule::reactant_container_type(
+                            1, world().species()[(*i).first]),
+                        (*i).second);
                 }
             }
 
@@ -407,6 +408,7 @@ protected:
     protected:
 
         std::vector<Integer> num_tot1_;
+        candidate_container_type candidates1_;
     };
 
     class SecondOrderReactionRuleProxy:
@@ -436,38 +438,24 @@ protected:
             num_tot12_[c] += coefs[0] * coefs[1] * val;
         }
 
-        void inc(const Species& sp, const coordinate_type& c, const Integer val = +1)
-        {
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-            const Integer coef1(get_coef(reactants[0], sp));
-            const Integer coef2(get_coef(reactants[1], sp));
-            if (coef1 > 0 || coef2 > 0)
-            {
-                const Integer tmp(coef1 * val);
-                num_tot1_[c] += tmp;
-                num_tot2_[c] += coef2 * val;
-                num_tot12_[c] += coef2 * tmp;
-            }
-        }
-
         void initialize()
         {
-            const std::vector<Species>& species(world().list_species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
+            candidates1_ = list_candidates(reactants[0]);
+            candidates2_ = list_candidates(reactants[1]);
 
             std::fill(num_tot1_.begin(), num_tot1_.end(), 0);
             std::fill(num_tot2_.begin(), num_tot2_.end(), 0);
             std::fill(num_tot12_.begin(), num_tot12_.end(), 0);
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (std::vector<Species>::size_type i(0); i < world().species().size(); ++i)
             {
-                const Integer coef1(get_coef(reactants[0], *i));
-                const Integer coef2(get_coef(reactants[1], *i));
+                const Integer coef1(get_coef(reactants[0], world().species()[i]));
+                const Integer coef2(get_coef(reactants[1], world().species()[i]));
                 if (coef1 > 0 || coef2 > 0)
                 {
                     for (Integer j(0); j < world().num_subvolumes(); ++j)
                     {
-                        const Integer num(world().num_molecules_exact(*i, j));
+                        const Integer num(world().num_molecules_by_index(i, j));
                         const Integer tmp(coef1 * num);
                         num_tot1_[j] += tmp;
                         num_tot2_[j] += coef2 * num;
@@ -479,46 +467,37 @@ protected:
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
+            const std::vector<Species>& species(world().species());
 
-            const Real rnd1(rng()->uniform(0.0, num_tot1_[c]));
+            const Real rnd1(rng(c)->uniform(0.0, num_tot1_[c]));
 
-            Integer num_tot(0), coef1(0);
-            std::vector<Species>::const_iterator itr1(species.begin());
-            for (; itr1 != species.end(); ++itr1)
+            Integer num_tot(0), idx1(0), coef1(0);
+            for (candidate_container_type::const_iterator i(candidates1_.begin());
+                i != candidates1_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[0], *itr1));
-                if (coef > 0)
+                num_tot += (*i).second * world().num_molecules_by_index((*i).first, c);
+                if (num_tot >= rnd1)
                 {
-                    num_tot += coef * world().num_molecules_exact(*itr1, c);
-                    if (num_tot >= rnd1)
-                    {
-                        coef1 = coef;
-                        break;
-                    }
+                    idx1 = (*i).first;
+                    coef1 = (*i).second;
+                    break;
                 }
             }
 
-            const Real rnd2(
-                rng()->uniform(0.0, num_tot2_[c] - get_coef(reactants[0], *itr1)));
+            const Real rnd2(rng(c)->uniform(0.0, num_tot2_[c] - coef1));
 
             num_tot = 0;
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates2_.begin());
+                i != candidates2_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[1], *i));
-                if (coef > 0)
+                const Integer num(world().num_molecules_by_index((*i).first, c));
+                num_tot += (*i).second * ((*i).first == idx1 ? num - 1 : num);
+                if (num_tot >= rnd2)
                 {
-                    const Integer num(world().num_molecules_exact(*i, c));
-                    num_tot += coef * (i == itr1 ? num - 1 : num);
-                    if (num_tot >= rnd2)
-                    {
-                        ReactionRule::reactant_container_type exact_reactants(2);
-                        exact_reactants[0] = *itr1;
-                        exact_reactants[1] = *i;
-                        return std::make_pair(exact_reactants, coef1 * coef);
-                    }
+                    ReactionRule::reactant_container_type exact_reactants(2);
+                    exact_reactants[0] = species[idx1];
+                    exact_reactants[1] = species[(*i).first];
+                    return std::make_pair(exact_reactants, coef1 * (*i).second);
                 }
             }
 
@@ -533,6 +512,7 @@ protected:
     protected:
 
         std::vector<Integer> num_tot1_, num_tot2_, num_tot12_;
+        candidate_container_type candidates1_, candidates2_;
     };
 
     class StructureSecondOrderReactionRuleProxy:
@@ -563,16 +543,6 @@ protected:
             num_tot_[c] += coefs[spidx_] * val;
         }
 
-        void inc(const Species& sp, const coordinate_type& c, const Integer val = +1)
-        {
-            const ReactionRule::reactant_container_type& reactants(rr_.reactants());
-            const Integer coef(get_coef(reactants[spidx_], sp));
-            if (coef > 0)
-            {
-                num_tot_[c] += coef * val;
-            }
-        }
-
         void initialize()
         {
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
@@ -589,44 +559,36 @@ protected:
                     "A second order reaction between structures has no mean.");
             }
 
-            const std::vector<Species>& species(world().list_species());
+            candidates_ = list_candidates(reactants[spidx_]);
+
             std::fill(num_tot_.begin(), num_tot_.end(), 0);
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[spidx_], *i));
-                if (coef > 0)
+                for (Integer j(0); j < world().num_subvolumes(); ++j)
                 {
-                    for (Integer j(0); j < world().num_subvolumes(); ++j)
-                    {
-                        num_tot_[j] += coef * world().num_molecules_exact(*i, j);
-                    }
+                    num_tot_[j] += (*i).second * world().num_molecules_by_index((*i).first, j);
                 }
             }
         }
 
         std::pair<ReactionRule::reactant_container_type, Integer> __draw(const coordinate_type& c)
         {
-            const std::vector<Species>& species(world().list_species());
             const ReactionRule::reactant_container_type& reactants(rr_.reactants());
 
-            const Real rnd1(rng()->uniform(0.0, num_tot_[c]));
+            const Real rnd1(rng(c)->uniform(0.0, num_tot_[c]));
 
             Integer tot(0);
-            for (std::vector<Species>::const_iterator i(species.begin());
-                i != species.end(); ++i)
+            for (candidate_container_type::const_iterator i(candidates_.begin());
+                i != candidates_.end(); ++i)
             {
-                const Integer coef(get_coef(reactants[spidx_], *i));
-                if (coef > 0)
+                tot += (*i).second * world().num_molecules_by_index((*i).first, c);
+                if (tot >= rnd1)
                 {
-                    tot += coef * world().num_molecules_exact(*i, c);
-                    if (tot >= rnd1)
-                    {
-                        ReactionRule::reactant_container_type retval(2);
-                        retval[spidx_] = *i;
-                        retval[stidx_] = reactants[stidx_];
-                        return std::make_pair(retval, coef);
-                    }
+                    ReactionRule::reactant_container_type retval(2);
+                    retval[spidx_] = world().species()[(*i).first];
+                    retval[stidx_] = reactants[stidx_];
+                    return std::make_pair(retval, (*i).second);
                 }
             }
             throw IllegalState("StructureSecondOrderReactionRuleProxy: Never reach here.");
@@ -642,6 +604,7 @@ protected:
 
         std::vector<Integer> num_tot_;
         ReactionRule::reactant_container_type::size_type stidx_, spidx_;
+        candidate_container_type candidates_;
     };
 
     class DiffusionProxy
@@ -651,22 +614,17 @@ protected:
 
         typedef ReactionRuleProxyBase base_type;
 
-    protected:
-
-        typedef std::pair<ReactionRuleProxy*, std::vector<Integer> >
-            dependency_type;
-        typedef std::vector<dependency_type> dependency_container_type;
-
     public:
 
         DiffusionProxy()
-            : base_type(), pool_(), dependencies_()
+            : base_type(), pool_(), idx_()
         {
             ;
         }
 
         DiffusionProxy(MesoscopicSimulator* sim, const Species& sp)
-            : base_type(sim), pool_(sim->world()->get_pool(sp)), dependencies_()
+            : base_type(sim), pool_(sim->world()->get_pool(sp)),
+              idx_(sim->world()->species_index(sp))
         {
             ;
         }
@@ -683,7 +641,7 @@ protected:
                 py(1.0 / (lengths[1] * lengths[1])),
                 pz(1.0 / (lengths[2] * lengths[2]));
 
-            const Real rnd1(sim_->world()->rng()->uniform(0.0, px + py + pz));
+            const Real rnd1(sim_->rng(c)->uniform(0.0, px + py + pz));
 
             if (rnd1 < px * 0.5)
             {
@@ -723,9 +681,14 @@ protected:
             return k_ * pool_->num_molecules(c);
         }
 
-        void inc(const Species& sp, const coordinate_type& c, const Integer val = +1)
+        const Real k() const
         {
-            ; // do nothing
+            return k_;
+        }
+
+        const Species& species() const
+        {
+            return pool_->species();
         }
 
         virtual void fire(const Real t, const coordinate_type& src)
@@ -744,39 +707,14 @@ protected:
                 return;
             }
 
-            {
-                // sim_->decrement(pool_, src);
-                // sim_->increment(pool_, dst);
-
-                pool_->remove_molecules(1, src);
-                pool_->add_molecules(1, dst);
-
-                for (dependency_container_type::const_iterator i(dependencies_.begin());
-                     i != dependencies_.end(); ++i)
-                {
-                    (*i).first->inc_with_coefs((*i).second, src, -1);
-                    (*i).first->inc_with_coefs((*i).second, dst, +1);
-                }
-            }
-
-            sim_->interrupt(dst);
-        }
-
-        void set_dependency(ReactionRuleProxy* proxy)
-        {
-            const std::vector<Integer> coefs = proxy->check_dependency(pool_->species());
-            if (std::count(coefs.begin(), coefs.end(), 0) < coefs.size())
-            {
-                dependencies_.push_back(std::make_pair(proxy, coefs));
-            }
+            sim_->diffuse(idx_, src, dst);
         }
 
     protected:
 
         const boost::shared_ptr<MesoscopicWorld::PoolBase> pool_;
+        const Integer idx_;
         Real k_;
-
-        dependency_container_type dependencies_;
     };
 
     struct SubvolumeEvent
@@ -798,7 +736,6 @@ protected:
         virtual void fire()
         {
             assert(proxy_ != NULL);
-            sim_->reset_last_reactions();
             proxy_->fire(time_, coord_);
             update();
         }
@@ -825,18 +762,63 @@ protected:
         ReactionRuleProxyBase* proxy_;
     };
 
+    /**
+     * a block of subvolumes owned by a worker thread. molecules diffusing
+     * out of the block are kept in the outbox until the end of the window.
+     */
+    struct Partition
+    {
+        Partition(const boost::shared_ptr<RandomNumberGenerator>& rng)
+            : rng(rng), interrupted(0)
+        {
+            ;
+        }
+
+        EventScheduler scheduler;
+        boost::shared_ptr<RandomNumberGenerator> rng;
+        coordinate_type interrupted;
+        std::vector<std::pair<Integer, coordinate_type> > outbox;
+        std::vector<std::pair<ReactionRule, reaction_info_type> > last_reactions;
+        std::string error;
+    };
+
 public:
 
     MesoscopicSimulator(
         boost::shared_ptr<Model> model,
         boost::shared_ptr<MesoscopicWorld> world)
-        : base_type(model, world)
+        : base_type(model, world), num_partitions_(1, 1, 1), window_(0.0)
     {
         initialize();
     }
 
     MesoscopicSimulator(boost::shared_ptr<MesoscopicWorld> world)
-        : base_type(world)
+        : base_type(world), num_partitions_(1, 1, 1), window_(0.0)
+    {
+        initialize();
+    }
+
+    /**
+     * split the subvolumes into num_partitions blocks, which are simulated
+     * in parallel (when built with OpenMP). molecules diffusing across
+     * the boundary of blocks arrive at the end of each time window.
+     * the error of this splitting decreases with window, which must be
+     * much shorter than the mean residence time of a molecule in
+     * a subvolume. a non-positive window means a tenth of it.
+     */
+    MesoscopicSimulator(
+        boost::shared_ptr<Model> model,
+        boost::shared_ptr<MesoscopicWorld> world,
+        const Integer3& num_partitions, const Real window)
+        : base_type(model, world), num_partitions_(num_partitions), window_(window)
+    {
+        initialize();
+    }
+
+    MesoscopicSimulator(
+        boost::shared_ptr<MesoscopicWorld> world,
+        const Integer3& num_partitions, const Real window)
+        : base_type(world), num_partitions_(num_partitions), window_(window)
     {
         initialize();
     }
@@ -861,7 +843,15 @@ public:
 
     void add_last_reaction(const ReactionRule& rr, const reaction_info_type& ri)
     {
-        last_reactions_.push_back(std::make_pair(rr, ri));
+        if (partitions_.empty())
+        {
+            last_reactions_.push_back(std::make_pair(rr, ri));
+        }
+        else
+        {
+            partitions_[partition_ids_[ri.coordinate()]].last_reactions.push_back(
+                std::make_pair(rr, ri));
+        }
     }
 
     void reset_last_reactions()
@@ -879,9 +869,40 @@ public:
         return (*world_).rng();
     }
 
+    /**
+     * return the random number generator for the given subvolume.
+     * each partition has its own one.
+     */
+    inline const boost::shared_ptr<RandomNumberGenerator>& rng(
+        const coordinate_type& c) const
+    {
+        if (partitions_.empty())
+        {
+            return (*world_).rng();
+        }
+        return partitions_[partition_ids_[c]].rng;
+    }
+
     void interrupt(const coordinate_type& coord)
     {
-        interrupted_ = coord;
+        if (partitions_.empty())
+        {
+            interrupted_ = coord;
+        }
+        else
+        {
+            partitions_[partition_ids_[coord]].interrupted = coord;
+        }
+    }
+
+    const Integer3& num_partitions() const
+    {
+        return num_partitions_;
+    }
+
+    Real window() const
+    {
+        return window_;
     }
 
 protected:
@@ -894,8 +915,18 @@ protected:
 
     void increment_molecules(const Species& sp, const coordinate_type& c);
     void decrement_molecules(const Species& sp, const coordinate_type& c);
-    void increment(const boost::shared_ptr<MesoscopicWorld::PoolBase>& pool, const coordinate_type& c);
-    void decrement(const boost::shared_ptr<MesoscopicWorld::PoolBase>& pool, const coordinate_type& c);
+    void increment(const Integer& idx, const coordinate_type& c);
+    void decrement(const Integer& idx, const coordinate_type& c);
+    void diffuse(const Integer& idx, const coordinate_type& src, const coordinate_type& dst);
+
+    void initialize_species();
+    void update_dependents(const Integer& idx, const coordinate_type& c, const Integer val);
+    void update_propensity(const unsigned int idx, const coordinate_type& c);
+    void initialize_propensities();
+
+    void initialize_partitions();
+    void run_partition(Partition& p, const Real tnext);
+    void step_partitions(const Real tnext);
 
 protected:
 
@@ -907,6 +938,24 @@ protected:
     EventScheduler scheduler_;
     std::vector<EventScheduler::identifier_type> event_ids_;
     coordinate_type interrupted_;
+
+    /**
+     * pools and the dependent proxies indexed by the species index.
+     */
+    std::vector<boost::shared_ptr<MesoscopicWorld::PoolBase> > pools_;
+    dependency_table_type dependencies_;
+
+    /**
+     * the propensities of proxies cached for each subvolume, which are
+     * stored in subvolume-major order, and their totals.
+     */
+    std::vector<Real> propensities_;
+    std::vector<Real> total_propensities_;
+
+    Integer3 num_partitions_;
+    Real window_;
+    boost::ptr_vector<Partition> partitions_;
+    std::vector<unsigned int> partition_ids_;
 };
 
 } // meso
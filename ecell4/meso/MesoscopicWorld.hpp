@@ -386,6 +386,16 @@ public:
         return cs_->has_species(sp);
     }
 
+    Integer species_index(const Species& sp) const
+    {
+        return cs_->species_index(sp);
+    }
+
+    Integer num_molecules_by_index(const Integer& idx, const coordinate_type& c) const
+    {
+        return cs_->num_molecules_by_index(idx, c);
+    }
+
     const std::vector<Species>& species() const;
     std::vector<Species> list_species() const;
 
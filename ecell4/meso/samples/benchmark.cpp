@@ -0,0 +1,75 @@
+#include <iostream>
+#include <cstdlib>
+#include <sys/time.h>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/meso/MesoscopicSimulator.hpp>
+
+using namespace ecell4;
+using namespace ecell4::meso;
+
+/**
+ * A + B <-> C with diffusing species in a cubic matrix.
+ */
+boost::shared_ptr<NetworkModel> generate_model()
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    const Species sp1("A", "0.005", "1"), sp2("B", "0.005", "1"), sp3("C", "0.005", "1");
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp3, 0.01));
+    model->add_reaction_rule(create_unbinding_reaction_rule(sp3, sp1, sp2, 0.3));
+    return model;
+}
+
+double walltime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+void measure(
+    const boost::shared_ptr<NetworkModel>& model, const Integer size,
+    const Integer3& num_partitions, const Real window, const Real duration)
+{
+    boost::shared_ptr<RandomNumberGenerator>
+        rng(new GSLRandomNumberGenerator());
+    rng->seed(0);
+    boost::shared_ptr<MesoscopicWorld> world(
+        new MesoscopicWorld(Real3(1, 1, 1), Integer3(size, size, size), rng));
+    world->bind_to(model);
+
+    const Integer num_subvolumes(size * size * size);
+    world->add_molecules(Species("A"), 10 * num_subvolumes);
+    world->add_molecules(Species("B"), 10 * num_subvolumes);
+
+    MesoscopicSimulator sim(model, world, num_partitions, window);
+
+    const double start(walltime());
+    sim.run(duration);
+    const double end(walltime());
+
+    std::cout << num_partitions.col * num_partitions.row * num_partitions.layer
+              << "\t" << (end - start)
+              << "\t" << world->num_molecules_exact(Species("C")) << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+    const Integer size(argc > 1 ? std::atoi(argv[1]) : 16);
+    const Real duration(argc > 2 ? std::atof(argv[2]) : 0.01);
+    const Real window(argc > 3 ? std::atof(argv[3]) : 0.0);
+
+    const boost::shared_ptr<NetworkModel> model(generate_model());
+
+    std::cout << "# partitions\ttime [s]\tC" << std::endl;
+    measure(model, size, Integer3(1, 1, 1), window, duration);
+    for (Integer n(2); n <= size && n <= 8; n *= 2)
+    {
+        measure(model, size, Integer3(n, n, n), window, duration);
+    }
+    return 0;
+}
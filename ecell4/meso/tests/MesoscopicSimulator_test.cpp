@@ -7,6 +7,8 @@
 #   include <boost/test/included/unit_test.hpp>
 #endif
 
+#include <cmath>
+
 #include <ecell4/core/RandomNumberGenerator.hpp>
 #include <ecell4/core/Model.hpp>
 #include <ecell4/core/NetworkModel.hpp>
@@ -49,3 +51,136 @@ BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_step)
     BOOST_CHECK(world->num_molecules(sp1, 0) == 9);
     BOOST_CHECK(world->num_molecules(sp2, 0) == 1);
 }
+
+/**
+ * a binding of diffusing "A" and "B" into "C".
+ */
+boost::shared_ptr<NetworkModel> create_binding_model()
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    Species sp1("A", "0.0025", "1");
+    Species sp2("B", "0.0025", "1");
+    Species sp3("C", "0.0025", "1");
+    ReactionRule rr1;
+    rr1.set_k(0.5);
+    rr1.add_reactant(sp1);
+    rr1.add_reactant(sp2);
+    rr1.add_product(sp3);
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(rr1);
+    return model;
+}
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_diffusion_and_reaction)
+{
+    boost::shared_ptr<NetworkModel> model(create_binding_model());
+    const Species sp1("A"), sp2("B"), sp3("C");
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<MesoscopicWorld> world(
+        new MesoscopicWorld(edge_lengths, Integer3(3, 3, 3), rng));
+
+    world->bind_to(model);
+    world->add_molecules(sp1, 60, 0);
+    world->add_molecules(sp2, 40, 26);
+
+    MesoscopicSimulator sim(model, world);
+    for (unsigned int i(0); i < 2000; ++i)
+    {
+        sim.step();
+    }
+
+    const Integer numA(world->num_molecules_exact(sp1));
+    const Integer numB(world->num_molecules_exact(sp2));
+    const Integer numC(world->num_molecules_exact(sp3));
+    BOOST_CHECK_EQUAL(numA + numC, 60);
+    BOOST_CHECK_EQUAL(numB + numC, 40);
+    BOOST_CHECK(numC > 0);
+    BOOST_CHECK(world->num_molecules_exact(sp1, 0) < 60);
+}
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_partitions)
+{
+    boost::shared_ptr<NetworkModel> model(create_binding_model());
+    const Species sp1("A"), sp2("B"), sp3("C");
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<MesoscopicWorld> world(
+        new MesoscopicWorld(edge_lengths, Integer3(4, 4, 4), rng));
+
+    world->bind_to(model);
+    world->add_molecules(sp1, 60, 0);
+    world->add_molecules(sp2, 40, 63);
+
+    MesoscopicSimulator sim(model, world, Integer3(2, 2, 1), 0.001);
+    BOOST_CHECK_EQUAL(sim.next_time(), 0.001);
+
+    sim.run(10.0);
+
+    BOOST_CHECK_CLOSE(sim.t(), 10.0, 1e-6);
+    const Integer numA(world->num_molecules_exact(sp1));
+    const Integer numB(world->num_molecules_exact(sp2));
+    const Integer numC(world->num_molecules_exact(sp3));
+    BOOST_CHECK_EQUAL(numA + numC, 60);
+    BOOST_CHECK_EQUAL(numB + numC, 40);
+    BOOST_CHECK(numC > 0);
+    BOOST_CHECK(world->num_molecules_exact(sp1, 0) < 60);
+}
+
+/**
+ * run the binding model from uniformly distributed molecules num_trials
+ * times, and return the mean and the variance of the number of "C" at t.
+ */
+std::pair<Real, Real> sample_bindings(
+    boost::shared_ptr<RandomNumberGenerator> rng,
+    const Integer3& num_partitions, const Real window,
+    const Real t, const Integer num_trials)
+{
+    boost::shared_ptr<NetworkModel> model(create_binding_model());
+    const Species sp1("A"), sp2("B"), sp3("C");
+
+    const Real L(1.0);
+    const Real3 edge_lengths(L, L, L);
+    Real sum(0.0), sum2(0.0);
+    for (Integer i(0); i < num_trials; ++i)
+    {
+        boost::shared_ptr<MesoscopicWorld> world(
+            new MesoscopicWorld(edge_lengths, Integer3(4, 4, 4), rng));
+        world->bind_to(model);
+        world->add_molecules(sp1, 60);
+        world->add_molecules(sp2, 40);
+
+        MesoscopicSimulator sim(model, world, num_partitions, window);
+        sim.run(t);
+
+        const Real numC(world->num_molecules_exact(sp3));
+        sum += numC;
+        sum2 += numC * numC;
+    }
+
+    const Real mean(sum / num_trials);
+    return std::make_pair(mean, sum2 / num_trials - mean * mean);
+}
+
+BOOST_AUTO_TEST_CASE(MesoscopicSimulator_test_partitions_statistics)
+{
+    // the partitioned runs must not bias the mean number of "C"
+    // against the serial ones beyond five standard errors.
+    boost::shared_ptr<RandomNumberGenerator> rng(new GSLRandomNumberGenerator());
+    const Real t(0.02);
+    const Integer num_trials(200);
+    const std::pair<Real, Real> serial(
+        sample_bindings(rng, Integer3(1, 1, 1), 0.0, t, num_trials));
+    const std::pair<Real, Real> partitioned(
+        sample_bindings(rng, Integer3(2, 2, 1), 0.001, t, num_trials));
+
+    BOOST_CHECK(serial.first > 0);
+    const Real sigma(std::sqrt((serial.second + partitioned.second) / num_trials));
+    BOOST_CHECK(std::abs(serial.first - partitioned.first) < 5 * sigma);
+}
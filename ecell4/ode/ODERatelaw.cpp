@@ -42,6 +42,36 @@ Real ODERatelawMassAction::deriv_func(
     return flux;
 }
 
+void ODERatelawMassAction::jacobi_func(
+        state_container_type const &reactants_state_array,
+        Real const volume, ODEReactionRule const &rr,
+        state_container_type &retval) const
+{
+    ODEReactionRule::coefficient_container_type const reactants_coefficients(rr.reactants_coefficients());
+    for(state_container_type::size_type j(0); j < reactants_state_array.size(); j++)
+    {
+        Real deriv(this->k_ * volume);
+        for(state_container_type::size_type i(0); i < reactants_state_array.size(); i++)
+        {
+            const Real coef(reactants_coefficients[i]);
+            if (i != j)
+            {
+                deriv *= std::pow(reactants_state_array[i] / volume, coef);
+            }
+            else if (coef == 0.0)
+            {
+                deriv = 0.0;
+                break;
+            }
+            else
+            {
+                deriv *= coef * std::pow(reactants_state_array[i] / volume, coef - 1) / volume;
+            }
+        }
+        retval[j] = deriv;
+    }
+}
+
 Real ODERatelawCythonCallback::deriv_func(
     state_container_type const &reactants_state_array,
     state_container_type const &products_state_array, 
@@ -250,6 +250,15 @@ public:
         state_container_type const &products_state_array, 
         Real const volume, Real const t, ODEReactionRule const &rr);
 
+    /**
+     * the analytic partial derivatives of the flux by each reactant.
+     * retval must have the same size with reactants_state_array.
+     */
+    void jacobi_func(
+        state_container_type const &reactants_state_array,
+        Real const volume, ODEReactionRule const &rr,
+        state_container_type &retval) const;
+
     void set_k(Real k)
     {
         this->k_ = k;
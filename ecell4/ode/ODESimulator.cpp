@@ -2,6 +2,8 @@
 
 #include <boost/numeric/odeint.hpp>
 #include <algorithm>
+#include <limits>
+#include <cmath>
 
 namespace odeint = boost::numeric::odeint;
 
@@ -10,9 +12,20 @@ namespace ecell4
 
 namespace ode
 {
-std::pair<ODESimulator::deriv_func, ODESimulator::jacobi_func>
-ODESimulator::generate_system() const
+void ODESimulator::compile_system()
 {
+    {
+        const std::vector<Species> species(model_->list_species());
+        for(std::vector<Species>::const_iterator it = species.begin();
+                it != species.end(); it++)
+        {
+            if (!(world_->has_species(*it)))
+            {
+                world_->reserve_species(*it);
+            }
+        }
+    }
+
     const std::vector<Species> species(world_->list_species());
     const ODENetworkModel::ode_reaction_rule_container_type& ode_reaction_rules(model_->ode_reaction_rules());
     typedef utils::get_mapper_mf<
@@ -26,7 +39,8 @@ ODESimulator::generate_system() const
         index_map[*it] = i;
         i++;
     }
-    std::vector<reaction_type> reactions;
+    reaction_container_type& reactions(reactions_);
+    reactions.clear();
     reactions.reserve(ode_reaction_rules.size());
     for(ODENetworkModel::ode_reaction_rule_container_type::const_iterator
         i(ode_reaction_rules.begin()); i != ode_reaction_rules.end(); i++)
@@ -35,13 +49,21 @@ ODESimulator::generate_system() const
         const ODEReactionRule::product_container_type products(i->products());
         reaction_type r;
         r.raw = &(*i);
-        // r.k = i->k();
         r.reactants.reserve(reactants.size());
         r.products.reserve(products.size());
         if (i->has_ratelaw())
         {
             r.ratelaw = i->get_ratelaw();
         }
+        {
+            const boost::shared_ptr<ODERatelaw> ratelaw(r.ratelaw.lock());
+            const boost::shared_ptr<ODERatelawMassAction>
+                massaction(to_ODERatelawMassAction(ratelaw));
+            r.mass_action = (!ratelaw || !ratelaw->is_available()
+                || massaction.get() != NULL);
+            // the rate for the mass action in place of an expired ratelaw
+            r.k = (massaction ? massaction->get_k() : 0.0);
+        }
         for(ODEReactionRule::reactant_container_type::const_iterator j(reactants.begin());
             j != reactants.end(); j++)
         {
@@ -65,9 +87,415 @@ ODESimulator::generate_system() const
 
         reactions.push_back(r);
     }
-    return std::make_pair(
-            deriv_func(reactions, world_->volume()),
-            jacobi_func(reactions, world_->volume()));
+
+    species_ = species;
+    state_.resize(species.size());
+    compile_mass_action_kernel();
+    if (solver_type_ == SPARSE_ROSENBROCK4)
+    {
+        compile_jacobian();
+    }
+    compiled_ = true;
+}
+
+bool ODESimulator::is_compiled() const
+{
+    if (!compiled_ || world_->list_species() != species_)
+    {
+        return false;
+    }
+
+    // a rule is compiled with the pointer to it and its ratelaw.
+    const ODENetworkModel::ode_reaction_rule_container_type&
+        ode_reaction_rules(model_->ode_reaction_rules());
+    if (ode_reaction_rules.size() != reactions_.size())
+    {
+        return false;
+    }
+    for (reaction_container_type::size_type i(0); i < reactions_.size(); i++)
+    {
+        if (reactions_[i].raw != &(ode_reaction_rules[i])
+            || reactions_[i].ratelaw.lock() != ode_reaction_rules[i].get_ratelaw())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ODESimulator::compile_mass_action_kernel()
+{
+    mass_action_kernel_type& kernel(kernel_);
+    kernel.reactions.clear();
+    kernel.reactant_offsets.assign(1, 0);
+    kernel.reactant_indices.clear();
+    kernel.stoichiometry_offsets.assign(1, 0);
+    kernel.stoichiometry_indices.clear();
+    kernel.stoichiometry_coefficients.clear();
+    kernel.others.clear();
+
+    for(reaction_container_type::size_type i(0); i < reactions_.size(); i++)
+    {
+        const reaction_type& r(reactions_[i]);
+        bool compilable(to_ODERatelawMassAction(r.ratelaw.lock()).get() != NULL);
+        for(coefficient_container_type::const_iterator j(r.reactant_coefficients.begin());
+            compilable && j != r.reactant_coefficients.end(); j++)
+        {
+            compilable = (*j >= 0 && *j == std::floor(*j));
+        }
+        if (!compilable)
+        {
+            kernel.others.push_back(i);
+            continue;
+        }
+
+        kernel.reactions.push_back(i);
+        std::map<index_container_type::value_type, Real> stoichiometry;
+        for(std::size_t j(0); j < r.reactants.size(); j++)
+        {
+            const Real coef(r.reactant_coefficients[j]);
+            for(Integer n(0); n < static_cast<Integer>(coef); n++)
+            {
+                kernel.reactant_indices.push_back(r.reactants[j]);
+            }
+            stoichiometry[r.reactants[j]] -= coef;
+        }
+        for(std::size_t j(0); j < r.products.size(); j++)
+        {
+            stoichiometry[r.products[j]] += r.product_coefficients[j];
+        }
+        for(std::map<index_container_type::value_type, Real>::const_iterator
+            j(stoichiometry.begin()); j != stoichiometry.end(); j++)
+        {
+            if ((*j).second != 0)
+            {
+                kernel.stoichiometry_indices.push_back((*j).first);
+                kernel.stoichiometry_coefficients.push_back((*j).second);
+            }
+        }
+        kernel.reactant_offsets.push_back(kernel.reactant_indices.size());
+        kernel.stoichiometry_offsets.push_back(kernel.stoichiometry_indices.size());
+    }
+    kernel.rates.resize(kernel.reactions.size());
+}
+
+void ODESimulator::update_mass_action_rates()
+{
+    // flux = k V prod_i (x_i / V)^n_i = k V^(1 - sum_i n_i) prod_i x_i^n_i
+    const Real volume(world_->volume());
+    mass_action_kernel_type& kernel(kernel_);
+    for(std::size_t r(0); r < kernel.reactions.size(); r++)
+    {
+        const reaction_type& reaction(reactions_[kernel.reactions[r]]);
+        const boost::shared_ptr<ODERatelawMassAction> ratelaw(
+            to_ODERatelawMassAction(reaction.ratelaw.lock()));
+        // an expired ratelaw falls back to the mass action as in the jacobian
+        const Real k(ratelaw ? ratelaw->get_k() : reaction.k);
+        const Real order(kernel.reactant_offsets[r + 1] - kernel.reactant_offsets[r]);
+        kernel.rates[r] = k * std::pow(volume, 1 - order);
+    }
+}
+
+void ODESimulator::compile_jacobian()
+{
+    // a flux of mass action depends only on the reactants.
+    ODESparseMatrix::entry_container_type entries;
+    for(reaction_container_type::const_iterator i(reactions_.begin());
+        i != reactions_.end(); i++)
+    {
+        index_container_type columns(i->reactants);
+        if (!i->mass_action)
+        {
+            columns.insert(columns.end(), i->products.begin(), i->products.end());
+        }
+        for(index_container_type::const_iterator j(columns.begin());
+            j != columns.end(); j++)
+        {
+            for(index_container_type::const_iterator k(i->reactants.begin());
+                k != i->reactants.end(); k++)
+            {
+                entries.push_back(std::make_pair(*k, *j));
+            }
+            for(index_container_type::const_iterator k(i->products.begin());
+                k != i->products.end(); k++)
+            {
+                entries.push_back(std::make_pair(*k, *j));
+            }
+        }
+    }
+    jacobian_.build(state_.size(), entries);
+
+    ODESparseMatrix::entry_container_type::const_iterator it(entries.begin());
+    for(reaction_container_type::iterator i(reactions_.begin());
+        i != reactions_.end(); i++)
+    {
+        const std::size_t num_columns(
+            i->reactants.size() + (i->mass_action ? 0 : i->products.size()));
+        const std::size_t num_entries(
+            num_columns * (i->reactants.size() + i->products.size()));
+        i->jacobian_slots.clear();
+        i->jacobian_slots.reserve(num_entries);
+        for(std::size_t j(0); j < num_entries; ++j, ++it)
+        {
+            i->jacobian_slots.push_back(jacobian_.find((*it).first, (*it).second));
+        }
+    }
+
+    lu_.analyze(jacobian_);
+}
+
+void ODESimulator::evaluate_jacobian(
+    const state_type& x, const Real t, state_type& dfdt)
+{
+    std::fill(jacobian_.values().begin(), jacobian_.values().end(), 0.0);
+    std::fill(dfdt.begin(), dfdt.end(), 0.0);
+
+    const Real volume(world_->volume());
+    const Real h(1.0e-8);
+    const Real ht(1.0e-10);
+
+    ODERatelaw::state_container_type reactants_states, products_states, partials;
+    ODESparseMatrix::value_container_type& values(jacobian_.values());
+    for(reaction_container_type::const_iterator i(reactions_.begin());
+        i != reactions_.end(); i++)
+    {
+        reactants_states.resize(i->reactants.size());
+        for(std::size_t j(0); j < i->reactants.size(); j++)
+        {
+            reactants_states[j] = x[i->reactants[j]];
+        }
+        products_states.resize(i->products.size());
+        for(std::size_t j(0); j < i->products.size(); j++)
+        {
+            products_states[j] = x[i->products[j]];
+        }
+
+        Real flux_deriv_t(0.0);
+        if (i->mass_action)
+        {
+            // analytic, and independent of time
+            partials.resize(reactants_states.size());
+            const boost::shared_ptr<ODERatelawMassAction>
+                ratelaw(to_ODERatelawMassAction(i->ratelaw.lock()));
+            if (ratelaw)
+            {
+                ratelaw->jacobi_func(reactants_states, volume, *(i->raw), partials);
+            }
+            else
+            {
+                ODERatelawMassAction(i->k).jacobi_func(
+                    reactants_states, volume, *(i->raw), partials);
+            }
+        }
+        else
+        {
+            const boost::shared_ptr<ODERatelaw> ratelaw(i->ratelaw.lock());
+            if (!ratelaw)
+            {
+                throw IllegalState("A ratelaw was released.");
+            }
+            partials.resize(reactants_states.size() + products_states.size());
+            const Real flux_0(ratelaw->deriv_func(
+                reactants_states, products_states, volume, t, *(i->raw)));
+            flux_deriv_t = (ratelaw->deriv_func(
+                reactants_states, products_states, volume, t + ht, *(i->raw)) - flux_0) / ht;
+            for(std::size_t j(0); j < reactants_states.size(); j++)
+            {
+                ODERatelaw::state_container_type h_shift(reactants_states);
+                h_shift[j] += h;
+                partials[j] = (ratelaw->deriv_func(
+                    h_shift, products_states, volume, t, *(i->raw)) - flux_0) / h;
+            }
+            for(std::size_t j(0); j < products_states.size(); j++)
+            {
+                ODERatelaw::state_container_type h_shift(products_states);
+                h_shift[j] += h;
+                partials[reactants_states.size() + j] = (ratelaw->deriv_func(
+                    reactants_states, h_shift, volume, t, *(i->raw)) - flux_0) / h;
+            }
+        }
+
+        index_container_type::const_iterator slot(i->jacobian_slots.begin());
+        for(std::size_t j(0); j < partials.size(); j++)
+        {
+            const Real flux_deriv(partials[j]);
+            for(std::size_t k(0); k < i->reactants.size(); k++, slot++)
+            {
+                values[*slot] -= i->reactant_coefficients[k] * flux_deriv;
+            }
+            for(std::size_t k(0); k < i->products.size(); k++, slot++)
+            {
+                values[*slot] += i->product_coefficients[k] * flux_deriv;
+            }
+        }
+
+        if (flux_deriv_t != 0.0)
+        {
+            for(std::size_t k(0); k < i->reactants.size(); k++)
+            {
+                dfdt[i->reactants[k]] -= i->reactant_coefficients[k] * flux_deriv_t;
+            }
+            for(std::size_t k(0); k < i->products.size(); k++)
+            {
+                dfdt[i->products[k]] += i->product_coefficients[k] * flux_deriv_t;
+            }
+        }
+    }
+}
+
+/**
+ * the same stages and step size control with odeint::rosenbrock4 and
+ * odeint::rosenbrock4_controller, but with the sparse jacobian and LU.
+ */
+void ODESimulator::integrate_sparse_rosenbrock4(
+    state_type& x, Real t, const Real tend, Real dt)
+{
+    const odeint::default_rosenbrock_coefficients<double> coef;
+    const Real safe(0.9), fac1(5.0), fac2(1.0 / 6.0);
+
+    deriv_func deriv(reactions_, kernel_, world_->volume());
+    const std::size_t n(x.size());
+    state_type dxdt(n), dfdt(n), dxdtnew(n), xtmp(n), xerr(n);
+    state_type g1(n), g2(n), g3(n), g4(n), g5(n);
+
+    bool first_step(true), last_rejected(false), evaluated(false);
+    Real dt_old(0.0), err_old(0.0);
+    while (t < tend)
+    {
+        if (t + dt > tend)
+        {
+            dt = tend - t;
+        }
+
+        if (!evaluated)
+        {
+            deriv(x, dxdt, t);
+            evaluate_jacobian(x, t, dfdt);
+            evaluated = true;
+        }
+
+        if (!lu_.factorize(1.0 / (coef.gamma * dt), jacobian_))
+        {
+            dt *= 0.5;
+            last_rejected = true;
+            if (dt < std::numeric_limits<Real>::epsilon() * std::max(std::abs(t), 1.0))
+            {
+                throw IllegalState("The step size underflowed.");
+            }
+            continue;
+        }
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            g1[i] = dxdt[i] + dt * coef.d1 * dfdt[i];
+        }
+        lu_.solve(g1);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp[i] = x[i] + coef.a21 * g1[i];
+        }
+        deriv(xtmp, dxdtnew, t + coef.c2 * dt);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            g2[i] = dxdtnew[i] + dt * coef.d2 * dfdt[i] + coef.c21 * g1[i] / dt;
+        }
+        lu_.solve(g2);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp[i] = x[i] + coef.a31 * g1[i] + coef.a32 * g2[i];
+        }
+        deriv(xtmp, dxdtnew, t + coef.c3 * dt);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            g3[i] = dxdtnew[i] + dt * coef.d3 * dfdt[i]
+                + (coef.c31 * g1[i] + coef.c32 * g2[i]) / dt;
+        }
+        lu_.solve(g3);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp[i] = x[i] + coef.a41 * g1[i] + coef.a42 * g2[i] + coef.a43 * g3[i];
+        }
+        deriv(xtmp, dxdtnew, t + coef.c4 * dt);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            g4[i] = dxdtnew[i] + dt * coef.d4 * dfdt[i]
+                + (coef.c41 * g1[i] + coef.c42 * g2[i] + coef.c43 * g3[i]) / dt;
+        }
+        lu_.solve(g4);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp[i] = x[i] + coef.a51 * g1[i] + coef.a52 * g2[i]
+                + coef.a53 * g3[i] + coef.a54 * g4[i];
+        }
+        deriv(xtmp, dxdtnew, t + dt);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            g5[i] = dxdtnew[i] + (coef.c51 * g1[i] + coef.c52 * g2[i]
+                + coef.c53 * g3[i] + coef.c54 * g4[i]) / dt;
+        }
+        lu_.solve(g5);
+
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp[i] += g5[i];
+        }
+        deriv(xtmp, dxdtnew, t + dt);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xerr[i] = dxdtnew[i] + (coef.c61 * g1[i] + coef.c62 * g2[i]
+                + coef.c63 * g3[i] + coef.c64 * g4[i] + coef.c65 * g5[i]) / dt;
+        }
+        lu_.solve(xerr);
+
+        Real err(0.0);
+        for (std::size_t i(0); i < n; ++i)
+        {
+            xtmp[i] += xerr[i];  // xtmp is the new state
+            const Real sk(abs_tol_ + rel_tol_ * std::max(std::abs(x[i]), std::abs(xtmp[i])));
+            err += xerr[i] * xerr[i] / sk / sk;
+        }
+        err = (n > 0 ? std::sqrt(err / n) : 0.0);
+
+        Real fac(std::max(fac2, std::min(fac1, std::pow(err, 0.25) / safe)));
+        if (!(err <= 1.0))
+        {
+            dt /= fac;
+            last_rejected = true;
+            if (dt < std::numeric_limits<Real>::epsilon() * std::max(std::abs(t), 1.0))
+            {
+                throw IllegalState("The step size underflowed.");
+            }
+            continue;
+        }
+
+        if (first_step)
+        {
+            first_step = false;
+        }
+        else
+        {
+            const Real fac_pred(std::max(fac2, std::min(fac1,
+                (dt_old / dt) * std::pow(err * err / err_old, 0.25) / safe)));
+            fac = std::max(fac, fac_pred);
+        }
+        Real dt_new(dt / fac);
+        if (last_rejected)
+        {
+            dt_new = std::min(dt_new, dt);
+        }
+        dt_old = dt;
+        err_old = std::max(0.01, err);
+
+        x.swap(xtmp);
+        t += dt;
+        dt = dt_new;
+        last_rejected = false;
+        evaluated = false;
+    }
 }
 
 bool ODESimulator::step(const Real &upto)
@@ -80,51 +508,49 @@ bool ODESimulator::step(const Real &upto)
 
     const Real ntime(std::min(upto, t() + dt_));
 
-    //initialize();
-    const std::vector<Species> species(world_->list_species());
+    if (!is_compiled())
+    {
+        compile_system();
+    }
 
-    state_type x(species.size());
-    state_type::size_type i(0);
-    for(ODENetworkModel::species_container_type::const_iterator it(species.begin());
-        it != species.end(); it++)
+    state_type& x(state_);
+    for (state_type::size_type i(0); i < x.size(); ++i)
     {
-        x[i] = static_cast<double>(world_->get_value_exact(*it));
-        i++;
+        x[i] = static_cast<double>(world_->get_value_by_index(i));
     }
-    std::pair<deriv_func, jacobi_func> system(generate_system());
-    StateAndTimeBackInserter::state_container_type x_vec;
-    StateAndTimeBackInserter::time_container_type times;
 
-    size_t steps;
+    update_mass_action_rates();
+    std::pair<deriv_func, jacobi_func> system(
+        deriv_func(reactions_, kernel_, world_->volume()),
+        jacobi_func(reactions_, world_->volume()));
+
+    // x is updated in place to the state at ntime.
     switch (this->solver_type_) {
         case ecell4::ode::RUNGE_KUTTA_CASH_KARP54:
             {
                 /* This solver doesn't need the jacobian */
                 typedef odeint::runge_kutta_cash_karp54<state_type> error_stepper_type;
-                steps = (
-                    odeint::integrate_adaptive(
-                        odeint::make_controlled<error_stepper_type>(abs_tol_, rel_tol_),
-                        system.first, x, t(), ntime, dt,
-                        StateAndTimeBackInserter(x_vec, times)));
+                odeint::integrate_adaptive(
+                    odeint::make_controlled<error_stepper_type>(abs_tol_, rel_tol_),
+                    system.first, x, t(), ntime, dt);
             }
             break;
         case ecell4::ode::ROSENBROCK4_CONTROLLER:
             {
                 typedef odeint::rosenbrock4<state_type::value_type> error_stepper_type;
-                steps = (
-                    odeint::integrate_adaptive(
-                        odeint::make_controlled<error_stepper_type>(abs_tol_, rel_tol_),
-                        system, x, t(), ntime, dt,
-                        StateAndTimeBackInserter(x_vec, times)));
+                odeint::integrate_adaptive(
+                    odeint::make_controlled<error_stepper_type>(abs_tol_, rel_tol_),
+                    system, x, t(), ntime, dt);
             }
             break;
+        case ecell4::ode::SPARSE_ROSENBROCK4:
+            integrate_sparse_rosenbrock4(x, t(), ntime, dt);
+            break;
         case ecell4::ode::EULER:
             {
                 typedef odeint::euler<state_type> stepper_type;
-                steps = (
-                    odeint::integrate_const(
-                        stepper_type(), system.first, x, t(), ntime, dt,
-                        StateAndTimeBackInserter(x_vec, times)));
+                odeint::integrate_const(
+                    stepper_type(), system.first, x, t(), ntime, dt);
             }
             break;
         default:
@@ -136,14 +562,9 @@ bool ODESimulator::step(const Real &upto)
     //     odeint::integrate_adaptive(
     //         controlled_stepper, system, x, t(), upto, dt_,
     //         StateAndTimeBackInserter(x_vec, times)));
+    for (state_type::size_type i(0); i < x.size(); ++i)
     {
-        state_type::size_type i(0);
-        for(ODENetworkModel::species_container_type::const_iterator
-            it(species.begin()); it != species.end(); it++)
-        {
-            world_->set_value(*it, static_cast<Real>(x_vec[steps](i)));
-            i++;
-        }
+        world_->set_value_by_index(i, static_cast<Real>(x[i]));
     }
     set_t(ntime);
     num_steps_++;
@@ -21,6 +21,7 @@
 #include "ODEWorld.hpp"
 #include "ODEReactionRule.hpp"
 #include "ODENetworkModel.hpp"
+#include "ODESparseLU.hpp"
 
 namespace ecell4
 {
@@ -31,6 +32,7 @@ enum ODESolverType {
     RUNGE_KUTTA_CASH_KARP54 = 0,
     ROSENBROCK4_CONTROLLER = 1,
     EULER = 2,
+    SPARSE_ROSENBROCK4 = 3,
 };
 
 class ODESimulator
@@ -58,14 +60,50 @@ public:
         Real k;
         boost::weak_ptr<ODERatelaw> ratelaw;
         const ODEReactionRule *raw;
+
+        /**
+         * for SPARSE_ROSENBROCK4. the positions in the sparse jacobian,
+         * for each column (reactants, and products unless the ratelaw is
+         * mass action) and for each row (reactants, and then products).
+         */
+        bool mass_action;
+        index_container_type jacobian_slots;
     };
     typedef std::vector<reaction_type> reaction_container_type;
 
+    /**
+     * the mass-action reactions with integer reactant coefficients,
+     * compiled into flat CSR arrays. the flux of the r-th reaction is
+     * rates[r] times the product of x[reactant_indices[q]] for q in
+     * [reactant_offsets[r], reactant_offsets[r + 1]), where a reactant with
+     * the coefficient n appears n times. the net stoichiometry is stored
+     * in the same way. the other reactions are listed in others.
+     */
+    struct mass_action_kernel_type
+    {
+        index_container_type reactions;
+        coefficient_container_type rates;
+        index_container_type reactant_offsets;
+        index_container_type reactant_indices;
+        index_container_type stoichiometry_offsets;
+        index_container_type stoichiometry_indices;
+        coefficient_container_type stoichiometry_coefficients;
+        index_container_type others;
+    };
+
     class deriv_func
     {
     public:
         deriv_func(const reaction_container_type &reactions, const Real &volume)
-            : reactions_(reactions), volume_(volume), vinv_(1.0 / volume)
+            : reactions_(reactions), volume_(volume), vinv_(1.0 / volume), kernel_(NULL)
+        {
+            ;
+        }
+
+        deriv_func(
+            const reaction_container_type &reactions,
+            const mass_action_kernel_type &kernel, const Real &volume)
+            : reactions_(reactions), volume_(volume), vinv_(1.0 / volume), kernel_(&kernel)
         {
             ;
         }
@@ -73,58 +111,94 @@ public:
         void operator()(const state_type &x, state_type &dxdt, const double &t)
         {
             std::fill(dxdt.begin(), dxdt.end(), 0.0);
-            for(reaction_container_type::const_iterator i(reactions_.begin());
-                i != reactions_.end(); i++)
+            if (kernel_ == NULL)
             {
-                ODERatelaw::state_container_type reactants_states(i->reactants.size());
-                ODERatelaw::state_container_type products_states(i->products.size());
-                ODERatelaw::state_container_type::size_type cnt(0);
-
-                for(index_container_type::const_iterator j(i->reactants.begin());
-                    j != i->reactants.end(); j++, cnt++)
+                for(reaction_container_type::const_iterator i(reactions_.begin());
+                    i != reactions_.end(); i++)
                 {
-                    reactants_states[cnt] = x[*j];
+                    add_flux(*i, x, dxdt, t);
                 }
-                cnt = 0;
-                for(index_container_type::const_iterator j(i->products.begin());
-                    j != i->products.end(); j++, cnt++)
-                {
-                    products_states[cnt] = x[*j];
-                }
-                double flux;
-                // Calculation! XXX
-                if (i->ratelaw.expired() || i->ratelaw.lock()->is_available() == false)
-                {
-                    boost::scoped_ptr<ODERatelaw> temporary_ratelaw_obj(new ODERatelawMassAction(i->k));
-                    flux = temporary_ratelaw_obj->deriv_func(reactants_states, products_states, volume_, t, *(i->raw) );
-                }
-                else
-                {
-                    boost::shared_ptr<ODERatelaw> ratelaw = i->ratelaw.lock();
-                    flux = ratelaw->deriv_func(reactants_states, products_states, volume_, t, *(i->raw) );
-                }
-                // Merge each reaction's flux into whole dxdt
-                std::size_t nth = 0;
-                for(index_container_type::const_iterator j(i->reactants.begin());
-                    j != i->reactants.end(); j++)
+                return;
+            }
+
+            const mass_action_kernel_type& kernel(*kernel_);
+            const std::size_t num_reactions(kernel.rates.size());
+            for(std::size_t r(0); r < num_reactions; ++r)
+            {
+                double flux(kernel.rates[r]);
+                for(std::size_t q(kernel.reactant_offsets[r]);
+                    q < kernel.reactant_offsets[r + 1]; ++q)
                 {
-                    dxdt[*j] -= (flux * (double)i->reactant_coefficients[nth]);
-                    nth++;
+                    flux *= x[kernel.reactant_indices[q]];
                 }
-                nth = 0;
-                for(index_container_type::const_iterator j(i->products.begin()); 
-                    j != i->products.end(); j++)
+                for(std::size_t q(kernel.stoichiometry_offsets[r]);
+                    q < kernel.stoichiometry_offsets[r + 1]; ++q)
                 {
-                    dxdt[*j] += (flux * (double)i->product_coefficients[nth]);
-                    nth++;
+                    dxdt[kernel.stoichiometry_indices[q]]
+                        += kernel.stoichiometry_coefficients[q] * flux;
                 }
             }
-            return;
+            for(index_container_type::const_iterator i(kernel.others.begin());
+                i != kernel.others.end(); i++)
+            {
+                add_flux(reactions_[*i], x, dxdt, t);
+            }
+        }
+
+    protected:
+
+        void add_flux(
+            const reaction_type& r, const state_type &x, state_type &dxdt, const double &t)
+        {
+            ODERatelaw::state_container_type reactants_states(r.reactants.size());
+            ODERatelaw::state_container_type products_states(r.products.size());
+            ODERatelaw::state_container_type::size_type cnt(0);
+
+            for(index_container_type::const_iterator j(r.reactants.begin());
+                j != r.reactants.end(); j++, cnt++)
+            {
+                reactants_states[cnt] = x[*j];
+            }
+            cnt = 0;
+            for(index_container_type::const_iterator j(r.products.begin());
+                j != r.products.end(); j++, cnt++)
+            {
+                products_states[cnt] = x[*j];
+            }
+            double flux;
+            // Calculation! XXX
+            if (r.ratelaw.expired() || r.ratelaw.lock()->is_available() == false)
+            {
+                boost::scoped_ptr<ODERatelaw> temporary_ratelaw_obj(new ODERatelawMassAction(r.k));
+                flux = temporary_ratelaw_obj->deriv_func(reactants_states, products_states, volume_, t, *(r.raw) );
+            }
+            else
+            {
+                boost::shared_ptr<ODERatelaw> ratelaw = r.ratelaw.lock();
+                flux = ratelaw->deriv_func(reactants_states, products_states, volume_, t, *(r.raw) );
+            }
+            // Merge each reaction's flux into whole dxdt
+            std::size_t nth = 0;
+            for(index_container_type::const_iterator j(r.reactants.begin());
+                j != r.reactants.end(); j++)
+            {
+                dxdt[*j] -= (flux * (double)r.reactant_coefficients[nth]);
+                nth++;
+            }
+            nth = 0;
+            for(index_container_type::const_iterator j(r.products.begin()); 
+                j != r.products.end(); j++)
+            {
+                dxdt[*j] += (flux * (double)r.product_coefficients[nth]);
+                nth++;
+            }
         }
+
     protected:
-        const reaction_container_type reactions_;
+        const reaction_container_type& reactions_;
         const Real volume_;
         const Real vinv_;
+        const mass_action_kernel_type* kernel_;
     };
 
     class jacobi_func
@@ -305,7 +379,7 @@ public:
             }
         }
     protected:
-        const reaction_container_type reactions_;
+        const reaction_container_type& reactions_;
         const Real volume_;
         const Real vinv_;
     };
@@ -337,7 +411,7 @@ public:
         const boost::shared_ptr<ODEWorld>& world,
         const ODESolverType solver_type = ROSENBROCK4_CONTROLLER)
         : base_type(model, world), dt_(inf), abs_tol_(1e-6), rel_tol_(1e-6),
-          solver_type_(solver_type)
+          solver_type_(solver_type), compiled_(false)
     {
         initialize();
     }
@@ -346,7 +420,7 @@ public:
         const boost::shared_ptr<ODEWorld>& world,
         const ODESolverType solver_type = ROSENBROCK4_CONTROLLER)
         : base_type(world), dt_(inf), abs_tol_(1e-6), rel_tol_(1e-6),
-          solver_type_(solver_type)
+          solver_type_(solver_type), compiled_(false)
     {
         initialize();
     }
@@ -356,22 +430,20 @@ public:
         const boost::shared_ptr<ODEWorld>& world,
         const ODESolverType solver_type = ROSENBROCK4_CONTROLLER)
         : base_type(boost::shared_ptr<ODENetworkModel>(new ODENetworkModel(model)), world),
-          dt_(inf), abs_tol_(1e-6), rel_tol_(1e-6), solver_type_(solver_type)
+          dt_(inf), abs_tol_(1e-6), rel_tol_(1e-6), solver_type_(solver_type),
+          compiled_(false)
     {
         initialize();
     }
 
+    /**
+     * reserve species and compile the system. the system is compiled
+     * again when the species in the world, the reaction rules, or their
+     * ratelaws are changed.
+     */
     void initialize()
     {
-        const std::vector<Species> species(model_->list_species());
-        for(std::vector<Species>::const_iterator it = species.begin();
-                it != species.end(); it++)
-        {
-            if (!(world_->has_species(*it)))
-            {
-                world_->reserve_species(*it);
-            }
-        }
+        compile_system();
     }
 
     void step(void)
@@ -380,6 +452,7 @@ public:
         if ( this->model_->has_network_model() )
         {
             this->model_->update_model();
+            compiled_ = false;  // the reaction rules were regenerated.
         }
     }
     bool step(const Real &upto);
@@ -445,7 +518,16 @@ public:
     }
 
 protected:
-    std::pair<deriv_func, jacobi_func> generate_system() const;
+    void compile_system();
+    void compile_jacobian();
+    void compile_mass_action_kernel();
+    void update_mass_action_rates();
+    void evaluate_jacobian(const state_type& x, const Real t, state_type& dfdt);
+    void integrate_sparse_rosenbrock4(
+        state_type& x, Real t, const Real tend, Real dt);
+
+    bool is_compiled() const;
+
 protected:
     // boost::shared_ptr<ODENetworkModel> model_;
     // boost::shared_ptr<ODEWorld> world_;
@@ -453,6 +535,23 @@ protected:
     // Integer num_steps_;
     Real abs_tol_, rel_tol_;
     ODESolverType solver_type_;
+
+    /**
+     * the compiled system, and the state in the order of the species
+     * in the world.
+     */
+    bool compiled_;
+    std::vector<Species> species_;
+    reaction_container_type reactions_;
+    state_type state_;
+
+    /**
+     * the sparse jacobian and its factorization for SPARSE_ROSENBROCK4.
+     */
+    ODESparseMatrix jacobian_;
+    ODESparseLU lu_;
+
+    mass_action_kernel_type kernel_;
 };
 
 } // ode
@@ -0,0 +1,243 @@
+#include "ODESparseLU.hpp"
+
+#include <set>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <ecell4/core/exceptions.hpp>
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+void ODESparseMatrix::build(const size_type size, const entry_container_type& entries)
+{
+    // sort by (column, row)
+    std::vector<std::pair<size_type, size_type> > sorted;
+    sorted.reserve(entries.size());
+    for (entry_container_type::const_iterator i(entries.begin());
+        i != entries.end(); ++i)
+    {
+        if ((*i).first >= size || (*i).second >= size)
+        {
+            throw IllegalArgument("An entry is out of range.");
+        }
+        sorted.push_back(std::make_pair((*i).second, (*i).first));
+    }
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+    size_ = size;
+    colptr_.assign(size + 1, 0);
+    rowidx_.resize(sorted.size());
+    values_.assign(sorted.size(), 0.0);
+    for (size_type q(0); q < sorted.size(); ++q)
+    {
+        rowidx_[q] = sorted[q].second;
+        ++colptr_[sorted[q].first + 1];
+    }
+    for (size_type j(0); j < size; ++j)
+    {
+        colptr_[j + 1] += colptr_[j];
+    }
+}
+
+ODESparseMatrix::size_type ODESparseMatrix::find(
+    const size_type row, const size_type col) const
+{
+    const index_container_type::const_iterator
+        first(rowidx_.begin() + colptr_[col]), last(rowidx_.begin() + colptr_[col + 1]);
+    const index_container_type::const_iterator it(std::lower_bound(first, last, row));
+    if (it == last || *it != row)
+    {
+        return num_nonzeros();
+    }
+    return static_cast<size_type>(it - rowidx_.begin());
+}
+
+void ODESparseLU::order_minimum_degree(const ODESparseMatrix& A)
+{
+    typedef std::set<size_type> adjacency_type;
+    typedef std::set<std::pair<size_type, size_type> > queue_type;
+
+    // the graph of A + A^T without the diagonal
+    std::vector<adjacency_type> graph(size_);
+    for (size_type j(0); j < size_; ++j)
+    {
+        for (size_type q(A.colptr()[j]); q < A.colptr()[j + 1]; ++q)
+        {
+            const size_type i(A.rowidx()[q]);
+            if (i != j)
+            {
+                graph[i].insert(j);
+                graph[j].insert(i);
+            }
+        }
+    }
+
+    queue_type queue;
+    for (size_type i(0); i < size_; ++i)
+    {
+        queue.insert(std::make_pair(graph[i].size(), i));
+    }
+
+    permutation_.clear();
+    permutation_.reserve(size_);
+    while (!queue.empty())
+    {
+        const size_type v((*queue.begin()).second);
+        queue.erase(queue.begin());
+        permutation_.push_back(v);
+
+        // eliminating v makes its neighbors a clique.
+        adjacency_type neighbors;
+        neighbors.swap(graph[v]);
+        for (adjacency_type::const_iterator i(neighbors.begin());
+            i != neighbors.end(); ++i)
+        {
+            adjacency_type& adj(graph[*i]);
+            queue.erase(std::make_pair(adj.size(), *i));
+            adj.erase(v);
+            for (adjacency_type::const_iterator j(neighbors.begin());
+                j != neighbors.end(); ++j)
+            {
+                if (*j != *i)
+                {
+                    adj.insert(*j);
+                }
+            }
+            queue.insert(std::make_pair(adj.size(), *i));
+        }
+    }
+}
+
+void ODESparseLU::analyze(const ODESparseMatrix& A)
+{
+    size_ = A.size();
+    order_minimum_degree(A);
+
+    index_container_type inverse(size_);
+    for (size_type i(0); i < size_; ++i)
+    {
+        inverse[permutation_[i]] = i;
+    }
+
+    // the left-looking symbolic factorization. the pattern of the j-th
+    // column is the one of (P A P^T)(:, j) and the diagonal, closed under
+    // the columns of L on the left.
+    colptr_.assign(1, 0);
+    rowidx_.clear();
+    diagonal_.resize(size_);
+    for (size_type j(0); j < size_; ++j)
+    {
+        std::set<size_type> pattern;
+        pattern.insert(j);
+        const size_type col(permutation_[j]);
+        for (size_type q(A.colptr()[col]); q < A.colptr()[col + 1]; ++q)
+        {
+            pattern.insert(inverse[A.rowidx()[q]]);
+        }
+
+        for (std::set<size_type>::const_iterator i(pattern.begin());
+            i != pattern.end() && *i < j; ++i)
+        {
+            // the inserted rows are larger than *i, and visited later.
+            for (size_type q(diagonal_[*i] + 1); q < colptr_[*i + 1]; ++q)
+            {
+                pattern.insert(rowidx_[q]);
+            }
+        }
+
+        for (std::set<size_type>::const_iterator i(pattern.begin());
+            i != pattern.end(); ++i)
+        {
+            if (*i == j)
+            {
+                diagonal_[j] = rowidx_.size();
+            }
+            rowidx_.push_back(*i);
+        }
+        colptr_.push_back(rowidx_.size());
+    }
+
+    values_.assign(rowidx_.size(), 0.0);
+    work_.assign(size_, 0.0);
+
+    value_map_.resize(A.num_nonzeros());
+    for (size_type j(0); j < size_; ++j)
+    {
+        const size_type col(inverse[j]);
+        for (size_type q(A.colptr()[j]); q < A.colptr()[j + 1]; ++q)
+        {
+            const size_type row(inverse[A.rowidx()[q]]);
+            value_map_[q] = static_cast<size_type>(
+                std::lower_bound(
+                    rowidx_.begin() + colptr_[col],
+                    rowidx_.begin() + colptr_[col + 1], row) - rowidx_.begin());
+        }
+    }
+}
+
+bool ODESparseLU::factorize(const double shift, const ODESparseMatrix& A)
+{
+    if (A.size() != size_ || A.num_nonzeros() != value_map_.size())
+    {
+        throw IllegalState("The pattern has not been analyzed.");
+    }
+
+    std::fill(values_.begin(), values_.end(), 0.0);
+    for (size_type j(0); j < size_; ++j)
+    {
+        values_[diagonal_[j]] = shift;
+    }
+    for (size_type p(0); p < value_map_.size(); ++p)
+    {
+        values_[value_map_[p]] -= A.values()[p];
+    }
+
+    for (size_type j(0); j < size_; ++j)
+    {
+        for (size_type q(colptr_[j]); q < colptr_[j + 1]; ++q)
+        {
+            work_[rowidx_[q]] = values_[q];
+        }
+
+        // U(k, j) is final when visited, because the rows are ascending.
+        for (size_type q(colptr_[j]); q < diagonal_[j]; ++q)
+        {
+            const size_type k(rowidx_[q]);
+            const double ukj(work_[k]);
+            if (ukj == 0.0)
+            {
+                continue;
+            }
+            for (size_type r(diagonal_[k] + 1); r < colptr_[k + 1]; ++r)
+            {
+                work_[rowidx_[r]] -= values_[r] * ukj;
+            }
+        }
+
+        const double pivot(work_[j]);
+        if (!(std::abs(pivot) > std::numeric_limits<double>::min())
+            || !(std::abs(pivot) < std::numeric_limits<double>::infinity()))
+        {
+            return false;
+        }
+
+        for (size_type q(colptr_[j]); q <= diagonal_[j]; ++q)
+        {
+            values_[q] = work_[rowidx_[q]];
+        }
+        for (size_type q(diagonal_[j] + 1); q < colptr_[j + 1]; ++q)
+        {
+            values_[q] = work_[rowidx_[q]] / pivot;
+        }
+    }
+    return true;
+}
+
+} // ode
+
+} // ecell4
@@ -0,0 +1,222 @@
+#ifndef ECELL4_ODE_ODE_SPARSE_LU_HPP
+#define ECELL4_ODE_ODE_SPARSE_LU_HPP
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+namespace ecell4
+{
+
+namespace ode
+{
+
+/**
+ * a square matrix in the compressed sparse column (CSC) format.
+ * the pattern is fixed when built, and only the values are updated.
+ */
+class ODESparseMatrix
+{
+public:
+
+    typedef std::size_t size_type;
+    typedef std::vector<size_type> index_container_type;
+    typedef std::vector<double> value_container_type;
+    typedef std::vector<std::pair<size_type, size_type> > entry_container_type;
+
+public:
+
+    ODESparseMatrix()
+        : size_(0)
+    {
+        ;
+    }
+
+    /**
+     * build the pattern from a list of (row, column) pairs.
+     * duplicated pairs are merged.
+     */
+    void build(const size_type size, const entry_container_type& entries);
+
+    /**
+     * return the position of the entry (row, col) in values(),
+     * or num_nonzeros() if the entry is not in the pattern.
+     */
+    size_type find(const size_type row, const size_type col) const;
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    size_type num_nonzeros() const
+    {
+        return rowidx_.size();
+    }
+
+    const index_container_type& colptr() const
+    {
+        return colptr_;
+    }
+
+    const index_container_type& rowidx() const
+    {
+        return rowidx_;
+    }
+
+    const value_container_type& values() const
+    {
+        return values_;
+    }
+
+    value_container_type& values()
+    {
+        return values_;
+    }
+
+protected:
+
+    size_type size_;
+    index_container_type colptr_;
+    index_container_type rowidx_;
+    value_container_type values_;
+};
+
+/**
+ * a sparse LU factorization of (shift * I - A) for a matrix A with
+ * a fixed pattern, as needed by Rosenbrock and BDF steppers.
+ * the rows and columns are symmetrically reordered by the minimum degree
+ * heuristic, and the fill-in is computed once in analyze().
+ * no numerical pivoting is done (the pattern is static). factorize()
+ * fails instead on a vanishing pivot, and the caller is expected to
+ * retry with a larger shift, i.e. a smaller step size.
+ */
+class ODESparseLU
+{
+public:
+
+    typedef ODESparseMatrix::size_type size_type;
+    typedef ODESparseMatrix::index_container_type index_container_type;
+    typedef ODESparseMatrix::value_container_type value_container_type;
+
+public:
+
+    ODESparseLU()
+        : size_(0)
+    {
+        ;
+    }
+
+    /**
+     * compute the ordering and the symbolic factorization for the pattern
+     * of the given matrix.
+     */
+    void analyze(const ODESparseMatrix& A);
+
+    /**
+     * factorize (shift * I - A) numerically. A must have the pattern given
+     * to analyze().
+     * @return false if a pivot vanished.
+     */
+    bool factorize(const double shift, const ODESparseMatrix& A);
+
+    /**
+     * solve (shift * I - A) x = b in place.
+     */
+    template <typename Tvector_>
+    void solve(Tvector_& b)
+    {
+        for (size_type i(0); i < size_; ++i)
+        {
+            work_[i] = b[permutation_[i]];
+        }
+
+        // L is unit lower triangular.
+        for (size_type j(0); j < size_; ++j)
+        {
+            const double yj(work_[j]);
+            if (yj == 0.0)
+            {
+                continue;
+            }
+            for (size_type q(diagonal_[j] + 1); q < colptr_[j + 1]; ++q)
+            {
+                work_[rowidx_[q]] -= values_[q] * yj;
+            }
+        }
+
+        for (size_type j(size_); j > 0; --j)
+        {
+            const size_type col(j - 1);
+            work_[col] /= values_[diagonal_[col]];
+            const double yj(work_[col]);
+            if (yj == 0.0)
+            {
+                continue;
+            }
+            for (size_type q(colptr_[col]); q < diagonal_[col]; ++q)
+            {
+                work_[rowidx_[q]] -= values_[q] * yj;
+            }
+        }
+
+        for (size_type i(0); i < size_; ++i)
+        {
+            b[permutation_[i]] = work_[i];
+        }
+    }
+
+    size_type size() const
+    {
+        return size_;
+    }
+
+    /**
+     * the number of nonzeros in L and U, including the fill-in.
+     */
+    size_type num_nonzeros() const
+    {
+        return rowidx_.size();
+    }
+
+    const index_container_type& permutation() const
+    {
+        return permutation_;
+    }
+
+protected:
+
+    void order_minimum_degree(const ODESparseMatrix& A);
+
+protected:
+
+    size_type size_;
+
+    /**
+     * permutation_[i] is the original index of the i-th row and column.
+     */
+    index_container_type permutation_;
+
+    /**
+     * the factors in CSC: for each column, the rows of U (above the
+     * diagonal), the diagonal, and then the rows of L (below the diagonal),
+     * in the ascending order.
+     */
+    index_container_type colptr_;
+    index_container_type rowidx_;
+    index_container_type diagonal_;
+    value_container_type values_;
+
+    /**
+     * value_map_[p] is the position in values_ of the p-th value of A.
+     */
+    index_container_type value_map_;
+
+    value_container_type work_;
+};
+
+} // ode
+
+} // ecell4
+
+#endif /* ECELL4_ODE_ODE_SPARSE_LU_HPP */
@@ -145,6 +145,25 @@ public:
         return species_;
     }
 
+    Integer num_species() const
+    {
+        return species_.size();
+    }
+
+    /**
+     * accessors with the index of a species in list_species(),
+     * which is valid until any species is released.
+     */
+    Real get_value_by_index(const Integer& idx) const
+    {
+        return num_molecules_[idx];
+    }
+
+    void set_value_by_index(const Integer& idx, const Real& value)
+    {
+        num_molecules_[idx] = value;
+    }
+
     // CompartmentSpace member functions
 
     void add_molecules(const Species& sp, const Real& num)
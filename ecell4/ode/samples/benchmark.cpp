@@ -0,0 +1,93 @@
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <sys/time.h>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/ode/ODESimulator.hpp>
+
+using namespace ecell4;
+using namespace ecell4::ode;
+
+/**
+ * a ring of num_species species connected by slow conversions,
+ * A0 -> A1 -> ... -> A(n-1) -> A0, with fast and stiff binding
+ * equilibria Ai + A(i+1) <-> Bi.
+ */
+boost::shared_ptr<NetworkModel> generate_ring_model(const Integer num_species)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    std::vector<Species> species;
+    for (Integer i(0); i < num_species; ++i)
+    {
+        std::ostringstream oss;
+        oss << "A" << i;
+        species.push_back(Species(oss.str()));
+    }
+
+    for (Integer i(0); i < num_species; ++i)
+    {
+        std::ostringstream oss;
+        oss << "B" << i;
+        const Species sp(oss.str());
+        const Species& sp1(species[i]);
+        const Species& sp2(species[(i + 1) % num_species]);
+        model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+        model->add_reaction_rule(create_binding_reaction_rule(sp1, sp2, sp, 1e+4));
+        model->add_reaction_rule(create_unbinding_reaction_rule(sp, sp1, sp2, 1e+4));
+    }
+    return model;
+}
+
+double walltime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+Real measure(
+    const boost::shared_ptr<NetworkModel>& model, const Integer num_species,
+    const ODESolverType solver_type, const Real duration)
+{
+    boost::shared_ptr<ODEWorld> world(new ODEWorld(Real3(1, 1, 1)));
+    for (Integer i(0); i < num_species; ++i)
+    {
+        std::ostringstream oss;
+        oss << "A" << i;
+        world->add_molecules(Species(oss.str()), 1.0 + (i % 3));
+    }
+
+    ODESimulator sim(model, world, solver_type);
+
+    const double start(walltime());
+    sim.step(duration);
+    const double end(walltime());
+    return end - start;
+}
+
+int main(int argc, char **argv)
+{
+    const Integer max_num_species(argc > 1 ? std::atoi(argv[1]) : 1000);
+    const Real duration(argc > 2 ? std::atof(argv[2]) : 1.0);
+    const Integer max_dense(argc > 3 ? std::atoi(argv[3]) : 100);
+
+    std::cout << "# species\trosenbrock4 [s]\tsparse rosenbrock4 [s]" << std::endl;
+    for (Integer num_species(10); num_species <= max_num_species; num_species *= 10)
+    {
+        const boost::shared_ptr<NetworkModel> model(generate_ring_model(num_species));
+        const Real t2(measure(model, num_species, SPARSE_ROSENBROCK4, duration));
+        std::cout << num_species * 2 << "\t";
+        if (num_species <= max_dense)
+        {
+            std::cout << measure(model, num_species, ROSENBROCK4_CONTROLLER, duration);
+        }
+        else
+        {
+            std::cout << "-";
+        }
+        std::cout << "\t" << t2 << std::endl;
+    }
+    return 0;
+}
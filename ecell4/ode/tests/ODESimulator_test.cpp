@@ -71,3 +71,202 @@ BOOST_AUTO_TEST_CASE(ODESimulator_test_step2)
 
     // BOOST_ASSERT(false);
 }
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_recompile)
+{
+    const Real L(1e-6);
+    const Real3 edge_lengths(L, L, L);
+
+    Species sp1("A"), sp2("B"), sp3("C");
+    ReactionRule rr1;
+    rr1.set_k(1.0);
+    rr1.add_reactant(sp1);
+    rr1.add_product(sp2);
+
+    boost::shared_ptr<ODENetworkModel> model(new ODENetworkModel());
+    model->add_reaction_rule(rr1);
+
+    boost::shared_ptr<ODEWorld> world(new ODEWorld(edge_lengths));
+    world->reserve_species(sp1);
+    world->set_value(sp1, 60);
+
+    ODESimulator target(model, world);
+    for (Integer i(1); i <= 10; ++i)
+    {
+        target.step(0.1 * i);
+    }
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp1), 60 * std::exp(-1.0), 1e-3);
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp2), 60 * (1 - std::exp(-1.0)), 1e-3);
+
+    world->set_value(sp2, 0);
+    ReactionRule rr2;
+    rr2.set_k(1.0);
+    rr2.add_reactant(sp1);
+    rr2.add_product(sp3);
+    model->add_reaction_rule(rr2);
+    target.step(2.0);
+
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp1), 60 * std::exp(-3.0), 1e-3);
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp2), world->get_value_exact(sp3), 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_recompile_species)
+{
+    const Real L(1e-6);
+    const Real3 edge_lengths(L, L, L);
+
+    Species sp1("A"), sp2("B");
+    ReactionRule rr1;
+    rr1.set_k(1.0);
+    rr1.add_reactant(sp1);
+    rr1.add_product(sp2);
+
+    boost::shared_ptr<ODENetworkModel> model(new ODENetworkModel());
+    model->add_reaction_rule(rr1);
+
+    boost::shared_ptr<ODEWorld> world(new ODEWorld(edge_lengths));
+    world->reserve_species(sp1);
+    world->reserve_species(sp2);
+    world->set_value(sp1, 60);
+
+    ODESimulator target(model, world);
+    target.step(1.0);
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp1), 60 * std::exp(-1.0), 1e-3);
+
+    // the species are reordered with the same number of them.
+    const Real value(world->get_value_exact(sp1));
+    world->release_species(sp1);
+    world->reserve_species(sp1);
+    world->set_value(sp1, value);
+    BOOST_CHECK(world->list_species()[0] == sp2);
+    target.step(2.0);
+
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp1), 60 * std::exp(-2.0), 1e-3);
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp2), 60 * (1 - std::exp(-2.0)), 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_sparse_lu)
+{
+    // (shift * I - A) for A = [[1, 2, 0], [0, 3, 0], [4, 0, 5]]
+    ODESparseMatrix::entry_container_type entries;
+    entries.push_back(std::make_pair(0, 0));
+    entries.push_back(std::make_pair(0, 1));
+    entries.push_back(std::make_pair(1, 1));
+    entries.push_back(std::make_pair(2, 0));
+    entries.push_back(std::make_pair(2, 2));
+    entries.push_back(std::make_pair(2, 2));
+
+    ODESparseMatrix A;
+    A.build(3, entries);
+    BOOST_CHECK_EQUAL(A.num_nonzeros(), 5);
+    BOOST_CHECK_EQUAL(A.find(1, 0), A.num_nonzeros());
+    A.values()[A.find(0, 0)] = 1;
+    A.values()[A.find(0, 1)] = 2;
+    A.values()[A.find(1, 1)] = 3;
+    A.values()[A.find(2, 0)] = 4;
+    A.values()[A.find(2, 2)] = 5;
+
+    ODESparseLU lu;
+    lu.analyze(A);
+    BOOST_CHECK(lu.factorize(10.0, A));
+
+    // the solution is (1, 2, 3): b = (10 I - A) x
+    std::vector<double> b(3);
+    b[0] = 9 * 1 - 2 * 2;
+    b[1] = 7 * 2;
+    b[2] = -4 * 1 + 5 * 3;
+    lu.solve(b);
+    BOOST_CHECK_CLOSE(b[0], 1.0, 1e-10);
+    BOOST_CHECK_CLOSE(b[1], 2.0, 1e-10);
+    BOOST_CHECK_CLOSE(b[2], 3.0, 1e-10);
+
+    // a singular shift
+    BOOST_CHECK(!lu.factorize(3.0, A));
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_sparse_rosenbrock4)
+{
+    // the Robertson problem
+    const Real3 edge_lengths(1, 1, 1);
+    Species sp1("A"), sp2("B"), sp3("C");
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 0.04));
+    {
+        ReactionRule rr;
+        rr.set_k(3e+7);
+        rr.add_reactant(sp2);
+        rr.add_reactant(sp2);
+        rr.add_product(sp3);
+        rr.add_product(sp2);
+        model->add_reaction_rule(rr);
+    }
+    {
+        ReactionRule rr;
+        rr.set_k(1e+4);
+        rr.add_reactant(sp2);
+        rr.add_reactant(sp3);
+        rr.add_product(sp1);
+        rr.add_product(sp3);
+        model->add_reaction_rule(rr);
+    }
+
+    boost::shared_ptr<ODEWorld> world1(new ODEWorld(edge_lengths));
+    world1->add_molecules(sp1, 1.0);
+    boost::shared_ptr<ODEWorld> world2(new ODEWorld(edge_lengths));
+    world2->add_molecules(sp1, 1.0);
+
+    ODESimulator sim1(model, world1, SPARSE_ROSENBROCK4);
+    ODESimulator sim2(model, world2, ROSENBROCK4_CONTROLLER);
+    sim1.set_absolute_tolerance(1e-10);
+    sim1.set_relative_tolerance(1e-10);
+    sim2.set_absolute_tolerance(1e-10);
+    sim2.set_relative_tolerance(1e-10);
+    sim1.step(40.0);
+    sim2.step(40.0);
+
+    BOOST_CHECK_CLOSE(world1->get_value_exact(sp1), world2->get_value_exact(sp1), 1e-4);
+    BOOST_CHECK_CLOSE(world1->get_value_exact(sp2), world2->get_value_exact(sp2), 1e-4);
+    BOOST_CHECK_CLOSE(world1->get_value_exact(sp3), world2->get_value_exact(sp3), 1e-4);
+    BOOST_CHECK_CLOSE(
+        world1->get_value_exact(sp1) + world1->get_value_exact(sp2)
+        + world1->get_value_exact(sp3), 1.0, 1e-6);
+}
+
+BOOST_AUTO_TEST_CASE(ODESimulator_test_stoichiometry)
+{
+    // 2 A -> B, and a non-integer order C^0.5 -> D beside the flat kernel.
+    const Real3 edge_lengths(1, 1, 1);
+    Species sp1("A"), sp2("B"), sp3("C"), sp4("D");
+
+    boost::shared_ptr<ODENetworkModel> model(new ODENetworkModel());
+    {
+        ODEReactionRule rr;
+        rr.add_reactant(sp1, 2.0);
+        rr.add_product(sp2);
+        rr.set_k(1.0);
+        model->add_reaction_rule(rr);
+    }
+    {
+        ODEReactionRule rr;
+        rr.add_reactant(sp3, 0.5);
+        rr.add_product(sp4);
+        rr.set_k(1.0);
+        model->add_reaction_rule(rr);
+    }
+
+    boost::shared_ptr<ODEWorld> world(new ODEWorld(edge_lengths));
+    world->add_molecules(sp1, 10.0);
+    world->add_molecules(sp3, 4.0);
+
+    ODESimulator target(model, world);
+    target.set_absolute_tolerance(1e-10);
+    target.set_relative_tolerance(1e-10);
+    target.step(1.0);
+
+    // dA/dt = -2 A^2, and dC/dt = -0.5 C^0.5
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp1), 10.0 / (1 + 2 * 10.0), 1e-6);
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp2), (10.0 - 10.0 / 21) / 2, 1e-6);
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp3), 3.0625, 1e-6);
+    BOOST_CHECK_CLOSE(world->get_value_exact(sp4), 1.875, 1e-6);
+}
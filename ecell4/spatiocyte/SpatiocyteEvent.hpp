@@ -4,6 +4,7 @@
 #include <ecell4/core/ReactionRule.hpp>
 #include <ecell4/core/EventScheduler.hpp>
 #include <ecell4/core/Model.hpp>
+#include <ecell4/core/get_mapper_mf.hpp>
 #include "SpatiocyteReactions.hpp"
 #include "SpatiocyteWorld.hpp"
 
@@ -46,7 +47,8 @@ protected:
 struct StepEvent : SpatiocyteEvent
 {
     StepEvent(boost::shared_ptr<Model> model, boost::shared_ptr<SpatiocyteWorld> world,
-            const Species& species, const Real& t, const Real alpha=1.0);
+            const Species& species, const Real& t, const Real alpha=1.0,
+            const Integer num_slabs=1, const Integer sort_interval=0);
     virtual ~StepEvent() {}
     virtual void fire_();
 
@@ -60,6 +62,11 @@ struct StepEvent : SpatiocyteEvent
         return alpha_;
     }
 
+    Integer const& num_slabs() const
+    {
+        return num_slabs_;
+    }
+
     void walk(const Real& alpha);
 
 protected:
@@ -71,11 +78,34 @@ protected:
         REACTION_SUCCEEDED = 2
     } attempt_reaction_result_type;
 
-    void walk_in_space_(const MoleculePool* mtype, const Real& alpha);
-    void walk_on_surface_(const MoleculePool* mtype, const Real& alpha);
+    /**
+     * the reaction rules between the molecules of this species and of
+     * a partner pool, each with its acceptance probability divided by
+     * alpha, i.e. k times the dimensional factor.
+     */
+    typedef std::vector<std::pair<ReactionRule, Real> > reaction_rule_cache_type;
+    typedef utils::get_mapper_mf<const VoxelPool*, reaction_rule_cache_type>::type
+        reaction_rule_cache_map_type;
+
+    typedef std::vector<std::pair<SpatiocyteWorld::coordinate_type, std::size_t> >
+        moved_container_type;
+    typedef std::vector<std::pair<SpatiocyteWorld::coordinate_id_pair_type,
+                                  SpatiocyteWorld::coordinate_type> >
+        collision_container_type;
+
+    void walk_in_space_(MoleculePool* mtype, const Real& alpha, const bool in_place);
+    bool walk_in_slabs_(MoleculePool* mtype, const Real& alpha);
+    void walk_in_slab_(
+        MoleculePool* mtype, const Real& alpha,
+        const std::vector<std::size_t>& indices, RandomNumberGenerator& rng,
+        std::vector<Integer>& nrands,
+        moved_container_type& moved, collision_container_type& collisions);
+    void walk_on_surface_(MoleculePool* mtype, const Real& alpha, const bool in_place);
     std::pair<attempt_reaction_result_type, reaction_type> attempt_reaction_(
         const SpatiocyteWorld::coordinate_id_pair_type& info,
         const SpatiocyteWorld::coordinate_type to_coord, const Real& alpha);
+    const reaction_rule_cache_type& query_reaction_rules_(
+        const VoxelPool* from_mt, const VoxelPool* to_mt);
 
     boost::shared_ptr<Model> model_;
     boost::shared_ptr<SpatiocyteWorld> world_;
@@ -83,6 +113,40 @@ protected:
     VoxelPool* mt_;
     const Real alpha_;
     std::vector<unsigned int> nids_; // neighbor indexes
+    std::vector<Integer> nrands_; // drawn at once for a walk
+
+    /**
+     * the pools are never removed from a world, and the rules for a pair
+     * of species are fixed. thus, an entry is added only when a new
+     * partner pool appears, and is never invalidated.
+     */
+    reaction_rule_cache_map_type reaction_rule_cache_;
+    bool is_self_reactive_;
+
+    /**
+     * the lattice is cut into slabs along the layers. the even slabs,
+     * then the odd slabs, are walked in parallel. a slab is at least
+     * two layers thick, so that no two slabs walked at once touch
+     * the same voxel. each slab has its own stream split from
+     * a generator seeded by the world for each walk. the buffers for
+     * each slab are kept across walks.
+     * slabs are used only if the space supports unindexed moves.
+     */
+    const Integer num_slabs_;
+    std::vector<boost::shared_ptr<RandomNumberGenerator> > slab_rngs_;
+    std::vector<std::vector<std::size_t> > slab_indices_;
+    std::vector<std::vector<Integer> > slab_nrands_;
+    std::vector<moved_container_type> slab_moved_;
+    std::vector<collision_container_type> slab_collisions_;
+    std::vector<std::string> slab_errors_;
+
+    /**
+     * the molecules are sorted along a space-filling curve every
+     * sort_interval_ walks, so that a walk visits nearby voxels in turn.
+     * a sort costs about as much as two walks. no sort if zero.
+     */
+    const Integer sort_interval_;
+    Integer num_walks_;
 };
 
 struct ZerothOrderReactionEvent : SpatiocyteEvent
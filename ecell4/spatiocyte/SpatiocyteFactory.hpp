@@ -24,8 +24,11 @@ public:
 
 public:
 
-    SpatiocyteFactory(const Real voxel_radius = default_voxel_radius())
-        : base_type(), rng_(), voxel_radius_(voxel_radius)
+    SpatiocyteFactory(const Real voxel_radius = default_voxel_radius(),
+                      const Integer num_slabs = default_num_slabs(),
+                      const Integer sort_interval = default_sort_interval())
+        : base_type(), rng_(), voxel_radius_(voxel_radius), num_slabs_(num_slabs),
+        sort_interval_(sort_interval)
     {
         ; // do nothing
     }
@@ -35,6 +38,16 @@ public:
         return 0.0;
     }
 
+    static inline const Integer default_num_slabs()
+    {
+        return 1;
+    }
+
+    static inline const Integer default_sort_interval()
+    {
+        return 0;
+    }
+
     virtual ~SpatiocyteFactory()
     {
         ; // do nothing
@@ -82,19 +95,21 @@ public:
         const boost::shared_ptr<Model>& model,
         const boost::shared_ptr<world_type>& world) const
     {
-        return new SpatiocyteSimulator(model, world);
+        return new SpatiocyteSimulator(model, world, num_slabs_, sort_interval_);
     }
 
     virtual SpatiocyteSimulator* create_simulator(
         const boost::shared_ptr<world_type>& world) const
     {
-        return new SpatiocyteSimulator(world);
+        return new SpatiocyteSimulator(world, num_slabs_, sort_interval_);
     }
 
 protected:
 
     Real voxel_radius_;
     boost::shared_ptr<RandomNumberGenerator> rng_;
+    Integer num_slabs_;
+    Integer sort_interval_;
 };
 
 } // spatiocyte
@@ -16,6 +16,8 @@ void SpatiocyteSimulator::initialize()
     last_reactions_.clear();
 
     scheduler_.clear();
+    dependencies_.clear();
+    registered_species_.clear();
     update_alpha_map();
     const std::vector<Species> species(world_->list_species());
     for (std::vector<Species>::const_iterator itr(species.begin());
@@ -71,6 +73,11 @@ void SpatiocyteSimulator::update_alpha_map()
 
 void SpatiocyteSimulator::register_events(const Species& sp)
 {
+    if (!registered_species_.insert(sp).second)
+    {
+        return;
+    }
+
     if (world_->has_molecule_pool(sp))
     {
         //TODO: Call steps only if sp is assigned not to StructureType.
@@ -89,7 +96,30 @@ void SpatiocyteSimulator::register_events(const Species& sp)
         const boost::shared_ptr<SpatiocyteEvent>
             first_order_reaction_event(
                 create_first_order_reaction_event(rr, world_->t()));
-        scheduler_.add(first_order_reaction_event);
+        const event_id_type id(scheduler_.add(first_order_reaction_event));
+        dependencies_[rr.reactants().front()].push_back(id);
+    }
+}
+
+void SpatiocyteSimulator::interrupt_dependents(
+    const std::vector<Species>& species, const Real& t)
+{
+    for (std::vector<Species>::const_iterator itr(species.begin());
+        itr != species.end(); ++itr)
+    {
+        event_dependency_map_type::const_iterator found(dependencies_.find(*itr));
+        if (found == dependencies_.end())
+        {
+            continue;
+        }
+
+        for (std::vector<event_id_type>::const_iterator id((*found).second.begin());
+            id != (*found).second.end(); ++id)
+        {
+            const boost::shared_ptr<SpatiocyteEvent> event(scheduler_.get(*id));
+            event->interrupt(t);
+            scheduler_.update(std::make_pair(*id, event));
+        }
     }
 }
 
@@ -97,7 +127,8 @@ boost::shared_ptr<SpatiocyteEvent> SpatiocyteSimulator::create_step_event(
         const Species& species, const Real& t, const Real& alpha)
 {
     boost::shared_ptr<SpatiocyteEvent> event(
-            new StepEvent(model_, world_, species, t, alpha));
+            new StepEvent(model_, world_, species, t, alpha, num_slabs_,
+                          sort_interval_));
     return event;
 }
 
@@ -167,34 +198,44 @@ bool SpatiocyteSimulator::step(const Real& upto)
 void SpatiocyteSimulator::step_()
 {
 
-    scheduler_type::value_type top(scheduler_.pop());
+    // the top event keeps its id, which the dependencies refer to.
+    const scheduler_type::value_type top(scheduler_.top());
     const Real time(top.second->time());
     world_->set_t(time);
     top.second->fire(); // top.second->time_ is updated in fire()
+    scheduler_.update(top);
     set_last_event_(boost::const_pointer_cast<const SpatiocyteEvent>(top.second));
 
     last_reactions_ = last_event_->reactions();
 
-    std::vector<Species> new_species;
+    std::vector<Species> new_species, changed_species;
     for (std::vector<reaction_type>::const_iterator itr(last_reactions().begin());
             itr != last_reactions().end(); ++itr)
+    {
+        for (ReactionInfo::container_type::const_iterator
+                reactant((*itr).second.reactants().begin());
+                reactant != (*itr).second.reactants().end(); ++reactant)
+        {
+            changed_species.push_back((*reactant).second.species());
+        }
         for (ReactionInfo::container_type::const_iterator
                 product((*itr).second.products().begin());
                 product != (*itr).second.products().end(); ++product)
         {
             const Species& species((*product).second.species());
-            if (!world_->has_species(species))
+            changed_species.push_back(species);
+            // the products are already in the world here.
+            if (registered_species_.find(species) == registered_species_.end())
                 new_species.push_back(species);
         }
-
-    scheduler_type::events_range events(scheduler_.events());
-    for (scheduler_type::events_range::iterator itr(events.begin());
-        itr != events.end(); ++itr)
-    {
-        (*itr).second->interrupt(time);
-        scheduler_.update(*itr);
     }
-    scheduler_.add(top.second);
+
+    // only the events depending on the changed numbers are rescheduled.
+    std::sort(changed_species.begin(), changed_species.end());
+    changed_species.erase(
+        std::unique(changed_species.begin(), changed_species.end()),
+        changed_species.end());
+    interrupt_dependents(changed_species, time);
 
     // update_alpha_map(); // may be performance cost
     for (std::vector<Species>::const_iterator itr(new_species.begin());
@@ -2,6 +2,7 @@
 #define ECELL4_LATTICE_LATTICE_SIMULATOR_HPP
 
 #include <numeric>
+#include <set>
 #include <boost/shared_ptr.hpp>
 #include <boost/lexical_cast.hpp>
 
@@ -31,20 +32,46 @@ public:
     typedef SpatiocyteEvent::reaction_type reaction_type;
     typedef EventSchedulerBase<SpatiocyteEvent> scheduler_type;
     typedef utils::get_mapper_mf<Species, Real>::type alpha_map_type;
+    typedef scheduler_type::identifier_type event_id_type;
+    typedef utils::get_mapper_mf<Species, std::vector<event_id_type> >::type
+        event_dependency_map_type;
 
 public:
 
     SpatiocyteSimulator(
             boost::shared_ptr<Model> model,
             boost::shared_ptr<SpatiocyteWorld> world)
-        : base_type(model, world)
+        : base_type(model, world), num_slabs_(1), sort_interval_(0)
     {
         initialize();
     }
 
     SpatiocyteSimulator(
             boost::shared_ptr<SpatiocyteWorld> world)
-        : base_type(world)
+        : base_type(world), num_slabs_(1), sort_interval_(0)
+    {
+        initialize();
+    }
+
+    /**
+     * walk the molecules in num_slabs slabs along the layers in parallel.
+     * this applies only to the molecules diffusing in a vacant space.
+     * sort the molecules of a species along a space-filling curve every
+     * sort_interval walks, or never if sort_interval is zero.
+     */
+    SpatiocyteSimulator(
+            boost::shared_ptr<Model> model,
+            boost::shared_ptr<SpatiocyteWorld> world,
+            const Integer num_slabs, const Integer sort_interval = 0)
+        : base_type(model, world), num_slabs_(num_slabs), sort_interval_(sort_interval)
+    {
+        initialize();
+    }
+
+    SpatiocyteSimulator(
+            boost::shared_ptr<SpatiocyteWorld> world,
+            const Integer num_slabs, const Integer sort_interval = 0)
+        : base_type(world), num_slabs_(num_slabs), sort_interval_(sort_interval)
     {
         initialize();
     }
@@ -81,6 +108,7 @@ protected:
 
     void step_();
     void register_events(const Species& species);
+    void interrupt_dependents(const std::vector<Species>& species, const Real& t);
     void update_alpha_map();
 
     void set_last_event_(boost::shared_ptr<const SpatiocyteEvent> event)
@@ -93,9 +121,18 @@ protected:
     scheduler_type scheduler_; boost::shared_ptr<const SpatiocyteEvent> last_event_;
     alpha_map_type alpha_map_;
 
+    /**
+     * the first-order reaction events depending on the number of each
+     * species. the other events are not affected by the state.
+     */
+    event_dependency_map_type dependencies_;
+    std::set<Species> registered_species_;
+
     std::vector<reaction_type> last_reactions_;
 
     Real dt_;
+    const Integer num_slabs_;
+    const Integer sort_interval_;
 };
 
 } // spatiocyte
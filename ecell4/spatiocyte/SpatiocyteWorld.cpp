@@ -527,6 +527,14 @@ SpatiocyteWorld::move_to_neighbor(
     return (*space_).move_to_neighbor(from_mt, loc, info, nrand);
 }
 
+std::pair<SpatiocyteWorld::coordinate_type, bool>
+SpatiocyteWorld::move_to_neighbor_unindexed(
+    VoxelPool* const& from_mt, VoxelPool* const& loc,
+    coordinate_id_pair_type& info, const Integer nrand)
+{
+    return (*space_).move_to_neighbor_unindexed(from_mt, loc, info, nrand);
+}
+
 std::pair<SpatiocyteWorld::coordinate_type, bool>
 SpatiocyteWorld::check_neighbor(
     const coordinate_type coord, const std::string& loc)
@@ -302,6 +302,14 @@ public:
     std::pair<coordinate_type, bool> move_to_neighbor(
         VoxelPool* const& from_mt, VoxelPool* const& loc,
         coordinate_id_pair_type& info, const Integer nrand);
+    std::pair<coordinate_type, bool> move_to_neighbor_unindexed(
+        VoxelPool* const& from_mt, VoxelPool* const& loc,
+        coordinate_id_pair_type& info, const Integer nrand);
+
+    bool supports_unindexed_moves() const
+    {
+        return (*space_).supports_unindexed_moves();
+    }
 
     coordinate_type get_neighbor(coordinate_type coord, Integer nrand) const
     {
@@ -386,6 +394,11 @@ public:
         return (*space_).inner_size();
     }
 
+    void sort_voxels(const Species& sp)
+    {
+        (*space_).sort_voxels(sp);
+    }
+
     // TODO
     // const Integer3 inner_shape() const
     // {
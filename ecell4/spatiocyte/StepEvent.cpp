@@ -1,6 +1,8 @@
 #include "SpatiocyteEvent.hpp"
 #include "utils.hpp"
 
+#include <algorithm>
+
 namespace ecell4
 {
 
@@ -8,8 +10,10 @@ namespace spatiocyte
 {
 
 StepEvent::StepEvent(boost::shared_ptr<Model> model, boost::shared_ptr<SpatiocyteWorld> world,
-        const Species& species, const Real& t, const Real alpha)
-    : SpatiocyteEvent(t), model_(model), world_(world), species_(species), alpha_(alpha)
+        const Species& species, const Real& t, const Real alpha,
+        const Integer num_slabs, const Integer sort_interval)
+    : SpatiocyteEvent(t), model_(model), world_(world), species_(species), alpha_(alpha),
+      num_slabs_(num_slabs), sort_interval_(sort_interval), num_walks_(0)
 {
     const SpatiocyteWorld::molecule_info_type
         minfo(world_->get_molecule_info(species));
@@ -43,6 +47,8 @@ StepEvent::StepEvent(boost::shared_ptr<Model> model, boost::shared_ptr<Spatiocyt
     nids_.clear();
     for (unsigned int i(0); i < 12; ++i)
         nids_.push_back(i);
+
+    is_self_reactive_ = !model_->query_reaction_rules(species_, species_).empty();
 }
 
 void StepEvent::fire_()
@@ -58,33 +64,77 @@ void StepEvent::walk(const Real& alpha)
         return; // INVALID ALPHA VALUE
     }
 
-    const boost::shared_ptr<RandomNumberGenerator>& rng(world_->rng());
-    const MoleculePool* mtype(world_->find_molecule_pool(species_));
+    if (sort_interval_ > 0 && num_walks_++ % sort_interval_ == 0)
+    {
+        world_->sort_voxels(species_);
+    }
+
+    MoleculePool* mtype(world_->find_molecule_pool(species_));
+
+    // the pool is swept backward in place. a reaction replaces the current
+    // voxel with the last one, which is either visited or new. a reaction
+    // between two voxels in the pool breaks this, so walk on a copy then.
+    const bool in_place(!is_self_reactive_);
+
+    // the slabs are walked concurrently only if the other pools are
+    // left untouched, i.e. the molecules diffuse in a vacant space.
+    const bool in_slabs(
+        num_slabs_ > 1 && mtype->location()->voxel_type() != VoxelPool::DEFAULT);
 
     if (mtype->get_dimension() == Shape::THREE)
-        walk_in_space_(mtype, alpha);
+    {
+        if (!in_slabs || !walk_in_slabs_(mtype, alpha))
+            walk_in_space_(mtype, alpha, in_place);
+    }
     else // dimension == TWO, etc.
-        walk_on_surface_(mtype, alpha);
+        walk_on_surface_(mtype, alpha, in_place);
 }
 
-void StepEvent::walk_in_space_(const MoleculePool* mtype, const Real& alpha)
+void StepEvent::walk_in_space_(
+    MoleculePool* mtype, const Real& alpha, const bool in_place)
 {
     const boost::shared_ptr<RandomNumberGenerator>& rng(world_->rng());
+    VoxelPool* const from_mt(mtype);
+    VoxelPool* const location(mtype->location());
+
     MoleculePool::container_type voxels;
-    copy(mtype->begin(), mtype->end(), back_inserter(voxels));
+    if (!in_place)
+    {
+        copy(mtype->begin(), mtype->end(), back_inserter(voxels));
+    }
 
-    std::size_t idx(0);
-    for (MoleculePool::container_type::iterator itr(voxels.begin());
-         itr != voxels.end(); ++itr)
+    const std::size_t num_voxels(in_place ? mtype->size() : voxels.size());
+    nrands_.resize(num_voxels);
+    if (num_voxels > 0)
     {
-        const Integer rnd(rng->uniform_int(0, 11));
-        const SpatiocyteWorld::coordinate_id_pair_type& info(*itr);
-        if (world_->get_voxel_pool_at(info.coordinate) != mtype)
+        rng->fill_uniform_int(&nrands_[0], num_voxels, 0, 11);
+    }
+
+    for (std::size_t idx(num_voxels); idx > 0; )
+    {
+        --idx;
+        const Integer rnd(nrands_[idx]);
+        const SpatiocyteWorld::coordinate_id_pair_type
+            info(in_place ? (*mtype)[idx] : voxels[idx]);
+        if (!in_place && world_->get_voxel_pool_at(info.coordinate) != mtype)
         {
             // should skip if a voxel is not the target species.
             // when reaction has occured before, a voxel can be changed.
             continue;
         }
+
+        if (in_place && alpha >= 1.0)
+        {
+            // the voxel in the pool is updated without any search.
+            const std::pair<SpatiocyteWorld::coordinate_type, bool>
+                retval(world_->move_to_neighbor(from_mt, location, (*mtype)[idx], rnd));
+            if (!retval.second && retval.first != info.coordinate)
+            {
+                attempt_reaction_(info, retval.first, alpha);
+            }
+            continue;
+        }
+
         const SpatiocyteWorld::coordinate_type neighbor(
                 world_->get_neighbor_boundary(info.coordinate, rnd));
         if (world_->can_move(info.coordinate, neighbor))
@@ -96,23 +146,176 @@ void StepEvent::walk_in_space_(const MoleculePool* mtype, const Real& alpha)
         {
             attempt_reaction_(info, neighbor, alpha);
         }
-        ++idx;
     }
 }
 
-void StepEvent::walk_on_surface_(const MoleculePool* mtype, const Real& alpha)
+bool StepEvent::walk_in_slabs_(MoleculePool* mtype, const Real& alpha)
+{
+    if (!world_->supports_unindexed_moves())
+    {
+        return false;
+    }
+
+    const Integer3 shape(world_->shape());
+    const Integer num_layers(shape.layer - 2); // without the borders
+    const Integer NUM_COLROW(shape.col * shape.row);
+
+    // the number of slabs must be even for a periodic boundary,
+    // where the first and the last slabs are adjacent.
+    Integer num_slabs(std::min(num_slabs_, num_layers / 2));
+    num_slabs -= num_slabs % 2;
+    if (num_slabs < 2)
+    {
+        return false;
+    }
+
+    // the result does not depend on the number of threads.
+    const PhiloxRandomNumberGenerator root(world_->rng()->uniform_int(0, 2147483647));
+    slab_rngs_.resize(num_slabs);
+    slab_indices_.resize(num_slabs);
+    slab_nrands_.resize(num_slabs);
+    slab_moved_.resize(num_slabs);
+    slab_collisions_.resize(num_slabs);
+    slab_errors_.resize(num_slabs);
+    for (Integer i(0); i < num_slabs; ++i)
+    {
+        slab_rngs_[i] = root.split(i);
+        slab_indices_[i].clear();
+        slab_moved_[i].clear();
+        slab_collisions_[i].clear();
+        slab_errors_[i].clear();
+    }
+
+    for (std::size_t idx(mtype->size()); idx > 0; )
+    {
+        --idx;
+        const Integer layer((*mtype)[idx].coordinate / NUM_COLROW - 1);
+        slab_indices_[layer * num_slabs / num_layers].push_back(idx);
+    }
+
+    for (int phase(0); phase < 2; ++phase)
+    {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+        for (int i = phase; i < num_slabs; i += 2)
+        {
+            // exceptions must not be thrown across the parallel region.
+            try
+            {
+                walk_in_slab_(mtype, alpha, slab_indices_[i], *(slab_rngs_[i]),
+                              slab_nrands_[i], slab_moved_[i], slab_collisions_[i]);
+            }
+            catch (const std::exception& e)
+            {
+                slab_errors_[i] = e.what();
+            }
+        }
+    }
+
+    for (Integer i(0); i < num_slabs; ++i)
+    {
+        mtype->reindex_voxels(slab_moved_[i]);
+    }
+
+    for (Integer i(0); i < num_slabs; ++i)
+    {
+        if (!slab_errors_[i].empty())
+        {
+            throw IllegalState(slab_errors_[i]);
+        }
+    }
+
+    // the reactions are attempted after all the moves, in the order of slabs.
+    for (Integer i(0); i < num_slabs; ++i)
+    {
+        for (collision_container_type::const_iterator itr(slab_collisions_[i].begin());
+             itr != slab_collisions_[i].end(); ++itr)
+        {
+            const SpatiocyteWorld::coordinate_id_pair_type& info((*itr).first);
+            if (world_->get_voxel_pool_at(info.coordinate) != mtype
+                || mtype->get_particle_id(info.coordinate) != info.pid)
+            {
+                // the molecule has reacted before.
+                continue;
+            }
+            attempt_reaction_(info, (*itr).second, alpha);
+        }
+    }
+    return true;
+}
+
+void StepEvent::walk_in_slab_(
+    MoleculePool* mtype, const Real& alpha,
+    const std::vector<std::size_t>& indices, RandomNumberGenerator& rng,
+    std::vector<Integer>& nrands,
+    moved_container_type& moved, collision_container_type& collisions)
+{
+    VoxelPool* const from_mt(mtype);
+    VoxelPool* const location(mtype->location());
+
+    nrands.resize(indices.size());
+    if (!indices.empty())
+    {
+        rng.fill_uniform_int(&nrands[0], indices.size(), 0, 11);
+    }
+
+    for (std::size_t i(0); i < indices.size(); ++i)
+    {
+        const std::size_t idx(indices[i]);
+        SpatiocyteWorld::coordinate_id_pair_type& info((*mtype)[idx]);
+        const SpatiocyteWorld::coordinate_type from(info.coordinate);
+        const Integer rnd(nrands[i]);
+
+        if (alpha >= 1.0)
+        {
+            const std::pair<SpatiocyteWorld::coordinate_type, bool>
+                retval(world_->move_to_neighbor_unindexed(from_mt, location, info, rnd));
+            if (retval.second)
+            {
+                moved.push_back(std::make_pair(from, idx));
+            }
+            else if (retval.first != from)
+            {
+                collisions.push_back(std::make_pair(info, retval.first));
+            }
+            continue;
+        }
+
+        const SpatiocyteWorld::coordinate_type neighbor(
+                world_->get_neighbor_boundary(from, rnd));
+        if (world_->can_move(from, neighbor))
+        {
+            if (rng.uniform(0,1) <= alpha
+                && world_->move_to_neighbor_unindexed(from_mt, location, info, rnd).second)
+            {
+                moved.push_back(std::make_pair(from, idx));
+            }
+        }
+        else
+        {
+            collisions.push_back(std::make_pair(info, neighbor));
+        }
+    }
+}
+
+void StepEvent::walk_on_surface_(
+    MoleculePool* mtype, const Real& alpha, const bool in_place)
 {
     const boost::shared_ptr<RandomNumberGenerator>& rng(world_->rng());
+
     MoleculePool::container_type voxels;
-    copy(mtype->begin(), mtype->end(), back_inserter(voxels));
+    if (!in_place)
+    {
+        copy(mtype->begin(), mtype->end(), back_inserter(voxels));
+    }
 
-    const VoxelPool* location(mtype->location());
-    std::size_t idx(0);
-    for (MoleculePool::container_type::iterator itr(voxels.begin());
-         itr != voxels.end(); ++itr)
+    for (std::size_t idx(in_place ? mtype->size() : voxels.size()); idx > 0; )
     {
-        const SpatiocyteWorld::coordinate_id_pair_type& info(*itr);
-        if (world_->get_voxel_pool_at(info.coordinate) != mtype)
+        --idx;
+        const SpatiocyteWorld::coordinate_id_pair_type
+            info(in_place ? (*mtype)[idx] : voxels[idx]);
+        if (!in_place && world_->get_voxel_pool_at(info.coordinate) != mtype)
         {
             // should skip if a voxel is not the target species.
             // when reaction has occured before, a voxel can be changed.
@@ -141,7 +344,6 @@ void StepEvent::walk_on_surface_(const MoleculePool* mtype, const Real& alpha)
             }
             break;
         }
-        ++idx;
     }
 }
 
@@ -161,51 +363,79 @@ StepEvent::attempt_reaction_(
         return std::make_pair(NO_REACTION, reaction_type());
     }
 
-    const Species& speciesA(from_mt->species());
-    const Species& speciesB(to_mt->species());
-
-    const std::vector<ReactionRule> rules(
-        model_->query_reaction_rules(speciesA, speciesB));
+    const reaction_rule_cache_type& rules(query_reaction_rules_(from_mt, to_mt));
 
     if (rules.empty())
     {
         return std::make_pair(NO_REACTION, reaction_type());
     }
 
-    const Real factor(calculate_dimensional_factor(from_mt, to_mt,
-                boost::const_pointer_cast<const SpatiocyteWorld>(world_)));
-
     const Real rnd(world_->rng()->uniform(0,1));
     Real accp(0.0);
-    for (std::vector<ReactionRule>::const_iterator itr(rules.begin()); itr != rules.end(); ++itr)
+    for (reaction_rule_cache_type::const_iterator itr(rules.begin()); itr != rules.end(); ++itr)
     {
-        const Real k((*itr).k());
-        const Real P(k * factor * alpha);
-        accp += P;
-        if (accp > 1)
-        {
-            std::cerr << "The total acceptance probability [" << accp
-                << "] exceeds 1 for '" << speciesA.serial()
-                << "' and '" << speciesB.serial() << "'." << std::endl;
-        }
+        accp += (*itr).second * alpha;
         if (accp >= rnd)
         {
+            const ReactionRule& rule((*itr).first);
             ReactionInfo rinfo(apply_second_order_reaction(
-                        world_, *itr,
+                        world_, rule,
                         world_->make_pid_voxel_pair(from_mt, info),
                         world_->make_pid_voxel_pair(to_mt, to_coord)));
             if (rinfo.has_occurred())
             {
-                reaction_type reaction(std::make_pair(*itr, rinfo));
+                reaction_type reaction(std::make_pair(rule, rinfo));
                 push_reaction(reaction);
                 return std::make_pair(REACTION_SUCCEEDED, reaction);
             }
-            return std::make_pair(REACTION_FAILED, std::make_pair(*itr, rinfo));
+            return std::make_pair(REACTION_FAILED, std::make_pair(rule, rinfo));
         }
     }
     return std::make_pair(REACTION_FAILED, reaction_type());
 }
 
+const StepEvent::reaction_rule_cache_type& StepEvent::query_reaction_rules_(
+    const VoxelPool* from_mt, const VoxelPool* to_mt)
+{
+    reaction_rule_cache_map_type::const_iterator found(reaction_rule_cache_.find(to_mt));
+    if (found != reaction_rule_cache_.end())
+    {
+        return (*found).second;
+    }
+
+    reaction_rule_cache_type& cache(reaction_rule_cache_[to_mt]);
+
+    const Species& speciesA(from_mt->species());
+    const Species& speciesB(to_mt->species());
+
+    const std::vector<ReactionRule> rules(
+        model_->query_reaction_rules(speciesA, speciesB));
+
+    if (rules.empty())
+    {
+        return cache;
+    }
+
+    const Real factor(calculate_dimensional_factor(from_mt, to_mt,
+                boost::const_pointer_cast<const SpatiocyteWorld>(world_)));
+
+    Real accp(0.0);
+    for (std::vector<ReactionRule>::const_iterator itr(rules.begin()); itr != rules.end(); ++itr)
+    {
+        const Real P((*itr).k() * factor);
+        cache.push_back(std::make_pair(*itr, P));
+        accp += P * alpha_;
+    }
+
+    if (accp > 1)
+    {
+        std::cerr << "The total acceptance probability [" << accp
+            << "] exceeds 1 for '" << speciesA.serial()
+            << "' and '" << speciesB.serial() << "'." << std::endl;
+    }
+    return cache;
+}
+
 } // spatiocyte
 
 } // ecell4
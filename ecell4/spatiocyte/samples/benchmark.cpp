@@ -0,0 +1,92 @@
+#include <iostream>
+#include <sstream>
+#include <cstdlib>
+#include <sys/time.h>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/NetworkModel.hpp>
+#include <ecell4/spatiocyte/SpatiocyteSimulator.hpp>
+
+using namespace ecell4;
+using namespace ecell4::spatiocyte;
+
+/**
+ * a ring of num_species diffusing species connected by first-order
+ * conversions, A0 -> A1 -> ... -> A(n-1) -> A0.
+ * if k2 > 0, the neighbors in the ring also collide and react,
+ * A(i) + A(i+1) -> A(i+1), with the rate k2.
+ */
+boost::shared_ptr<NetworkModel> generate_ring_model(
+    const Integer num_species, const Real k2)
+{
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    std::vector<Species> species;
+    for (Integer i(0); i < num_species; ++i)
+    {
+        std::ostringstream oss;
+        oss << "A" << i;
+        species.push_back(Species(oss.str(), "2.5e-9", "1e-12"));
+        model->add_species_attribute(species.back());
+    }
+
+    for (Integer i(0); i < num_species; ++i)
+    {
+        model->add_reaction_rule(create_unimolecular_reaction_rule(
+            species[i], species[(i + 1) % num_species], 1.0));
+        if (k2 > 0)
+        {
+            model->add_reaction_rule(create_binding_reaction_rule(
+                species[i], species[(i + 1) % num_species],
+                species[(i + 1) % num_species], k2));
+        }
+    }
+    return model;
+}
+
+double walltime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+int main(int argc, char **argv)
+{
+    const Integer num_species(argc > 1 ? std::atoi(argv[1]) : 100);
+    const Integer num_molecules(argc > 2 ? std::atoi(argv[2]) : 100);
+    const Integer num_steps(argc > 3 ? std::atoi(argv[3]) : 100000);
+    const Real L(argc > 4 ? std::atof(argv[4]) : 1e-6);
+    const Real k2(argc > 5 ? std::atof(argv[5]) : 0.0);
+    const Integer num_slabs(argc > 6 ? std::atoi(argv[6]) : 1);
+    const Integer sort_interval(argc > 7 ? std::atoi(argv[7]) : 0);
+
+    const boost::shared_ptr<NetworkModel> model(generate_ring_model(num_species, k2));
+
+    boost::shared_ptr<RandomNumberGenerator>
+        rng(new GSLRandomNumberGenerator());
+    rng->seed(0);
+    boost::shared_ptr<SpatiocyteWorld> world(
+        new SpatiocyteWorld(Real3(L, L, L), 2.5e-9, rng));
+    world->bind_to(model); // for the radius and D of the molecules
+    for (Integer i(0); i < num_species; ++i)
+    {
+        std::ostringstream oss;
+        oss << "A" << i;
+        world->add_molecules(Species(oss.str()), num_molecules);
+    }
+
+    SpatiocyteSimulator sim(model, world, num_slabs, sort_interval);
+
+    const double start(walltime());
+    for (Integer i(0); i < num_steps; ++i)
+    {
+        sim.step();
+    }
+    const double end(walltime());
+
+    std::cout << "# species\tmolecules\tslabs\tsteps\tt\t[us/step]" << std::endl;
+    std::cout << num_species << "\t" << num_species * num_molecules
+              << "\t" << num_slabs << "\t" << num_steps << "\t" << sim.t()
+              << "\t" << (end - start) / num_steps * 1e+6 << std::endl;
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <sys/time.h>
+
+#include <ecell4/core/types.hpp>
+#include <ecell4/core/RandomNumberGenerator.hpp>
+#include <ecell4/core/LatticeSpaceVectorImpl.hpp>
+
+using namespace ecell4;
+
+typedef LatticeSpace::coordinate_type coordinate_type;
+
+/**
+ * the neighbor computed arithmetically, as get_neighbor did
+ * before the offset tables.
+ */
+coordinate_type arithmetic_neighbor(
+    const LatticeSpaceVectorImpl& space,
+    const coordinate_type& coord, const Integer& nrand)
+{
+    const Integer3 shape(space.shape());
+    const Integer NUM_COLROW(shape.col * shape.row);
+    const Integer NUM_ROW(shape.row);
+    const bool odd_col(((coord % NUM_COLROW) / NUM_ROW) & 1);
+    const bool odd_lay((coord / NUM_COLROW) & 1);
+
+    if (!space.is_inside(coord))
+        throw NotFound("There is no neighbor voxel.");
+
+    switch (nrand)
+    {
+    case 0:
+        return coord - 1;
+    case 1:
+        return coord + 1;
+    case 2:
+        return coord + (odd_col ^ odd_lay) - NUM_ROW - 1;
+    case 3:
+        return coord + (odd_col ^ odd_lay) - NUM_ROW;
+    case 4:
+        return coord + (odd_col ^ odd_lay) + NUM_ROW - 1;
+    case 5:
+        return coord + (odd_col ^ odd_lay) + NUM_ROW;
+    case 6:
+        return coord - (2 * odd_col - 1) * NUM_COLROW - NUM_ROW;
+    case 7:
+        return coord - (2 * odd_col - 1) * NUM_COLROW + NUM_ROW;
+    case 8:
+        return coord + (odd_col ^ odd_lay) - NUM_COLROW - 1;
+    case 9:
+        return coord + (odd_col ^ odd_lay) - NUM_COLROW;
+    case 10:
+        return coord + (odd_col ^ odd_lay) + NUM_COLROW - 1;
+    case 11:
+        return coord + (odd_col ^ odd_lay) + NUM_COLROW;
+    }
+    throw NotFound("Invalid argument: nrand");
+}
+
+double walltime()
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+int main(int argc, char **argv)
+{
+    const Integer num_samples(argc > 1 ? std::atoi(argv[1]) : 1000000);
+    const Integer num_repeats(argc > 2 ? std::atoi(argv[2]) : 100);
+    const Real L(argc > 3 ? std::atof(argv[3]) : 1e-6);
+
+    const LatticeSpaceVectorImpl space(Real3(L, L, L), 2.5e-9, false);
+
+    GSLRandomNumberGenerator rng;
+    rng.seed(0);
+    std::vector<coordinate_type> coords(num_samples);
+    std::vector<Integer> nrands(num_samples);
+    for (Integer i(0); i < num_samples; ++i)
+    {
+        coords[i] = space.inner2coordinate(
+            rng.uniform_int(0, space.inner_size() - 1));
+        nrands[i] = rng.uniform_int(0, 11);
+    }
+
+    coordinate_type sum_arithmetic(0), sum_table(0), sum_unsafe(0);
+
+    double start(walltime());
+    for (Integer j(0); j < num_repeats; ++j)
+    {
+        for (Integer i(0); i < num_samples; ++i)
+        {
+            sum_arithmetic += arithmetic_neighbor(space, coords[i], nrands[i]);
+        }
+    }
+    const double t_arithmetic((walltime() - start) / (num_samples * num_repeats));
+
+    start = walltime();
+    for (Integer j(0); j < num_repeats; ++j)
+    {
+        for (Integer i(0); i < num_samples; ++i)
+        {
+            sum_table += space.get_neighbor(coords[i], nrands[i]);
+        }
+    }
+    const double t_table((walltime() - start) / (num_samples * num_repeats));
+
+    start = walltime();
+    for (Integer j(0); j < num_repeats; ++j)
+    {
+        for (Integer i(0); i < num_samples; ++i)
+        {
+            sum_unsafe += space.get_neighbor_unsafe(coords[i], nrands[i]);
+        }
+    }
+    const double t_unsafe((walltime() - start) / (num_samples * num_repeats));
+
+    if (sum_arithmetic != sum_table || sum_arithmetic != sum_unsafe)
+    {
+        std::cerr << "The neighbors do not match." << std::endl;
+        return 1;
+    }
+
+    std::cout << "# voxels\tarithmetic\ttable\tunsafe\t[ns/call]" << std::endl;
+    std::cout << space.inner_size() << "\t" << t_arithmetic * 1e+9
+              << "\t" << t_table * 1e+9 << "\t" << t_unsafe * 1e+9 << std::endl;
+    return 0;
+}
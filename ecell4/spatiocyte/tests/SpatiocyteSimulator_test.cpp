@@ -398,6 +398,47 @@ BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_degradation_reaction)
 #endif
 }
 
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_first_order_dependency)
+{
+    const Real L(1e-7);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const std::string radius("2.5e-9");
+    const ecell4::Species sp1("A", radius, "1.0e-16"),
+          sp2("B", radius, "1.0e-16"),
+          sp3("C", radius, "1.0e-16");
+
+    // the decay of B is rescheduled only by the events changing B.
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp1, sp2, 1.0));
+    model->add_reaction_rule(create_unimolecular_reaction_rule(sp2, sp3, 1.0));
+
+    boost::shared_ptr<GSLRandomNumberGenerator>
+        rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<SpatiocyteWorld> world(
+            new SpatiocyteWorld(edge_lengths, voxel_radius, rng));
+
+    const Integer N(1000);
+    BOOST_CHECK(world->add_molecules(sp1, N));
+    SpatiocyteSimulator sim(model, world);
+
+    while (sim.step(1.0))
+    {
+        ;
+    }
+
+    // A = N e^-t and B = N t e^-t at t = 1, within five sigmas
+    const Real expected1(N * std::exp(-1.0)), expected2(N * std::exp(-1.0));
+    BOOST_CHECK(std::abs(world->num_molecules(sp1) - expected1) < 5 * std::sqrt(expected1));
+    BOOST_CHECK(std::abs(world->num_molecules(sp2) - expected2) < 5 * std::sqrt(expected2));
+    BOOST_CHECK_EQUAL(
+        world->num_molecules(sp1) + world->num_molecules(sp2)
+        + world->num_molecules(sp3), N);
+}
+
 BOOST_AUTO_TEST_CASE(LattiecSimulator_test_scheduler)
 {
     const Real L(1e-6);
@@ -569,3 +610,224 @@ BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_shape)
     world->save("structure_after.h5");
 #endif
 }
+
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_slabs)
+{
+    const Real L(5e-8);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const std::string radius("1.25e-9");
+    const ecell4::Species sp1("A", radius, "1.0e-12"),
+          sp2("B", radius, "1.1e-12"),
+          sp3("C", "2.5e-9", "1.2e-12");
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+
+    model->add_reaction_rule(create_binding_reaction_rule(sp1,sp2,sp3,1e-20));
+
+    std::vector<std::pair<ParticleID, Voxel> > voxels[2];
+    for (Integer j(0); j < 2; ++j)
+    {
+        boost::shared_ptr<GSLRandomNumberGenerator>
+            rng(new GSLRandomNumberGenerator());
+        rng->seed(0);
+        boost::shared_ptr<SpatiocyteWorld> world(
+                new SpatiocyteWorld(edge_lengths, voxel_radius, rng));
+
+        SpatiocyteSimulator sim(model, world, 4);
+
+        BOOST_CHECK(world->add_molecules(sp1, 100));
+        BOOST_CHECK(world->add_molecules(sp2, 100));
+        sim.initialize();
+
+        for (Integer i(0); i < 50; ++i)
+        {
+            sim.step();
+        }
+
+        const Integer num_sp3(world->num_molecules(sp3));
+        BOOST_CHECK(num_sp3 > 0);
+        BOOST_CHECK_EQUAL(100 - world->num_molecules(sp1), num_sp3);
+        BOOST_CHECK_EQUAL(100 - world->num_molecules(sp2), num_sp3);
+
+        voxels[j] = world->list_voxels();
+        for (std::vector<std::pair<ParticleID, Voxel> >::const_iterator
+                itr(voxels[j].begin()); itr != voxels[j].end(); ++itr)
+        {
+            // the indexes of the pools are consistent after the sweeps.
+            BOOST_CHECK_EQUAL(world->get_voxel((*itr).first).second.coordinate(),
+                              (*itr).second.coordinate());
+            BOOST_CHECK_EQUAL(world->get_voxel_at((*itr).second.coordinate()).first,
+                              (*itr).first);
+        }
+    }
+
+    // the slabs are walked with generators seeded by the world.
+    BOOST_CHECK_EQUAL(voxels[0].size(), voxels[1].size());
+    for (std::size_t i(0); i < voxels[0].size() && i < voxels[1].size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(voxels[0][i].second.coordinate(), voxels[1][i].second.coordinate());
+    }
+}
+
+/**
+ * the fraction of the molecules hopping to a neighbor in a walk, which is
+ * lowered by the collisions in a crowded lattice. it must not depend on
+ * the slabs.
+ */
+Real fraction_of_hops(const Integer num_slabs)
+{
+    const Real L(5e-8);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const Species sp1("A", "2.5e-9", "1e-12");
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+
+    boost::shared_ptr<GSLRandomNumberGenerator>
+        rng(new GSLRandomNumberGenerator());
+    rng->seed(0);
+    boost::shared_ptr<SpatiocyteWorld> world(
+            new SpatiocyteWorld(edge_lengths, voxel_radius, rng));
+
+    SpatiocyteSimulator sim(model, world, num_slabs);
+    BOOST_CHECK_EQUAL(world->inner_size(), 2352);
+    BOOST_CHECK(world->add_molecules(sp1, 800));
+    sim.initialize();
+
+    Integer num_hops(0), num_samples(0);
+    for (Integer i(0); i < 100; ++i)
+    {
+        const std::vector<std::pair<ParticleID, Voxel> > before(world->list_voxels());
+        sim.step();
+        for (std::vector<std::pair<ParticleID, Voxel> >::const_iterator
+                itr(before.begin()); itr != before.end(); ++itr)
+        {
+            if (world->get_voxel((*itr).first).second.coordinate()
+                    != (*itr).second.coordinate())
+            {
+                ++num_hops;
+            }
+            ++num_samples;
+        }
+    }
+    return static_cast<Real>(num_hops) / num_samples;
+}
+
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_slabs_hops)
+{
+    // a third of the voxels are occupied, and about as many hops are
+    // blocked. the standard deviation of the fraction is about 0.3%.
+    const Real occupancy(800.0 / 2352);
+    const Real hops1(fraction_of_hops(1)), hops4(fraction_of_hops(4));
+    BOOST_CHECK_CLOSE(hops1, 1 - occupancy, 2.0);
+    BOOST_CHECK_CLOSE(hops4, 1 - occupancy, 2.0);
+    BOOST_CHECK_CLOSE(hops4, hops1, 2.0);
+}
+
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_sort_interval)
+{
+    const Real L(5e-8);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const std::string radius("1.25e-9");
+    const ecell4::Species sp1("A", radius, "1.0e-12"),
+          sp2("B", radius, "1.1e-12"),
+          sp3("C", "2.5e-9", "1.2e-12");
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+
+    model->add_reaction_rule(create_binding_reaction_rule(sp1,sp2,sp3,1e-20));
+
+    boost::shared_ptr<GSLRandomNumberGenerator>
+        rng(new GSLRandomNumberGenerator());
+    boost::shared_ptr<SpatiocyteWorld> world(
+            new SpatiocyteWorld(edge_lengths, voxel_radius, rng));
+
+    // the molecules are sorted every other walk.
+    SpatiocyteSimulator sim(model, world, 1, 2);
+
+    BOOST_CHECK(world->add_molecules(sp1, 100));
+    BOOST_CHECK(world->add_molecules(sp2, 100));
+    sim.initialize();
+
+    for (Integer i(0); i < 50; ++i)
+    {
+        sim.step();
+    }
+
+    const Integer num_sp3(world->num_molecules(sp3));
+    BOOST_CHECK_EQUAL(100 - world->num_molecules(sp1), num_sp3);
+    BOOST_CHECK_EQUAL(100 - world->num_molecules(sp2), num_sp3);
+
+    const std::vector<std::pair<ParticleID, Voxel> > voxels(world->list_voxels());
+    for (std::vector<std::pair<ParticleID, Voxel> >::const_iterator
+            itr(voxels.begin()); itr != voxels.end(); ++itr)
+    {
+        BOOST_CHECK_EQUAL(world->get_voxel((*itr).first).second.coordinate(),
+                          (*itr).second.coordinate());
+        BOOST_CHECK_EQUAL(world->get_voxel_at((*itr).second.coordinate()).first,
+                          (*itr).first);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SpatiocyteSimulator_test_slabs_unsupported)
+{
+    const Real L(5e-8);
+    const Real3 edge_lengths(L, L, L);
+    const Real voxel_radius(2.5e-9);
+    const std::string radius("1.25e-9");
+    const ecell4::Species sp1("A", radius, "1.0e-12"),
+          sp2("B", radius, "1.1e-12"),
+          sp3("C", "2.5e-9", "1.2e-12");
+
+    boost::shared_ptr<NetworkModel> model(new NetworkModel());
+    model->add_species_attribute(sp1);
+    model->add_species_attribute(sp2);
+    model->add_species_attribute(sp3);
+
+    model->add_reaction_rule(create_binding_reaction_rule(sp1,sp2,sp3,1e-20));
+
+    // the cell list space cannot move molecules unindexed, and is walked
+    // as a whole with any number of slabs.
+    const Integer num_slabs[] = {1, 4};
+    std::vector<std::pair<ParticleID, Voxel> > voxels[2];
+    for (Integer j(0); j < 2; ++j)
+    {
+        boost::shared_ptr<GSLRandomNumberGenerator>
+            rng(new GSLRandomNumberGenerator());
+        rng->seed(0);
+        boost::shared_ptr<SpatiocyteWorld> world(
+            create_spatiocyte_world_cell_list_impl(
+                edge_lengths, voxel_radius, Integer3(3, 3, 3), rng));
+
+        SpatiocyteSimulator sim(model, world, num_slabs[j]);
+
+        BOOST_CHECK(world->add_molecules(sp1, 100));
+        BOOST_CHECK(world->add_molecules(sp2, 100));
+        sim.initialize();
+
+        for (Integer i(0); i < 50; ++i)
+        {
+            sim.step();
+        }
+
+        const Integer num_sp3(world->num_molecules(sp3));
+        BOOST_CHECK_EQUAL(100 - world->num_molecules(sp1), num_sp3);
+        BOOST_CHECK_EQUAL(100 - world->num_molecules(sp2), num_sp3);
+        voxels[j] = world->list_voxels();
+    }
+
+    BOOST_CHECK_EQUAL(voxels[0].size(), voxels[1].size());
+    for (std::size_t i(0); i < voxels[0].size() && i < voxels[1].size(); ++i)
+    {
+        BOOST_CHECK_EQUAL(voxels[0][i].second.coordinate(), voxels[1][i].second.coordinate());
+    }
+}
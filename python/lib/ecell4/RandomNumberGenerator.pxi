@@ -117,6 +117,24 @@ cdef class GSLRandomNumberGenerator:
         """
         return self.thisptr.get().binomial(p, n)
 
+    def poisson(self, Real mean):
+        """poisson(mean) -> Integer
+
+        Return a random integer from the Poisson distribution.
+
+        Parameters
+        ----------
+        mean : Real
+            The mean.
+
+        Returns
+        -------
+        Integer:
+            A random integer from a Poisson distribution.
+
+        """
+        return self.thisptr.get().poisson(mean)
+
     def seed(self, val = None):
         """seed(val=None)
 
@@ -0,0 +1,5 @@
+from ecell4.core import *
+from ecell4.util import *
+from ecell4 import bd, ode, gillespie, egfrd, spatiocyte, meso
+
+__version__ = '4.1.2'
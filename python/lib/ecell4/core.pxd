@@ -31,6 +31,7 @@ cdef extern from "ecell4/core/RandomNumberGenerator.hpp" namespace "ecell4":
         Real gaussian(Real, Real)
         Real gaussian(Real)
         Integer binomial(Real, Integer)
+        Integer poisson(Real)
         void seed(Integer)
         void seed()
         void save(string) except +
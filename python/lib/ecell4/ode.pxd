@@ -121,6 +121,7 @@ cdef extern from "ecell4/ode/ODESimulator.hpp" namespace "ecell4::ode":
         Cpp_RUNGE_KUTA_CASH_KARP54 "ecell4::ode::RUNGE_KUTA_CASH_KARP54"
         Cpp_ROSENBROCK4_CONTROLLER "ecell4::ode::ROSENBROCK4_CONTROLLER"
         Cpp_EULER "ecell4::ode::EULER"
+        Cpp_SPARSE_ROSENBROCK4 "ecell4::ode::SPARSE_ROSENBROCK4"
 
 ## Cpp_ODEWorld
 #  ecell4::ode::ODEWorld
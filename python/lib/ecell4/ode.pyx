@@ -1022,7 +1022,8 @@ cdef ODENetworkModel ODENetworkModel_from_Cpp_ODENetworkModel(
     RUNGE_KUTTA_CASH_KARP54,
     ROSENBROCK4_CONTROLLER,
     EULER,
-) = (0, 1, 2)
+    SPARSE_ROSENBROCK4,
+) = (0, 1, 2, 3)
 
 cdef Cpp_ODESolverType translate_solver_type(solvertype_constant):
     if solvertype_constant == RUNGE_KUTTA_CASH_KARP54:
@@ -1031,6 +1032,8 @@ cdef Cpp_ODESolverType translate_solver_type(solvertype_constant):
         return Cpp_ROSENBROCK4_CONTROLLER
     elif solvertype_constant == EULER:
         return Cpp_EULER
+    elif solvertype_constant == SPARSE_ROSENBROCK4:
+        return Cpp_SPARSE_ROSENBROCK4
     else:
         raise ValueError(
             "invalid solver type was given [{0}]".format(repr(solvertype_constant)))
@@ -1062,7 +1065,8 @@ cdef class ODESimulator:
             A world
         solver_type : int, optional
             a type of the ode solver.
-            Choose one from RUNGE_KUTTA_CASH_KARP54, ROSENBROCK4_CONTROLLER and EULER.
+            Choose one from RUNGE_KUTTA_CASH_KARP54, ROSENBROCK4_CONTROLLER,
+            EULER and SPARSE_ROSENBROCK4.
 
         """
         pass
@@ -1276,7 +1280,8 @@ cdef class ODEFactory:
         ----------
         solver_type : int, optional
             a type of the ode solver.
-            Choose one from RUNGE_KUTTA_CASH_KARP54, ROSENBROCK4_CONTROLLER and EULER.
+            Choose one from RUNGE_KUTTA_CASH_KARP54, ROSENBROCK4_CONTROLLER,
+            EULER and SPARSE_ROSENBROCK4.
         dt : Real, optional
             a default step interval.
         abs_tol : Real, optional